@@ -0,0 +1,690 @@
+#pragma once
+
+#include <algorithm>
+#include <limits>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include <dynamic_trees/parallel_euler_tour_tree/include/euler_tour_tree.hpp>
+#include <utilities/include/blockRadixSort.h>
+#include <utilities/include/seq.h>
+#include <utilities/include/sequence_ops.h>
+#include <utilities/include/utils.h>
+
+namespace batch_dynamic_connectivity {
+
+namespace _internal {
+
+// Value of a vertex in the spanning forest at some level i. `min_vertex` is
+// the vertex's id, so combining it over a tree gives the smallest id in the
+// tree, which serves as a label for the tree. `tree_edges` and
+// `non_tree_edges` count the tree edges and non-tree edges of level exactly i
+// incident to the vertex, so a tree can be searched for the vertices that have
+// such edges.
+template <typename Vertex>
+struct LevelValue {
+  Vertex min_vertex;
+  Vertex tree_edges;
+  Vertex non_tree_edges;
+};
+
+template <typename Vertex>
+struct LevelAugmentation {
+  using ValueType = LevelValue<Vertex>;
+  static ValueType Identity() {
+    return ValueType{std::numeric_limits<Vertex>::max(), 0, 0};
+  }
+  static ValueType Combine(const ValueType& a, const ValueType& b) {
+    return ValueType{
+      std::min(a.min_vertex, b.min_vertex),
+      a.tree_edges + b.tree_edges,
+      a.non_tree_edges + b.non_tree_edges};
+  }
+};
+
+}  // namespace _internal
+
+// Maintains the connected components of a general graph undergoing batches of
+// edge insertions and edge deletions, answering connectivity queries along the
+// way.
+//
+// This follows the dynamic connectivity algorithm of Holm, de Lichtenberg, and
+// Thorup with the batching of Acar, Anderson, Blelloch, and Dhulipala
+// ("Parallel batch-dynamic graph connectivity", SPAA 2019). Each edge has a
+// level between 0 and about log n. For each level i, a batch-parallel Euler
+// tour tree holds a spanning forest F_i of the edges with level at least i, so
+// that F_0 is a spanning forest of the whole graph, and each tree of F_i has at
+// most n / 2^i vertices. Edges outside the spanning forests are non-tree edges
+// and are stored per level.
+//
+// Adding edges links the ones that join different trees of F_0 and stores the
+// rest as non-tree edges at level 0. Deleting a tree edge cuts it from every
+// forest holding it, after which the algorithm searches for non-tree edges that
+// reconnect the pieces, from the top level downwards. At each level, the pieces
+// with at most n / 2^(i + 1) vertices are searched in parallel, in rounds. In
+// round r, each piece moves its tree edges up a level and scans up to 2^r of
+// its non-tree edges. The non-tree edges found inside a piece move up a level,
+// which pays for the search, and a spanning forest of the non-tree edges found
+// between pieces becomes replacement tree edges. A piece drops out once it runs
+// out of non-tree edges without finding a replacement. The other scanned edges
+// stay where they are, and since the number of scanned edges doubles each
+// round, they cost no more than the edges the piece moved up in earlier rounds.
+//
+// Each vertex keeps its own edge lists, so a batch of edge changes is grouped
+// by vertex and applied to all vertices in parallel.
+//
+template <typename Vertex = int>
+class BatchDynamicConnectivity {
+ public:
+  BatchDynamicConnectivity() = delete;
+  // Initializes an n-vertex graph with no edges.
+  explicit BatchDynamicConnectivity(Vertex num_vertices);
+  ~BatchDynamicConnectivity();
+  BatchDynamicConnectivity(const BatchDynamicConnectivity&) = delete;
+  BatchDynamicConnectivity(BatchDynamicConnectivity&&) = delete;
+  BatchDynamicConnectivity& operator=(
+      const BatchDynamicConnectivity&) = delete;
+  BatchDynamicConnectivity& operator=(BatchDynamicConnectivity&&) = delete;
+
+  // Returns true if `u` and `v` are connected in the graph.
+  bool IsConnected(Vertex u, Vertex v) const;
+  // Returns true if edge {`u`, `v`} is in the graph.
+  bool HasEdge(Vertex u, Vertex v) const;
+  // Returns the number of vertices in the connected component containing `v`.
+  Vertex ComponentSize(Vertex v) const;
+  // Returns the level of edge {`u`, `v`}, which must be in the graph.
+  int EdgeLevel(Vertex u, Vertex v) const;
+  // Returns true if edge {`u`, `v`}, which must be in the graph, is in the
+  // spanning forests rather than being a non-tree edge.
+  bool IsTreeEdge(Vertex u, Vertex v) const;
+
+  // Adds all edges in the `len`-length array `edges` to the graph. The edges
+  // must be distinct, must not already be in the graph, and must not be
+  // self-loops.
+  void BatchAddEdges(std::pair<Vertex, Vertex>* edges, Vertex len);
+  // Removes all edges in the `len`-length array `edges` from the graph. The
+  // edges must be distinct and must be in the graph.
+  void BatchDeleteEdges(std::pair<Vertex, Vertex>* edges, Vertex len);
+  // For each `i`=0,1,...,`len`-1, sets `out[i]` to whether `queries[i].first`
+  // and `queries[i].second` are connected in the graph. `out` must have space
+  // for `len` elements.
+  //
+  // This function does not modify the graph, so it may run concurrently with
+  // other const functions.
+  void BatchConnected(
+      std::pair<Vertex, Vertex>* queries, Vertex len, bool* out) const;
+
+ private:
+  using Edge = std::pair<Vertex, Vertex>;
+  using Forest = parallel_euler_tour_tree::EulerTourTree<
+    _internal::LevelAugmentation<Vertex>,
+    parallel_euler_tour_tree::ElementArena,
+    parallel_euler_tour_tree::HashEdgeMap,
+    Vertex>;
+  using LevelValue = _internal::LevelValue<Vertex>;
+
+  // A level of -1 stands for an edge that is not in the graph.
+  struct EdgeState {
+    int level;
+    bool is_tree;
+  };
+  // Edge {`u`, `v`} goes from state `before` to state `after`.
+  struct EdgeChange {
+    Vertex u;
+    Vertex v;
+    EdgeState before;
+    EdgeState after;
+  };
+  // The edges incident to a vertex. `neighbors[0][i]` and `neighbors[1][i]`
+  // hold the neighbors across non-tree edges and tree edges of level exactly
+  // i, and they grow only as far as the highest level in use.
+  struct VertexEdges {
+    std::unordered_map<Vertex, EdgeState> states;
+    std::vector<std::unordered_set<Vertex>> neighbors[2];
+  };
+
+  // Returns `edge` with its smaller endpoint first.
+  static Edge Normalize(const Edge& edge);
+  // Returns the elements `items[i]` for which `keep[i]` is true.
+  template <typename T>
+  static std::vector<T> Pack(const std::vector<T>& items, const bool* keep);
+  // Removes all but the first of each run of equal elements in `items`.
+  template <typename T>
+  static void RemoveAdjacentRepeats(std::vector<T>* items);
+  // Returns the concatenation of `parts`.
+  static std::vector<Edge> Concatenate(
+      const std::vector<std::vector<Edge>>& parts);
+  // Sorts `vertices` and removes repeats.
+  void SortAndDeduplicate(std::vector<Vertex>* vertices) const;
+  // Sorts `edges`, each of which has its smaller endpoint first, and removes
+  // repeats.
+  void SortAndDeduplicate(std::vector<Edge>* edges) const;
+
+  // Returns the neighbors of `v` across tree edges or non-tree edges of level
+  // exactly `level`.
+  std::unordered_set<Vertex>* Neighbors(Vertex v, int level, bool is_tree);
+  Vertex NumNeighbors(Vertex v, int level, bool is_tree) const;
+  // Applies `changes`, which must be to distinct edges, to the edge lists and
+  // to the edge counts in the vertex values of the forests. The forests'
+  // edges are left to the caller.
+  void ApplyEdgeChanges(const std::vector<EdgeChange>& changes);
+
+  // Sets `labels[i]` to the label of the tree of F_`level` containing
+  // `vertices[i]`, namely the smallest vertex id in that tree.
+  void BatchLabel(
+      int level, Vertex* vertices, Vertex len, Vertex* labels) const;
+
+  // Looks for replacement edges at level `level` after tree edges were cut.
+  // `cuts` holds the `num_cuts` cut tree edges of level at least `level`.
+  void SearchLevel(int level, const Edge* cuts, Vertex num_cuts);
+
+  Vertex num_vertices_;
+  int num_levels_;
+  // `forests_[i]` is the spanning forest F_i.
+  std::vector<Forest*> forests_;
+  // `vertex_edges_[v]` holds the edges incident to `v`.
+  std::vector<VertexEdges> vertex_edges_;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+//                           Implementation below.                           //
+///////////////////////////////////////////////////////////////////////////////
+
+template <typename Vertex>
+BatchDynamicConnectivity<Vertex>::BatchDynamicConnectivity(Vertex num_vertices)
+    : num_vertices_{num_vertices}
+    , num_levels_{1}
+    , vertex_edges_(num_vertices) {
+  // A tree of F_i has at most n / 2^i vertices, so no edge can reach a level
+  // at which that bound is below 2.
+  while ((num_vertices_ >> num_levels_) > 0) {
+    num_levels_++;
+  }
+  forests_.resize(num_levels_);
+
+  Vertex* vertices{pbbs::new_array_no_init<Vertex>(num_vertices_)};
+  LevelValue* values{pbbs::new_array_no_init<LevelValue>(num_vertices_)};
+  parallel_for (Vertex v = 0; v < num_vertices_; v++) {
+    vertices[v] = v;
+    values[v] = LevelValue{v, 0, 0};
+  }
+  // Forests share no state, so they may be built concurrently.
+  parallel_for (int i = 0; i < num_levels_; i++) {
+    forests_[i] = new Forest{num_vertices_};
+    forests_[i]->BatchUpdateVertexValues(vertices, values, num_vertices_);
+  }
+  pbbs::delete_array(values, num_vertices_);
+  pbbs::delete_array(vertices, num_vertices_);
+}
+
+template <typename Vertex>
+BatchDynamicConnectivity<Vertex>::~BatchDynamicConnectivity() {
+  for (Forest* forest : forests_) {
+    delete forest;
+  }
+}
+
+template <typename Vertex>
+bool BatchDynamicConnectivity<Vertex>::IsConnected(Vertex u, Vertex v) const {
+  return forests_[0]->IsConnected(u, v);
+}
+
+template <typename Vertex>
+bool BatchDynamicConnectivity<Vertex>::HasEdge(Vertex u, Vertex v) const {
+  return vertex_edges_[u].states.count(v) > 0;
+}
+
+template <typename Vertex>
+Vertex BatchDynamicConnectivity<Vertex>::ComponentSize(Vertex v) const {
+  return forests_[0]->ComponentSize(v);
+}
+
+template <typename Vertex>
+int BatchDynamicConnectivity<Vertex>::EdgeLevel(Vertex u, Vertex v) const {
+  return vertex_edges_[u].states.at(v).level;
+}
+
+template <typename Vertex>
+bool BatchDynamicConnectivity<Vertex>::IsTreeEdge(Vertex u, Vertex v) const {
+  return vertex_edges_[u].states.at(v).is_tree;
+}
+
+template <typename Vertex>
+void BatchDynamicConnectivity<Vertex>::BatchConnected(
+    std::pair<Vertex, Vertex>* queries, Vertex len, bool* out) const {
+  forests_[0]->BatchConnected(queries, len, out);
+}
+
+template <typename Vertex>
+typename BatchDynamicConnectivity<Vertex>::Edge
+BatchDynamicConnectivity<Vertex>::Normalize(const Edge& edge) {
+  return edge.first < edge.second
+    ? edge
+    : std::make_pair(edge.second, edge.first);
+}
+
+template <typename Vertex>
+template <typename T>
+std::vector<T> BatchDynamicConnectivity<Vertex>::Pack(
+    const std::vector<T>& items, const bool* keep) {
+  // `pbbs::pack` cannot take an empty input.
+  if (items.empty()) {
+    return {};
+  }
+  seq::sequence<T> packed{pbbs::pack(
+      seq::sequence<T>(const_cast<T*>(items.data()), items.size()),
+      seq::sequence<bool>(const_cast<bool*>(keep), items.size()))};
+  std::vector<T> result(packed.as_array(), packed.as_array() + packed.size());
+  pbbs::delete_array(packed.as_array(), packed.size());
+  return result;
+}
+
+template <typename Vertex>
+template <typename T>
+void BatchDynamicConnectivity<Vertex>::RemoveAdjacentRepeats(
+    std::vector<T>* items) {
+  const size_t len{items->size()};
+  bool* is_first{pbbs::new_array_no_init<bool>(len)};
+  parallel_for (size_t i = 0; i < len; i++) {
+    is_first[i] = i == 0 || (*items)[i] != (*items)[i - 1];
+  }
+  *items = Pack(*items, is_first);
+  pbbs::delete_array(is_first, len);
+}
+
+template <typename Vertex>
+std::vector<typename BatchDynamicConnectivity<Vertex>::Edge>
+BatchDynamicConnectivity<Vertex>::Concatenate(
+    const std::vector<std::vector<Edge>>& parts) {
+  std::vector<size_t> offsets(parts.size() + 1, 0);
+  for (size_t i = 0; i < parts.size(); i++) {
+    offsets[i + 1] = offsets[i] + parts[i].size();
+  }
+  std::vector<Edge> result(offsets.back());
+  parallel_for (size_t i = 0; i < parts.size(); i++) {
+    std::copy(parts[i].begin(), parts[i].end(), result.begin() + offsets[i]);
+  }
+  return result;
+}
+
+template <typename Vertex>
+void BatchDynamicConnectivity<Vertex>::SortAndDeduplicate(
+    std::vector<Vertex>* vertices) const {
+  if (vertices->empty()) {
+    return;
+  }
+  intSort::iSort(vertices->data(), vertices->size(),
+      static_cast<long>(num_vertices_), identityF<Vertex>());
+  RemoveAdjacentRepeats(vertices);
+}
+
+// Radix sort is stable, so sorting by the second endpoint and then by the
+// first sorts the edges.
+template <typename Vertex>
+void BatchDynamicConnectivity<Vertex>::SortAndDeduplicate(
+    std::vector<Edge>* edges) const {
+  if (edges->empty()) {
+    return;
+  }
+  intSort::iSort(edges->data(), edges->size(),
+      static_cast<long>(num_vertices_),
+      [](const Edge& edge) { return edge.second; });
+  intSort::iSort(edges->data(), edges->size(),
+      static_cast<long>(num_vertices_), firstF<Vertex, Vertex>());
+  RemoveAdjacentRepeats(edges);
+}
+
+template <typename Vertex>
+std::unordered_set<Vertex>* BatchDynamicConnectivity<Vertex>::Neighbors(
+    Vertex v, int level, bool is_tree) {
+  std::vector<std::unordered_set<Vertex>>& neighbors{
+    vertex_edges_[v].neighbors[is_tree]};
+  if (static_cast<int>(neighbors.size()) <= level) {
+    neighbors.resize(level + 1);
+  }
+  return &neighbors[level];
+}
+
+template <typename Vertex>
+Vertex BatchDynamicConnectivity<Vertex>::NumNeighbors(
+    Vertex v, int level, bool is_tree) const {
+  const std::vector<std::unordered_set<Vertex>>& neighbors{
+    vertex_edges_[v].neighbors[is_tree]};
+  return static_cast<int>(neighbors.size()) <= level
+    ? 0
+    : static_cast<Vertex>(neighbors[level].size());
+}
+
+template <typename Vertex>
+void BatchDynamicConnectivity<Vertex>::ApplyEdgeChanges(
+    const std::vector<EdgeChange>& changes) {
+  const Vertex len{static_cast<Vertex>(changes.size())};
+  if (len == 0) {
+    return;
+  }
+
+  // `half_edges[j]` pairs an endpoint of change `j / 2` with `j`, where the
+  // endpoint is `u` if `j` is even and `v` otherwise. Sorting by endpoint
+  // groups the changes by vertex, so that one task updates each vertex's edge
+  // lists.
+  std::vector<std::pair<Vertex, Vertex>> half_edges(2 * len);
+  parallel_for (Vertex i = 0; i < len; i++) {
+    half_edges[2 * i] = std::make_pair(changes[i].u, 2 * i);
+    half_edges[2 * i + 1] = std::make_pair(changes[i].v, 2 * i + 1);
+  }
+  intSort::iSort(half_edges.data(), 2 * len,
+      static_cast<long>(num_vertices_), firstF<Vertex, Vertex>());
+  // `refreshes` pairs each level at which a vertex's edges changed, plus one,
+  // with the vertex, so that a pair with level 0 stands for no change.
+  std::vector<std::pair<Vertex, Vertex>> refreshes(4 * len);
+  parallel_for (Vertex j = 0; j < 2 * len; j++) {
+    const Vertex v{half_edges[j].first};
+    const EdgeChange& change{changes[half_edges[j].second / 2]};
+    refreshes[2 * j] = std::make_pair(change.before.level + 1, v);
+    refreshes[2 * j + 1] = std::make_pair(change.after.level + 1, v);
+    if (j > 0 && half_edges[j - 1].first == v) {
+      continue;
+    }
+    std::unordered_map<Vertex, EdgeState>& states{vertex_edges_[v].states};
+    for (Vertex k = j; k < 2 * len && half_edges[k].first == v; k++) {
+      const EdgeChange& c{changes[half_edges[k].second / 2]};
+      const Vertex neighbor{half_edges[k].second % 2 == 0 ? c.v : c.u};
+      if (c.before.level >= 0) {
+        Neighbors(v, c.before.level, c.before.is_tree)->erase(neighbor);
+      }
+      if (c.after.level >= 0) {
+        Neighbors(v, c.after.level, c.after.is_tree)->insert(neighbor);
+        states[neighbor] = c.after;
+      } else {
+        states.erase(neighbor);
+      }
+    }
+  }
+
+  // `refreshes` is in vertex order, and radix sort is stable, so sorting by
+  // level leaves each level's vertices sorted and copies of a vertex adjacent.
+  // `BatchUpdateVertexValues` requires distinct vertices.
+  intSort::iSort(refreshes.data(), refreshes.size(),
+      static_cast<long>(num_levels_) + 1, firstF<Vertex, Vertex>());
+  RemoveAdjacentRepeats(&refreshes);
+  const Vertex num_refreshes{static_cast<Vertex>(refreshes.size())};
+  std::vector<Vertex> starts(num_levels_ + 1, 0);
+  std::vector<Vertex> ends(num_levels_ + 1, 0);
+  parallel_for (Vertex j = 0; j < num_refreshes; j++) {
+    const Vertex level{refreshes[j].first};
+    if (j == 0 || refreshes[j - 1].first != level) {
+      starts[level] = j;
+    }
+    if (j == num_refreshes - 1 || refreshes[j + 1].first != level) {
+      ends[level] = j + 1;
+    }
+  }
+  parallel_for (int i = 0; i < num_levels_; i++) {
+    const Vertex start{starts[i + 1]};
+    const Vertex num_vertices{ends[i + 1] - start};
+    if (num_vertices == 0) {
+      continue;
+    }
+    Vertex* vertices{pbbs::new_array_no_init<Vertex>(num_vertices)};
+    LevelValue* values{pbbs::new_array_no_init<LevelValue>(num_vertices)};
+    parallel_for (Vertex j = 0; j < num_vertices; j++) {
+      const Vertex v{refreshes[start + j].second};
+      vertices[j] = v;
+      values[j] = LevelValue{
+        v, NumNeighbors(v, i, true), NumNeighbors(v, i, false)};
+    }
+    forests_[i]->BatchUpdateVertexValues(vertices, values, num_vertices);
+    pbbs::delete_array(values, num_vertices);
+    pbbs::delete_array(vertices, num_vertices);
+  }
+}
+
+template <typename Vertex>
+void BatchDynamicConnectivity<Vertex>::BatchLabel(
+    int level, Vertex* vertices, Vertex len, Vertex* labels) const {
+  LevelValue* aggregates{pbbs::new_array_no_init<LevelValue>(len)};
+  forests_[level]->BatchComponentAggregate(vertices, len, aggregates);
+  parallel_for (Vertex i = 0; i < len; i++) {
+    labels[i] = aggregates[i].min_vertex;
+  }
+  pbbs::delete_array(aggregates, len);
+}
+
+template <typename Vertex>
+void BatchDynamicConnectivity<Vertex>::BatchAddEdges(
+    std::pair<Vertex, Vertex>* edges, Vertex len) {
+  if (len == 0) {
+    return;
+  }
+  // F_0 links a spanning forest of the batch and the existing trees, and the
+  // rest of the batch becomes non-tree edges.
+  bool* is_tree{pbbs::new_array_no_init<bool>(len)};
+  forests_[0]->BatchInsertSpanningEdges(edges, len, is_tree);
+  std::vector<EdgeChange> changes(len);
+  parallel_for (Vertex i = 0; i < len; i++) {
+    changes[i] = EdgeChange{edges[i].first, edges[i].second,
+      EdgeState{-1, false}, EdgeState{0, is_tree[i]}};
+  }
+  pbbs::delete_array(is_tree, len);
+  ApplyEdgeChanges(changes);
+}
+
+template <typename Vertex>
+void BatchDynamicConnectivity<Vertex>::BatchDeleteEdges(
+    std::pair<Vertex, Vertex>* edges, Vertex len) {
+  if (len == 0) {
+    return;
+  }
+  std::vector<EdgeChange> changes(len);
+  bool* is_tree{pbbs::new_array_no_init<bool>(len)};
+  parallel_for (Vertex i = 0; i < len; i++) {
+    const Vertex u{edges[i].first};
+    const Vertex v{edges[i].second};
+    const EdgeState state{vertex_edges_[u].states.at(v)};
+    changes[i] = EdgeChange{u, v, state, EdgeState{-1, false}};
+    is_tree[i] = state.is_tree;
+  }
+  ApplyEdgeChanges(changes);
+  std::vector<EdgeChange> tree_changes{Pack(changes, is_tree)};
+  pbbs::delete_array(is_tree, len);
+  const Vertex num_cuts{static_cast<Vertex>(tree_changes.size())};
+  if (num_cuts == 0) {
+    return;
+  }
+
+  // Sort the cut tree edges from the highest level down, so that the ones of
+  // level at least i are a prefix of `cuts` of length `num_cuts_from[i]`.
+  intSort::iSort(tree_changes.data(), num_cuts, num_levels_,
+      [&](const EdgeChange& change) {
+        return num_levels_ - 1 - change.before.level;
+      });
+  std::vector<Edge> cuts(num_cuts);
+  std::vector<Vertex> num_cuts_from(num_levels_ + 1, 0);
+  parallel_for (Vertex i = 0; i < num_cuts; i++) {
+    cuts[i] = std::make_pair(tree_changes[i].u, tree_changes[i].v);
+    const int level{tree_changes[i].before.level};
+    if (i == num_cuts - 1 || tree_changes[i + 1].before.level != level) {
+      num_cuts_from[level] = i + 1;
+    }
+  }
+  for (int i = num_levels_ - 1; i >= 0; i--) {
+    num_cuts_from[i] = std::max(num_cuts_from[i], num_cuts_from[i + 1]);
+  }
+
+  // A tree edge of level j lies in F_0, F_1, ..., F_j.
+  const int max_level{tree_changes[0].before.level};
+  parallel_for (int i = 0; i <= max_level; i++) {
+    std::vector<Edge> forest_cuts(
+        cuts.begin(), cuts.begin() + num_cuts_from[i]);
+    forests_[i]->BatchCut(forest_cuts.data(), forest_cuts.size());
+  }
+  for (int i = max_level; i >= 0; i--) {
+    SearchLevel(i, cuts.data(), num_cuts_from[i]);
+  }
+}
+
+template <typename Vertex>
+void BatchDynamicConnectivity<Vertex>::SearchLevel(
+    int level, const Edge* cuts, Vertex num_cuts) {
+  // Every piece that the cuts left behind in F_`level` contains an endpoint
+  // of a cut. Of the pieces that came from the same tree, at most one has
+  // more than n / 2^(`level` + 1) vertices, so every replacement edge has an
+  // endpoint in a small piece, and searching only the small pieces suffices.
+  if (level + 1 >= num_levels_) {
+    return;
+  }
+  const Vertex max_small_size{num_vertices_ >> (level + 1)};
+  // `active` holds a vertex of each piece that is still being searched.
+  std::vector<Vertex> active(2 * num_cuts);
+  parallel_for (Vertex i = 0; i < num_cuts; i++) {
+    active[2 * i] = cuts[i].first;
+    active[2 * i + 1] = cuts[i].second;
+  }
+
+  for (size_t scan_limit = 1; !active.empty(); scan_limit *= 2) {
+    // A piece's label is one of its vertices.
+    const Vertex num_active{static_cast<Vertex>(active.size())};
+    std::vector<Vertex> labels(num_active);
+    Vertex* sizes{pbbs::new_array_no_init<Vertex>(num_active)};
+    bool* is_small{pbbs::new_array_no_init<bool>(num_active)};
+    BatchLabel(level, active.data(), num_active, labels.data());
+    forests_[level]->BatchComponentSize(active.data(), num_active, sizes);
+    parallel_for (Vertex i = 0; i < num_active; i++) {
+      is_small[i] = sizes[i] <= max_small_size;
+    }
+    std::vector<Vertex> pieces{Pack(labels, is_small)};
+    pbbs::delete_array(is_small, num_active);
+    pbbs::delete_array(sizes, num_active);
+    SortAndDeduplicate(&pieces);
+    const Vertex num_pieces{static_cast<Vertex>(pieces.size())};
+    if (num_pieces == 0) {
+      break;
+    }
+
+    // Move the tree edges of level `level` in the small pieces up a level.
+    // Each small piece then becomes a tree of F_(`level` + 1), which it may
+    // since it has at most n / 2^(`level` + 1) vertices. After the first
+    // round, only replacement edges from earlier rounds are left to move.
+    std::vector<std::vector<Edge>> piece_tree_edges(num_pieces);
+    parallel_for (Vertex i = 0; i < num_pieces; i++) {
+      forests_[level]->ForEachMatchingVertex(pieces[i],
+          [](const LevelValue& value) { return value.tree_edges > 0; },
+          [&](Vertex u) {
+            for (Vertex v : vertex_edges_[u].neighbors[true][level]) {
+              // Both endpoints of a tree edge lie in the piece, so take the
+              // edge from its smaller endpoint only.
+              if (u < v) {
+                piece_tree_edges[i].emplace_back(u, v);
+              }
+            }
+          });
+    }
+    std::vector<Edge> promoted_tree_edges{Concatenate(piece_tree_edges)};
+    std::vector<EdgeChange> changes(promoted_tree_edges.size());
+    parallel_for (size_t i = 0; i < promoted_tree_edges.size(); i++) {
+      changes[i] = EdgeChange{
+        promoted_tree_edges[i].first, promoted_tree_edges[i].second,
+        EdgeState{level, true}, EdgeState{level + 1, true}};
+    }
+    ApplyEdgeChanges(changes);
+    forests_[level + 1]->BatchLink(
+        promoted_tree_edges.data(), promoted_tree_edges.size());
+
+    // Scan up to `scan_limit` non-tree edges of level `level` out of each
+    // piece. A piece that finds fewer has no more such edges.
+    std::vector<std::vector<Edge>> piece_non_tree_edges(num_pieces);
+    bool* has_more{pbbs::new_array_no_init<bool>(num_pieces)};
+    parallel_for (Vertex i = 0; i < num_pieces; i++) {
+      std::vector<Edge>& found{piece_non_tree_edges[i]};
+      forests_[level]->ForEachMatchingVertex(pieces[i],
+          [&](const LevelValue& value) {
+            return found.size() < scan_limit && value.non_tree_edges > 0;
+          },
+          [&](Vertex u) {
+            for (Vertex v : vertex_edges_[u].neighbors[false][level]) {
+              if (found.size() == scan_limit) {
+                break;
+              }
+              found.push_back(Normalize(std::make_pair(u, v)));
+            }
+          });
+      has_more[i] = found.size() == scan_limit;
+    }
+    // A non-tree edge seen from both of its endpoints shows up twice.
+    std::vector<Edge> non_tree_edges{Concatenate(piece_non_tree_edges)};
+    SortAndDeduplicate(&non_tree_edges);
+    const Vertex num_non_tree_edges{
+      static_cast<Vertex>(non_tree_edges.size())};
+    Vertex* edge_endpoints{
+      pbbs::new_array_no_init<Vertex>(2 * num_non_tree_edges)};
+    parallel_for (Vertex i = 0; i < num_non_tree_edges; i++) {
+      edge_endpoints[2 * i] = non_tree_edges[i].first;
+      edge_endpoints[2 * i + 1] = non_tree_edges[i].second;
+    }
+    std::vector<Vertex> edge_labels(2 * num_non_tree_edges);
+    BatchLabel(
+        level, edge_endpoints, 2 * num_non_tree_edges, edge_labels.data());
+    pbbs::delete_array(edge_endpoints, 2 * num_non_tree_edges);
+    bool* is_internal{pbbs::new_array_no_init<bool>(num_non_tree_edges)};
+    bool* is_crossing{pbbs::new_array_no_init<bool>(num_non_tree_edges)};
+    parallel_for (Vertex i = 0; i < num_non_tree_edges; i++) {
+      is_internal[i] = edge_labels[2 * i] == edge_labels[2 * i + 1];
+      is_crossing[i] = !is_internal[i];
+    }
+    const std::vector<Edge> internal_edges{
+      Pack(non_tree_edges, is_internal)};
+    std::vector<Edge> crossing_edges{Pack(non_tree_edges, is_crossing)};
+    pbbs::delete_array(is_crossing, num_non_tree_edges);
+    pbbs::delete_array(is_internal, num_non_tree_edges);
+
+    // A non-tree edge inside a small piece moves up a level along with the
+    // piece's tree edges. A non-tree edge between pieces is a candidate
+    // replacement, and F_`level` links a spanning forest of the candidates
+    // over the pieces as replacement tree edges of level `level`.
+    const Vertex num_crossing_edges{
+      static_cast<Vertex>(crossing_edges.size())};
+    bool* is_replacement{pbbs::new_array_no_init<bool>(num_crossing_edges)};
+    forests_[level]->BatchInsertSpanningEdges(
+        crossing_edges.data(), num_crossing_edges, is_replacement);
+    const std::vector<Edge> replacements{
+      Pack(crossing_edges, is_replacement)};
+    pbbs::delete_array(is_replacement, num_crossing_edges);
+    // The pieces joined by a replacement edge are also in different trees of
+    // every forest below F_`level`: otherwise, those forests would have had a
+    // cycle before the cuts.
+    parallel_for (int i = 0; i < level; i++) {
+      std::vector<Edge> links{replacements};
+      forests_[i]->BatchLink(links.data(), links.size());
+    }
+    changes.resize(internal_edges.size() + replacements.size());
+    parallel_for (size_t i = 0; i < internal_edges.size(); i++) {
+      changes[i] = EdgeChange{internal_edges[i].first, internal_edges[i].second,
+        EdgeState{level, false}, EdgeState{level + 1, false}};
+    }
+    parallel_for (size_t i = 0; i < replacements.size(); i++) {
+      changes[internal_edges.size() + i] = EdgeChange{
+        replacements[i].first, replacements[i].second,
+        EdgeState{level, false}, EdgeState{level, true}};
+    }
+    ApplyEdgeChanges(changes);
+
+    // A piece that has edges left keeps scanning with twice the limit. A piece
+    // that found a candidate replacement has joined another piece, or shares
+    // one with a piece that has, and the joined piece is searched again as a
+    // whole, since it may still be small and separate from the rest of its
+    // former tree.
+    std::vector<Vertex> next_active{Pack(pieces, has_more)};
+    pbbs::delete_array(has_more, num_pieces);
+    const size_t num_kept{next_active.size()};
+    next_active.resize(num_kept + 2 * num_crossing_edges);
+    parallel_for (Vertex i = 0; i < num_crossing_edges; i++) {
+      next_active[num_kept + 2 * i] = crossing_edges[i].first;
+      next_active[num_kept + 2 * i + 1] = crossing_edges[i].second;
+    }
+    active.swap(next_active);
+  }
+}
+
+}  // namespace batch_dynamic_connectivity
@@ -0,0 +1,281 @@
+#include <dynamic_trees/batch_dynamic_connectivity/include/batch_dynamic_connectivity.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <iostream>
+#include <random>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include <utilities/include/hash_pair.hpp>
+
+using BatchDynamicConnectivity =
+  batch_dynamic_connectivity::BatchDynamicConnectivity<>;
+using EdgeSet = std::unordered_set<std::pair<int, int>, HashIntPairStruct>;
+
+constexpr int num_vertices{300};
+
+// Labels each vertex of the graph with the smallest vertex in its component.
+std::vector<int> ComputeComponents(const EdgeSet& edges) {
+  std::vector<std::vector<int>> adjacency_list(num_vertices);
+  for (const auto& e : edges) {
+    adjacency_list[e.first].push_back(e.second);
+    adjacency_list[e.second].push_back(e.first);
+  }
+  std::vector<int> components(num_vertices, -1);
+  for (int v = 0; v < num_vertices; v++) {
+    if (components[v] != -1) {
+      continue;
+    }
+    std::vector<int> stack{v};
+    components[v] = v;
+    while (!stack.empty()) {
+      const int u{stack.back()};
+      stack.pop_back();
+      for (int w : adjacency_list[u]) {
+        if (components[w] == -1) {
+          components[w] = v;
+          stack.push_back(w);
+        }
+      }
+    }
+  }
+  return components;
+}
+
+void CheckConnectivity(
+    const EdgeSet& edges, const BatchDynamicConnectivity& graph) {
+  const std::vector<int> components{ComputeComponents(edges)};
+  std::vector<int> sizes(num_vertices, 0);
+  for (int v = 0; v < num_vertices; v++) {
+    sizes[components[v]]++;
+  }
+  for (int v = 0; v < num_vertices; v++) {
+    assert(graph.ComponentSize(v) == sizes[components[v]]);
+  }
+
+  constexpr int num_queries{num_vertices * num_vertices};
+  std::pair<int, int>* queries{
+      pbbs::new_array_no_init<std::pair<int, int>>(num_queries)};
+  bool* answers{pbbs::new_array_no_init<bool>(num_queries)};
+  for (int u = 0; u < num_vertices; u++) {
+    for (int v = 0; v < num_vertices; v++) {
+      assert(graph.IsConnected(u, v) == (components[u] == components[v]));
+      queries[u * num_vertices + v] = std::make_pair(u, v);
+    }
+  }
+  graph.BatchConnected(queries, num_queries, answers);
+  for (int u = 0; u < num_vertices; u++) {
+    for (int v = 0; v < num_vertices; v++) {
+      assert(answers[u * num_vertices + v] ==
+          (components[u] == components[v]));
+    }
+  }
+  pbbs::delete_array(answers, num_queries);
+  pbbs::delete_array(queries, num_queries);
+
+  for (const auto& e : edges) {
+    assert(graph.HasEdge(e.first, e.second));
+    assert(graph.HasEdge(e.second, e.first));
+  }
+}
+
+// Checks the invariants that the searches for replacement edges rely on: the
+// tree edges form a spanning forest of the graph, the tree edges of level at
+// least i form trees of at most n / 2^i vertices, and the endpoints of each
+// non-tree edge of level i are connected by tree edges of level at least i.
+// Returns the highest level of any edge.
+int CheckLevels(const EdgeSet& edges, const BatchDynamicConnectivity& graph) {
+  int max_level{0};
+  for (const auto& e : edges) {
+    const int level{graph.EdgeLevel(e.first, e.second)};
+    assert(level >= 0);
+    assert(graph.EdgeLevel(e.second, e.first) == level);
+    assert(graph.IsTreeEdge(e.second, e.first) ==
+        graph.IsTreeEdge(e.first, e.second));
+    max_level = std::max(max_level, level);
+  }
+
+  for (int i = 0; i <= max_level; i++) {
+    EdgeSet forest{};
+    for (const auto& e : edges) {
+      if (graph.IsTreeEdge(e.first, e.second) &&
+          graph.EdgeLevel(e.first, e.second) >= i) {
+        forest.insert(e);
+      }
+    }
+    const std::vector<int> components{ComputeComponents(forest)};
+    std::vector<int> sizes(num_vertices, 0);
+    for (int v = 0; v < num_vertices; v++) {
+      sizes[components[v]]++;
+    }
+    int num_components{0};
+    for (int v = 0; v < num_vertices; v++) {
+      assert(sizes[components[v]] <= (num_vertices >> i));
+      num_components += components[v] == v;
+    }
+    if (i == 0) {
+      assert(components == ComputeComponents(edges));
+      assert(static_cast<int>(forest.size()) == num_vertices - num_components);
+    }
+    for (const auto& e : edges) {
+      if (!graph.IsTreeEdge(e.first, e.second) &&
+          graph.EdgeLevel(e.first, e.second) == i) {
+        assert(components[e.first] == components[e.second]);
+      }
+    }
+  }
+  return max_level;
+}
+
+// Alternates between adding `num_additions` random edges and deleting each
+// edge with probability 1 / `deletion_ratio`. Batches are split into pieces
+// of `batch_size` edges.
+void CheckRandomUpdates(
+    int num_rounds, int num_additions, int deletion_ratio, int batch_size) {
+  std::mt19937 rng{};
+  rng.seed(num_additions + deletion_ratio + batch_size);
+  std::uniform_int_distribution<int> vert_dist{0, num_vertices - 1};
+
+  BatchDynamicConnectivity graph{num_vertices};
+  EdgeSet edges{};
+  std::vector<std::pair<int, int>> batch;
+  for (int i = 0; i < num_rounds; i++) {
+    batch.clear();
+    for (int j = 0; j < num_additions; j++) {
+      const int u{vert_dist(rng)}, v{vert_dist(rng)};
+      if (u != v && edges.count(std::make_pair(u, v)) == 0 &&
+          edges.count(std::make_pair(v, u)) == 0) {
+        edges.emplace(u, v);
+        batch.emplace_back(u, v);
+      }
+    }
+    for (size_t j = 0; j < batch.size(); j += batch_size) {
+      graph.BatchAddEdges(&batch[j],
+          std::min(batch.size() - j, static_cast<size_t>(batch_size)));
+    }
+    CheckConnectivity(edges, graph);
+
+    batch.clear();
+    for (const auto& e : edges) {
+      if (rng() % deletion_ratio == 0) {
+        batch.push_back(rng() % 2 == 0 ? e : std::make_pair(e.second, e.first));
+      }
+    }
+    for (const auto& e : batch) {
+      edges.erase(e);
+      edges.erase(std::make_pair(e.second, e.first));
+    }
+    for (size_t j = 0; j < batch.size(); j += batch_size) {
+      graph.BatchDeleteEdges(&batch[j],
+          std::min(batch.size() - j, static_cast<size_t>(batch_size)));
+    }
+    CheckConnectivity(edges, graph);
+    CheckLevels(edges, graph);
+  }
+}
+
+// Builds a cycle with chords and then removes it edge by edge, so that every
+// deletion of a tree edge needs a replacement until the graph falls apart.
+void CheckReplacements() {
+  BatchDynamicConnectivity graph{num_vertices};
+  EdgeSet edges{};
+  std::vector<std::pair<int, int>> batch;
+  for (int v = 0; v < num_vertices; v++) {
+    batch.emplace_back(v, (v + 1) % num_vertices);
+    if (v % 3 == 0 && v < num_vertices / 2) {
+      batch.emplace_back(v, (v + num_vertices / 2) % num_vertices);
+    }
+  }
+  for (const auto& e : batch) {
+    edges.insert(e);
+  }
+  graph.BatchAddEdges(batch.data(), batch.size());
+  CheckConnectivity(edges, graph);
+
+  for (size_t i = 0; i < batch.size(); i += 7) {
+    std::pair<int, int> deletion{batch[i]};
+    edges.erase(deletion);
+    graph.BatchDeleteEdges(&deletion, 1);
+    assert(!graph.HasEdge(deletion.first, deletion.second));
+  }
+  CheckConnectivity(edges, graph);
+  while (!edges.empty()) {
+    std::pair<int, int> deletion{*edges.begin()};
+    edges.erase(deletion);
+    graph.BatchDeleteEdges(&deletion, 1);
+    if (edges.size() % 50 == 0) {
+      CheckConnectivity(edges, graph);
+      CheckLevels(edges, graph);
+    }
+  }
+  CheckConnectivity(edges, graph);
+}
+
+// Repeatedly deletes a random part of a dense graph and adds it back, so that
+// edges keep moving up levels, and checks the level invariants throughout.
+void CheckDeleteReinsertCycles(int num_cycles, int batch_size) {
+  std::mt19937 rng{};
+  rng.seed(num_cycles + batch_size);
+  std::uniform_int_distribution<int> vert_dist{0, num_vertices - 1};
+
+  BatchDynamicConnectivity graph{num_vertices};
+  EdgeSet edges{};
+  std::vector<std::pair<int, int>> batch;
+  for (int j = 0; j < 3 * num_vertices; j++) {
+    const int u{vert_dist(rng)}, v{vert_dist(rng)};
+    if (u != v && edges.count(std::make_pair(u, v)) == 0 &&
+        edges.count(std::make_pair(v, u)) == 0) {
+      edges.emplace(u, v);
+      batch.emplace_back(u, v);
+    }
+  }
+  graph.BatchAddEdges(batch.data(), batch.size());
+  CheckLevels(edges, graph);
+
+  int max_level{0};
+  for (int i = 0; i < num_cycles; i++) {
+    batch.clear();
+    for (const auto& e : edges) {
+      if (rng() % 3 == 0) {
+        batch.push_back(e);
+      }
+    }
+    for (const auto& e : batch) {
+      edges.erase(e);
+    }
+    for (size_t j = 0; j < batch.size(); j += batch_size) {
+      graph.BatchDeleteEdges(&batch[j],
+          std::min(batch.size() - j, static_cast<size_t>(batch_size)));
+    }
+    CheckConnectivity(edges, graph);
+    max_level = std::max(max_level, CheckLevels(edges, graph));
+
+    for (const auto& e : batch) {
+      edges.insert(e);
+    }
+    for (size_t j = 0; j < batch.size(); j += batch_size) {
+      graph.BatchAddEdges(&batch[j],
+          std::min(batch.size() - j, static_cast<size_t>(batch_size)));
+    }
+    CheckConnectivity(edges, graph);
+    max_level = std::max(max_level, CheckLevels(edges, graph));
+  }
+  // Otherwise the cycles never got past level 0 and tested little.
+  assert(max_level > 0);
+}
+
+int main() {
+  // Large batches exercise the parallel paths of the underlying forests, and
+  // small batches exercise the sequential ones.
+  CheckRandomUpdates(8, 250, 3, 1000);
+  CheckRandomUpdates(8, 600, 2, 1000);
+  CheckRandomUpdates(5, 200, 4, 5);
+  CheckRandomUpdates(3, 2000, 2, 1000);
+  CheckReplacements();
+  CheckDeleteReinsertCycles(20, 1000);
+  CheckDeleteReinsertCycles(10, 7);
+
+  std::cout << "Test complete." << std::endl;
+}
@@ -13,42 +13,45 @@
 
 namespace dynamic_trees_benchmark {
 
+// `Vertex` is the integer type of vertex ids and of vertex and edge counts.
+template <typename Vertex = int>
 struct ReadGraphOutput {
-  int num_vertices;
-  int num_edges;
-  std::pair<int, int>* edges;
+  Vertex num_vertices;
+  Vertex num_edges;
+  std::pair<Vertex, Vertex>* edges;
 };
 
 // Returns a list of edges. Stores number of nodes and number of edges in `*np`
 // and `*mp`.
 // Randomly flips edge directions.
-ReadGraphOutput ReadGraph(char* graph_filename) {
+template <typename Vertex = int>
+ReadGraphOutput<Vertex> ReadGraph(char* graph_filename) {
   std::ifstream infile;
   infile.open(graph_filename);
-  struct ReadGraphOutput output;
+  ReadGraphOutput<Vertex> output;
 
   string input_type;
   infile >> input_type;
   assert(input_type == "AdjacencyGraph");
   infile >> output.num_vertices >> output.num_edges;
   output.num_edges /= 2;  // symmetric graph
-  const int n{output.num_vertices}, m{output.num_edges};
-  output.edges = pbbs::new_array_no_init<pair<int, int>>(m);
+  const Vertex n{output.num_vertices}, m{output.num_edges};
+  output.edges = pbbs::new_array_no_init<pair<Vertex, Vertex>>(m);
 
-  int* offsets{pbbs::new_array_no_init<int>(n)};
-  for (int i = 0; i < n; i++) {
+  Vertex* offsets{pbbs::new_array_no_init<Vertex>(n)};
+  for (Vertex i = 0; i < n; i++) {
     infile >> offsets[i];
   }
 
   std::uniform_int_distribution<int> coin{0, 1};
   std::mt19937 generator{0};
-  int curr_vert{0};
-  int edges_index{0};
-  for (int i = 0; i < 2 * m; i++) {
+  Vertex curr_vert{0};
+  Vertex edges_index{0};
+  for (Vertex i = 0; i < 2 * m; i++) {
     while (curr_vert < n - 1 && offsets[curr_vert + 1] == i) {
       curr_vert++;
     }
-    int v;
+    Vertex v;
     infile >> v;
     if (curr_vert < v) {  // don't want to read both directions of edge
       // randomly swap direction of edge
@@ -66,13 +69,18 @@ ReadGraphOutput ReadGraph(char* graph_filename) {
 }
 
 // For `num_iters` iterations, construct a forest from the `m` edges in `edges`,
-// then batch cut and batch link the first `batch_size` edges in `edges`.
-// Report the median batch cut and batch link time.
-template <typename Forest>
-void UpdateForest(Forest* forest, std::pair<int, int>* edges,
-    int batch_size, int num_iters, int m) {
+// ask the first `batch_size` connectivity queries in `queries` as a batch, then
+// batch cut and batch link the first `batch_size` edges in `edges`.
+// Report the median batch link, batch cut, and batch query time.
+//
+// `query_answers` is scratch space with room for `batch_size` answers.
+template <typename Forest, typename Vertex>
+void UpdateForest(Forest* forest, std::pair<Vertex, Vertex>* edges,
+    std::pair<Vertex, Vertex>* queries, bool* query_answers,
+    Vertex batch_size, int num_iters, Vertex m) {
   vector<double> cut_times(num_iters);
   vector<double> link_times(num_iters);
+  vector<double> query_times(num_iters);
 
   for (int j = 0; j < num_iters; j++) {
     if (m == batch_size) {
@@ -83,12 +91,20 @@ void UpdateForest(Forest* forest, std::pair<int, int>* edges,
       forest->BatchLink(edges, batch_size);
       link_times[j] = link_t.stop();
 
+      timer query_t; query_t.start();
+      forest->BatchConnected(queries, batch_size, query_answers);
+      query_times[j] = query_t.stop();
+
       timer cut_t; cut_t.start();
       forest->BatchCut(edges, batch_size);
       cut_times[j] = cut_t.stop();
     } else {
       forest->BatchLink(edges, m);  // construct
 
+      timer query_t; query_t.start();
+      forest->BatchConnected(queries, batch_size, query_answers);
+      query_times[j] = query_t.stop();
+
       timer cut_t; cut_t.start();
       forest->BatchCut(edges, batch_size);
       cut_times[j] = cut_t.stop();
@@ -102,29 +118,44 @@ void UpdateForest(Forest* forest, std::pair<int, int>* edges,
   }
   const string batch_str{to_string(batch_size)};
   timer::report_time_no_newline("link-" + batch_str, median(link_times));
-  timer::report_time("cut-" + batch_str, median(cut_times));
+  timer::report_time_no_newline("cut-" + batch_str, median(cut_times));
+  timer::report_time("query-" + batch_str, median(query_times));
 }
 
-template <typename Forest>
+// `Vertex` is the vertex id type that `Forest` takes.
+template <typename Forest, typename Vertex = int>
 void RunBenchmark(int argc, char** argv) {
   commandLine P{argc, argv, "[-iters] graph_filename"};
   int num_iters{P.getOptionIntValue("-iters", 4)};
   char* graph_filename{P.getArgument(0)};
 
   std::cout << "Running with " << nworkers() << " workers" << std::endl;
-  ReadGraphOutput graph_info{ReadGraph(graph_filename)};
-  const int m{graph_info.num_edges};
-  std::pair<int, int>* edges{graph_info.edges};
+  ReadGraphOutput<Vertex> graph_info{ReadGraph<Vertex>(graph_filename)};
+  const Vertex m{graph_info.num_edges};
+  std::pair<Vertex, Vertex>* edges{graph_info.edges};
   std::mt19937 generator{0};
   std::shuffle(edges, edges + m, generator);
 
+  // Connectivity queries between uniformly random pairs of vertices.
+  std::uniform_int_distribution<Vertex>
+    vertex_dist{0, graph_info.num_vertices - 1};
+  std::pair<Vertex, Vertex>* queries{
+    pbbs::new_array_no_init<pair<Vertex, Vertex>>(m)};
+  for (Vertex i = 0; i < m; i++) {
+    queries[i] = std::make_pair(vertex_dist(generator), vertex_dist(generator));
+  }
+  bool* query_answers{pbbs::new_array_no_init<bool>(m)};
+
   Forest forest{graph_info.num_vertices};
 
-  for (int batch_size = 100; batch_size < m; batch_size *= 10) {
-    UpdateForest(&forest, edges, batch_size, num_iters, m);
+  for (Vertex batch_size = 100; batch_size < m; batch_size *= 10) {
+    UpdateForest(
+        &forest, edges, queries, query_answers, batch_size, num_iters, m);
   }
-  UpdateForest(&forest, edges, m, num_iters, m);
+  UpdateForest(&forest, edges, queries, query_answers, m, num_iters, m);
 
+  pbbs::delete_array(query_answers, m);
+  pbbs::delete_array(queries, m);
   pbbs::delete_array(edges, m);
 }
 
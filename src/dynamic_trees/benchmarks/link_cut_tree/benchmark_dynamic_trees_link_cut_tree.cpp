@@ -3,6 +3,6 @@
 #include <dynamic_trees/benchmarks/benchmark.hpp>
 
 int main(int argc, char** argv) {
-  dynamic_trees_benchmark::RunBenchmark<link_cut_tree::LinkCutTree>(argc, argv);
+  dynamic_trees_benchmark::RunBenchmark<link_cut_tree::LinkCutTree<>>(argc, argv);
   return 0;
 }
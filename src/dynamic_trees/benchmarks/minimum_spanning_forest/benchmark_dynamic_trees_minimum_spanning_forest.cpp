@@ -0,0 +1,122 @@
+// Benchmarks maintaining a minimum spanning forest under batches of weighted
+// edge insertions against recomputing it from scratch.
+//
+// Each edge of the input graph gets a uniformly random weight. For each batch
+// size, inserts all the edges into an `IncrementalMinimumSpanningForest` in
+// batches of that size and reports the median time per batch. Also reports the
+// median time for Kruskal's algorithm to compute the minimum spanning forest
+// of all the edges from scratch, which is what rerunning a static algorithm
+// after the last batch costs.
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <dynamic_trees/minimum_spanning_forest/include/minimum_spanning_forest.hpp>
+#include <utilities/include/blockRadixSort.h>
+#include <utilities/include/gettime.h>
+#include <utilities/include/parse_command_line.h>
+#include <utilities/include/utils.h>
+
+#include <dynamic_trees/benchmarks/benchmark.hpp>
+
+// Weights are below the number of edges, but the weight of a forest may not be.
+using MinimumSpanningForest =
+  minimum_spanning_forest::IncrementalMinimumSpanningForest<int, int64_t>;
+using Edge = MinimumSpanningForest::Edge;
+
+struct GetWeight {
+  int64_t operator()(const Edge& e) const { return e.weight; }
+};
+
+int FindRoot(int* parents, int v) {
+  while (parents[v] != v) {
+    v = parents[v] = parents[parents[v]];
+  }
+  return v;
+}
+
+// Returns the weight of the minimum spanning forest of the `m` edges in
+// `edges`, whose weights are in [0, `m`), on `n` vertices. Sorts `edges` by
+// weight.
+int64_t StaticMinimumSpanningForest(int n, Edge* edges, int m) {
+  intSort::iSort(edges, m, m, GetWeight());
+  int* parents{pbbs::new_array_no_init<int>(n)};
+  parallel_for (int v = 0; v < n; v++) {
+    parents[v] = v;
+  }
+  int64_t weight{0};
+  for (int i = 0; i < m; i++) {
+    const int u{FindRoot(parents, edges[i].u)};
+    const int v{FindRoot(parents, edges[i].v)};
+    if (u != v) {
+      parents[u] = v;
+      weight += edges[i].weight;
+    }
+  }
+  pbbs::delete_array(parents, n);
+  return weight;
+}
+
+int main(int argc, char** argv) {
+  commandLine P{argc, argv, "[-iters] graph_filename"};
+  const int num_iters{P.getOptionIntValue("-iters", 4)};
+  char* graph_filename{P.getArgument(0)};
+
+  std::cout << "Running with " << nworkers() << " workers" << std::endl;
+  dynamic_trees_benchmark::ReadGraphOutput<> graph_info{
+    dynamic_trees_benchmark::ReadGraph(graph_filename)};
+  const int n{graph_info.num_vertices};
+  const int m{graph_info.num_edges};
+  std::pair<int, int>* graph_edges{graph_info.edges};
+  std::mt19937 generator{0};
+  std::shuffle(graph_edges, graph_edges + m, generator);
+  std::uniform_int_distribution<int> weight_dist{0, std::max(m - 1, 0)};
+  Edge* edges{pbbs::new_array_no_init<Edge>(m)};
+  for (int i = 0; i < m; i++) {
+    edges[i] =
+      Edge{graph_edges[i].first, graph_edges[i].second, weight_dist(generator)};
+  }
+  pbbs::delete_array(graph_edges, m);
+
+  Edge* scratch{pbbs::new_array_no_init<Edge>(m)};
+  vector<double> static_times(num_iters);
+  int64_t static_weight{0};
+  for (int j = 0; j < num_iters; j++) {
+    std::copy(edges, edges + m, scratch);
+    timer static_t; static_t.start();
+    static_weight = StaticMinimumSpanningForest(n, scratch, m);
+    static_times[j] = static_t.stop();
+  }
+  pbbs::delete_array(scratch, m);
+  timer::report_time("static", median(static_times));
+
+  for (int batch_size = 100; ; batch_size *= 10) {
+    batch_size = std::min(batch_size, m);
+    const int num_batches{(m + batch_size - 1) / batch_size};
+    vector<double> batch_times(num_iters);
+    for (int j = 0; j < num_iters; j++) {
+      MinimumSpanningForest forest{n};
+      timer insert_t; insert_t.start();
+      for (int i = 0; i < m; i += batch_size) {
+        forest.BatchInsertEdges(edges + i, std::min(batch_size, m - i));
+      }
+      batch_times[j] = insert_t.stop() / num_batches;
+      if (forest.ForestWeight() != static_weight) {
+        std::cerr << "Forest weights differ" << std::endl;
+        return 1;
+      }
+    }
+    timer::report_time(
+        "insert-" + to_string(batch_size), median(batch_times));
+    if (batch_size == m) {
+      break;
+    }
+  }
+
+  pbbs::delete_array(edges, m);
+  return 0;
+}
@@ -0,0 +1,17 @@
+// Benchmarks the batch-parallel Euler tour tree with edges looked up through a
+// per-vertex adjacency index instead of a hash table.
+#include <dynamic_trees/parallel_euler_tour_tree/include/edge_map.hpp>
+#include <dynamic_trees/parallel_euler_tour_tree/include/element_pool.hpp>
+#include <dynamic_trees/parallel_euler_tour_tree/include/euler_tour_tree.hpp>
+#include <sequence/parallel_skip_list/include/augmented_skip_list.hpp>
+
+#include <dynamic_trees/benchmarks/benchmark.hpp>
+
+int main(int argc, char** argv) {
+  dynamic_trees_benchmark::RunBenchmark<
+      parallel_euler_tour_tree::EulerTourTree<
+        parallel_skip_list::SumAugmentation<int>,
+        parallel_euler_tour_tree::ElementArena,
+        parallel_euler_tour_tree::AdjacencyEdgeMap>>(argc, argv);
+  return 0;
+}
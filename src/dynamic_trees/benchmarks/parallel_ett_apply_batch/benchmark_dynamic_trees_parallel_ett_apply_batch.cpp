@@ -0,0 +1,93 @@
+// Compares the batch-parallel Euler tour tree's fused `ApplyBatch` against
+// applying the same window of updates and queries through separate `BatchCut`,
+// `BatchLink`, and `BatchConnected` calls.
+//
+// For various batch sizes k, construct the forest on all but the first k edges
+// of the input graph. A window then cuts the next k edges, links the first k
+// edges, and asks k connectivity queries between random pairs of vertices.
+// Reports the median time to apply the window both ways.
+#include <algorithm>
+#include <iostream>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <dynamic_trees/parallel_euler_tour_tree/include/euler_tour_tree.hpp>
+#include <utilities/include/gettime.h>
+#include <utilities/include/parse_command_line.h>
+#include <utilities/include/utils.h>
+
+#include <dynamic_trees/benchmarks/benchmark.hpp>
+
+using Forest = parallel_euler_tour_tree::EulerTourTree<>;
+
+void ApplyWindows(Forest* forest, std::pair<int, int>* edges,
+    std::pair<int, int>* queries, bool* query_answers,
+    int batch_size, int num_iters, int m) {
+  vector<double> separate_times(num_iters);
+  vector<double> fused_times(num_iters);
+  std::pair<int, int>* window_cuts{edges + batch_size};
+  std::pair<int, int>* window_links{edges};
+
+  for (int j = 0; j < num_iters; j++) {
+    forest->BatchLink(edges + batch_size, m - batch_size);  // construct
+
+    timer separate_t; separate_t.start();
+    forest->BatchCut(window_cuts, batch_size);
+    forest->BatchLink(window_links, batch_size);
+    forest->BatchConnected(queries, batch_size, query_answers);
+    separate_times[j] = separate_t.stop();
+
+    // Undo the window.
+    forest->BatchCut(window_links, batch_size);
+    forest->BatchLink(window_cuts, batch_size);
+
+    timer fused_t; fused_t.start();
+    forest->ApplyBatch(window_cuts, batch_size, window_links, batch_size,
+        queries, batch_size, query_answers);
+    fused_times[j] = fused_t.stop();
+
+    // destruct
+    forest->BatchCut(edges, batch_size);
+    forest->BatchCut(edges + 2 * batch_size, m - 2 * batch_size);
+  }
+  const string batch_str{to_string(batch_size)};
+  timer::report_time_no_newline("separate-" + batch_str, median(separate_times));
+  timer::report_time("fused-" + batch_str, median(fused_times));
+}
+
+int main(int argc, char** argv) {
+  commandLine P{argc, argv, "[-iters] graph_filename"};
+  const int num_iters{P.getOptionIntValue("-iters", 4)};
+  char* graph_filename{P.getArgument(0)};
+
+  std::cout << "Running with " << nworkers() << " workers" << std::endl;
+  dynamic_trees_benchmark::ReadGraphOutput<> graph_info{
+    dynamic_trees_benchmark::ReadGraph(graph_filename)};
+  const int m{graph_info.num_edges};
+  std::pair<int, int>* edges{graph_info.edges};
+  std::mt19937 generator{0};
+  std::shuffle(edges, edges + m, generator);
+
+  std::uniform_int_distribution<int>
+    vertex_dist{0, graph_info.num_vertices - 1};
+  std::pair<int, int>* queries{pbbs::new_array_no_init<pair<int, int>>(m)};
+  for (int i = 0; i < m; i++) {
+    queries[i] = std::make_pair(vertex_dist(generator), vertex_dist(generator));
+  }
+  bool* query_answers{pbbs::new_array_no_init<bool>(m)};
+
+  Forest forest{graph_info.num_vertices};
+
+  for (int batch_size = 100; 2 * batch_size <= m; batch_size *= 10) {
+    ApplyWindows(
+        &forest, edges, queries, query_answers, batch_size, num_iters, m);
+  }
+  ApplyWindows(&forest, edges, queries, query_answers, m / 2, num_iters, m);
+
+  pbbs::delete_array(query_answers, m);
+  pbbs::delete_array(queries, m);
+  pbbs::delete_array(edges, m);
+  return 0;
+}
@@ -0,0 +1,102 @@
+// Benchmarks loading a whole forest into an empty batch-parallel Euler tour
+// tree through `Build` and through `Load` against loading it through
+// `BatchLink`.
+//
+// For `-iters` iterations, constructs an empty forest on the vertices of the
+// input graph and loads all of its edges with `BatchLink`, then does the same
+// with `Build`, and then restores the forest from a snapshot that `Save` wrote
+// to `-snapshot` with `Load`. Reports the median time of each.
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <dynamic_trees/benchmarks/benchmark.hpp>
+#include <dynamic_trees/parallel_euler_tour_tree/include/euler_tour_tree.hpp>
+#include <utilities/include/gettime.h>
+#include <utilities/include/parse_command_line.h>
+#include <utilities/include/utils.h>
+
+using Forest = parallel_euler_tour_tree::EulerTourTree<>;
+
+int main(int argc, char** argv) {
+  commandLine P{argc, argv, "[-iters] [-snapshot] graph_filename"};
+  const int num_iters{P.getOptionIntValue("-iters", 4)};
+  const std::string snapshot_path{
+    P.getOptionValue("-snapshot", "/tmp/ett_build_snapshot")};
+  char* graph_filename{P.getArgument(0)};
+
+  std::cout << "Running with " << nworkers() << " workers" << std::endl;
+  dynamic_trees_benchmark::ReadGraphOutput<int> graph_info{
+    dynamic_trees_benchmark::ReadGraph(graph_filename)};
+  const int n{graph_info.num_vertices};
+  const int m{graph_info.num_edges};
+  std::pair<int, int>* edges{graph_info.edges};
+  std::mt19937 generator{0};
+  std::shuffle(edges, edges + m, generator);
+
+  std::uniform_int_distribution<int> vertex_dist{0, n - 1};
+  constexpr int kNumQueries{1000};
+  std::pair<int, int> queries[kNumQueries];
+  for (int i = 0; i < kNumQueries; i++) {
+    queries[i] = std::make_pair(vertex_dist(generator), vertex_dist(generator));
+  }
+  bool link_answers[kNumQueries];
+  bool build_answers[kNumQueries];
+  bool load_answers[kNumQueries];
+
+  {
+    Forest forest{n};
+    forest.Build(edges, m);
+    if (!forest.Save(snapshot_path)) {
+      std::cerr << "Could not write " << snapshot_path << std::endl;
+      return 1;
+    }
+  }
+
+  vector<double> link_times(num_iters);
+  vector<double> build_times(num_iters);
+  vector<double> load_times(num_iters);
+  for (int j = 0; j < num_iters; j++) {
+    {
+      Forest forest{n};
+      timer link_t; link_t.start();
+      forest.BatchLink(edges, m);
+      link_times[j] = link_t.stop();
+      forest.BatchConnected(queries, kNumQueries, link_answers);
+    }
+    {
+      Forest forest{n};
+      timer build_t; build_t.start();
+      forest.Build(edges, m);
+      build_times[j] = build_t.stop();
+      forest.BatchConnected(queries, kNumQueries, build_answers);
+    }
+    {
+      Forest forest{n};
+      timer load_t; load_t.start();
+      const bool loaded{forest.Load(snapshot_path)};
+      load_times[j] = load_t.stop();
+      if (!loaded) {
+        std::cerr << "Could not load " << snapshot_path << std::endl;
+        return 1;
+      }
+      forest.BatchConnected(queries, kNumQueries, load_answers);
+    }
+    if (!std::equal(link_answers, link_answers + kNumQueries, build_answers) ||
+        !std::equal(link_answers, link_answers + kNumQueries, load_answers)) {
+      std::cerr << "Forests differ" << std::endl;
+      return 1;
+    }
+  }
+  timer::report_time_no_newline("batch-link", median(link_times));
+  timer::report_time_no_newline("build", median(build_times));
+  timer::report_time("load", median(load_times));
+
+  std::remove(snapshot_path.c_str());
+  pbbs::delete_array(edges, m);
+  return 0;
+}
@@ -0,0 +1,71 @@
+// Benchmarks `EulerTourTree::ComputeComponentLabels` against computing the
+// same labels from scratch with the static connectivity algorithm in
+// "static_connectivity/ndHybridCC".
+//
+// For each fraction of the input graph's edges, links that many edges into the
+// forest, then reports the median time for the forest to label its components
+// and the median time for the static algorithm to label the components of the
+// same edges.
+#include <algorithm>
+#include <iostream>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <dynamic_trees/parallel_euler_tour_tree/include/euler_tour_tree.hpp>
+#include <utilities/include/gettime.h>
+#include <utilities/include/parse_command_line.h>
+#include <utilities/include/utils.h>
+
+#include <dynamic_trees/benchmarks/benchmark.hpp>
+#include <dynamic_trees/benchmarks/parallel_ett_component_labels/static_connectivity.hpp>
+
+using Forest = parallel_euler_tour_tree::EulerTourTree<>;
+
+int main(int argc, char** argv) {
+  commandLine P{argc, argv, "[-iters] graph_filename"};
+  const int num_iters{P.getOptionIntValue("-iters", 4)};
+  char* graph_filename{P.getArgument(0)};
+
+  std::cout << "Running with " << nworkers() << " workers" << std::endl;
+  dynamic_trees_benchmark::ReadGraphOutput<> graph_info{
+    dynamic_trees_benchmark::ReadGraph(graph_filename)};
+  const int n{graph_info.num_vertices};
+  const int m{graph_info.num_edges};
+  std::pair<int, int>* edges{graph_info.edges};
+  std::mt19937 generator{0};
+  std::shuffle(edges, edges + m, generator);
+
+  int* labels{pbbs::new_array_no_init<int>(n)};
+  Forest forest{n};
+  int num_linked{0};
+  // Fractions of the edges linked, out of 8.
+  for (int eighths : {1, 4, 8}) {
+    const int num_edges{
+      static_cast<int>(static_cast<int64_t>(m) * eighths / 8)};
+    forest.BatchLink(edges + num_linked, num_edges - num_linked);
+    num_linked = num_edges;
+
+    vector<double> ett_times(num_iters);
+    vector<double> static_times(num_iters);
+    int num_components{0};
+    for (int j = 0; j < num_iters; j++) {
+      timer ett_t; ett_t.start();
+      num_components = forest.ComputeComponentLabels(labels);
+      ett_times[j] = ett_t.stop();
+
+      static_times[j] = TimeStaticConnectivity(n, edges, num_edges);
+    }
+
+    const string edges_str{to_string(num_edges)};
+    std::cout << "components-" << edges_str << " : " << num_components
+      << std::endl;
+    timer::report_time_no_newline("ett-" + edges_str, median(ett_times));
+    timer::report_time("static-" + edges_str, median(static_times));
+  }
+
+  pbbs::delete_array(labels, n);
+  pbbs::delete_array(edges, m);
+  return 0;
+}
@@ -0,0 +1,48 @@
+#include <dynamic_trees/benchmarks/parallel_ett_component_labels/static_connectivity.hpp>
+
+// The static connectivity code brings its own copies of the PBBS utilities,
+// which clash with the ones in `src/utilities` that the rest of the benchmark
+// uses. Wrapping it in a namespace keeps the two sets of definitions apart.
+// The system headers it includes are included first so that they stay out of
+// the namespace.
+#include <limits.h>
+#include <malloc.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <sys/time.h>
+#include <algorithm>
+#include <cassert>
+#include <cilk/cilk.h>
+#include <cilk/cilk_api.h>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+namespace nd_hybrid_cc {
+#include <dynamic_trees/benchmarks/static_connectivity/ndHybridCC/CC.C>
+}  // namespace nd_hybrid_cc
+
+double TimeStaticConnectivity(int n, const std::pair<int, int>* edges, int m) {
+  using nd_hybrid_cc::edge;
+  using nd_hybrid_cc::intT;
+  edge<intT>* edge_list{newA(edge<intT>, m)};
+  parallel_for (intT i = 0; i < m; i++) {
+    edge_list[i] = edge<intT>{edges[i].first, edges[i].second};
+  }
+  nd_hybrid_cc::graph<intT> graph{nd_hybrid_cc::graphFromEdges(
+      nd_hybrid_cc::edgeArray<intT>(edge_list, n, n, m), true)};
+  free(edge_list);
+
+  // `CC` frees the graph.
+  nd_hybrid_cc::timer static_t; static_t.start();
+  intT* labels{nd_hybrid_cc::CC(graph, 0.1)};
+  const double time{static_t.stop()};
+  free(labels);
+  return time;
+}
@@ -0,0 +1,9 @@
+#pragma once
+
+#include <utility>
+
+// Returns the time in seconds that the static connectivity algorithm in
+// "static_connectivity/ndHybridCC" takes to label the connected components of
+// the `n`-vertex graph with the `m` edges in `edges`. Building the algorithm's
+// graph representation from `edges` is not timed.
+double TimeStaticConnectivity(int n, const std::pair<int, int>* edges, int m);
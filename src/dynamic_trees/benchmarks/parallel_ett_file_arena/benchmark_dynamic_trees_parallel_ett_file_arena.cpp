@@ -0,0 +1,117 @@
+// Benchmarks the batch-parallel Euler tour tree built in a memory-mapped
+// `file_arena::FileArena`, where every link is an offset instead of a pointer.
+//
+// Runs the same batches as `parallel_ett`, whose times are those of raw
+// pointers, on a forest in an arena backed by the file `-arena`, which is
+// removed afterwards. Then, for `-iters` iterations, closes the arena, opens it
+// again, and answers the connectivity queries on the forest found there.
+// Reports the median time to reopen the arena and the median time of the first
+// batch of queries after reopening, which pays for reading the forest back in.
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <unistd.h>
+
+#include <dynamic_trees/benchmarks/benchmark.hpp>
+#include <dynamic_trees/parallel_euler_tour_tree/include/euler_tour_tree.hpp>
+#include <sequence/parallel_skip_list/include/augmented_skip_list.hpp>
+#include <sequence/parallel_skip_list/include/file_arena.hpp>
+#include <utilities/include/gettime.h>
+#include <utilities/include/parse_command_line.h>
+#include <utilities/include/utils.h>
+
+using Forest = parallel_euler_tour_tree::EulerTourTree<
+  parallel_skip_list::SumAugmentation<int>,
+  parallel_euler_tour_tree::ElementArena,
+  parallel_euler_tour_tree::HashEdgeMap,
+  int,
+  file_arena::FileArenaStorage>;
+
+// Bytes of arena to reserve per vertex. The file is sparse, so space that the
+// forest never touches costs nothing.
+constexpr size_t kArenaBytesPerVertex{1 << 10};
+
+int main(int argc, char** argv) {
+  commandLine P{argc, argv, "[-iters] [-arena] graph_filename"};
+  const int num_iters{P.getOptionIntValue("-iters", 4)};
+  // Runs that go concurrently get arenas of their own by default.
+  const std::string arena_path{P.getOptionValue("-arena",
+      "/tmp/ett_file_arena_" + to_string(getpid()))};
+  char* graph_filename{P.getArgument(0)};
+
+  std::cout << "Running with " << nworkers() << " workers" << std::endl;
+  dynamic_trees_benchmark::ReadGraphOutput<int> graph_info{
+    dynamic_trees_benchmark::ReadGraph(graph_filename)};
+  const int n{graph_info.num_vertices};
+  const int m{graph_info.num_edges};
+  std::pair<int, int>* edges{graph_info.edges};
+  std::mt19937 generator{0};
+  std::shuffle(edges, edges + m, generator);
+
+  // Connectivity queries between uniformly random pairs of vertices.
+  std::uniform_int_distribution<int> vertex_dist{0, n - 1};
+  std::pair<int, int>* queries{
+    pbbs::new_array_no_init<pair<int, int>>(m)};
+  for (int i = 0; i < m; i++) {
+    queries[i] = std::make_pair(vertex_dist(generator), vertex_dist(generator));
+  }
+  bool* query_answers{pbbs::new_array_no_init<bool>(m)};
+  bool* reopened_answers{pbbs::new_array_no_init<bool>(m)};
+
+  file_arena::FileArena arena;
+  const size_t capacity{static_cast<size_t>(n) * kArenaBytesPerVertex};
+  if (!arena.Create(arena_path, capacity)) {
+    std::cerr << "Could not create " << arena_path << std::endl;
+    return 1;
+  }
+  Forest* forest{arena.New<Forest>(n)};
+  arena.SetRoot(forest);
+
+  for (int batch_size = 100; batch_size < m; batch_size *= 10) {
+    dynamic_trees_benchmark::UpdateForest(
+        forest, edges, queries, query_answers, batch_size, num_iters, m);
+  }
+  dynamic_trees_benchmark::UpdateForest(
+      forest, edges, queries, query_answers, m, num_iters, m);
+
+  forest->BatchLink(edges, m);
+  forest->BatchConnected(queries, m, query_answers);
+  vector<double> reopen_times(num_iters);
+  vector<double> first_query_times(num_iters);
+  for (int j = 0; j < num_iters; j++) {
+    arena.Sync();
+    arena.Close();
+    timer reopen_t; reopen_t.start();
+    const bool opened{arena.Open(arena_path)};
+    forest = opened ? arena.GetRoot<Forest>() : nullptr;
+    reopen_times[j] = reopen_t.stop();
+    if (!opened || forest == nullptr) {
+      std::cerr << "Could not reopen " << arena_path << std::endl;
+      return 1;
+    }
+
+    timer query_t; query_t.start();
+    forest->BatchConnected(queries, m, reopened_answers);
+    first_query_times[j] = query_t.stop();
+    if (!std::equal(query_answers, query_answers + m, reopened_answers)) {
+      std::cerr << "Reopened forest differs" << std::endl;
+      return 1;
+    }
+  }
+  timer::report_time_no_newline("reopen", median(reopen_times));
+  timer::report_time("first-query-" + to_string(m), median(first_query_times));
+
+  arena.Delete(forest);
+  arena.Close();
+  std::remove(arena_path.c_str());
+  pbbs::delete_array(reopened_answers, m);
+  pbbs::delete_array(query_answers, m);
+  pbbs::delete_array(queries, m);
+  pbbs::delete_array(edges, m);
+  return 0;
+}
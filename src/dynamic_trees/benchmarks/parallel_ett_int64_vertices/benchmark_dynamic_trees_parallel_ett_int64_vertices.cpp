@@ -0,0 +1,21 @@
+// Benchmarks the batch-parallel Euler tour tree with 64-bit vertex ids, which
+// widens the tour elements and the edge map keys.
+#include <cstdint>
+
+#include <dynamic_trees/parallel_euler_tour_tree/include/edge_map.hpp>
+#include <dynamic_trees/parallel_euler_tour_tree/include/element_pool.hpp>
+#include <dynamic_trees/parallel_euler_tour_tree/include/euler_tour_tree.hpp>
+#include <sequence/parallel_skip_list/include/augmented_skip_list.hpp>
+
+#include <dynamic_trees/benchmarks/benchmark.hpp>
+
+int main(int argc, char** argv) {
+  dynamic_trees_benchmark::RunBenchmark<
+      parallel_euler_tour_tree::EulerTourTree<
+        parallel_skip_list::SumAugmentation<int>,
+        parallel_euler_tour_tree::ElementArena,
+        parallel_euler_tour_tree::HashEdgeMap,
+        int64_t>,
+      int64_t>(argc, argv);
+  return 0;
+}
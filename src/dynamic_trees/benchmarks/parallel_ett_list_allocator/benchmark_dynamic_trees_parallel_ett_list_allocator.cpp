@@ -0,0 +1,16 @@
+// Benchmarks the batch-parallel Euler tour tree with edge elements allocated on
+// demand from the global `list_allocator` instead of from a preallocated
+// per-forest arena.
+#include <dynamic_trees/parallel_euler_tour_tree/include/element_pool.hpp>
+#include <dynamic_trees/parallel_euler_tour_tree/include/euler_tour_tree.hpp>
+#include <sequence/parallel_skip_list/include/augmented_skip_list.hpp>
+
+#include <dynamic_trees/benchmarks/benchmark.hpp>
+
+int main(int argc, char** argv) {
+  dynamic_trees_benchmark::RunBenchmark<
+      parallel_euler_tour_tree::EulerTourTree<
+        parallel_skip_list::SumAugmentation<int>,
+        parallel_euler_tour_tree::ListAllocatorPool>>(argc, argv);
+  return 0;
+}
@@ -0,0 +1,81 @@
+// Benchmarks throughput when many independent batch-parallel Euler tour trees
+// are constructed, updated, and destroyed concurrently.
+//
+// For each iteration, `-forests` forests are run in parallel. Each one is
+// constructed on the input graph's vertices, batch links every edge, batch cuts
+// every edge, and is destroyed. Reports the median wall-clock time of each of
+// those phases across all forests.
+#include <algorithm>
+#include <iostream>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <dynamic_trees/parallel_euler_tour_tree/include/euler_tour_tree.hpp>
+#include <utilities/include/gettime.h>
+#include <utilities/include/parse_command_line.h>
+#include <utilities/include/utils.h>
+
+#include <dynamic_trees/benchmarks/benchmark.hpp>
+
+using Forest = parallel_euler_tour_tree::EulerTourTree<>;
+
+int main(int argc, char** argv) {
+  commandLine P{argc, argv, "[-iters] [-forests] graph_filename"};
+  const int num_iters{P.getOptionIntValue("-iters", 4)};
+  const int num_forests{P.getOptionIntValue("-forests", 8)};
+  char* graph_filename{P.getArgument(0)};
+
+  std::cout << "Running with " << nworkers() << " workers" << std::endl;
+  dynamic_trees_benchmark::ReadGraphOutput<> graph_info{
+    dynamic_trees_benchmark::ReadGraph(graph_filename)};
+  const int n{graph_info.num_vertices};
+  const int m{graph_info.num_edges};
+  std::pair<int, int>* edges{graph_info.edges};
+  std::mt19937 generator{0};
+  std::shuffle(edges, edges + m, generator);
+  // Calibrate before timing construction, which would otherwise pay for it.
+  Forest::CalibratedRebuildRatio();
+
+  const int num_samples{num_iters * num_forests};
+  vector<double> construct_times(num_samples);
+  vector<double> link_times(num_samples);
+  vector<double> cut_times(num_samples);
+  vector<double> destroy_times(num_samples);
+  vector<double> total_times(num_iters);
+
+  for (int j = 0; j < num_iters; j++) {
+    timer total_t; total_t.start();
+    parallel_for (int f = 0; f < num_forests; f++) {
+      const int sample{j * num_forests + f};
+
+      timer construct_t; construct_t.start();
+      Forest* forest{new Forest{n}};
+      construct_times[sample] = construct_t.stop();
+
+      timer link_t; link_t.start();
+      forest->BatchLink(edges, m);
+      link_times[sample] = link_t.stop();
+
+      timer cut_t; cut_t.start();
+      forest->BatchCut(edges, m);
+      cut_times[sample] = cut_t.stop();
+
+      timer destroy_t; destroy_t.start();
+      delete forest;
+      destroy_times[sample] = destroy_t.stop();
+    }
+    total_times[j] = total_t.stop();
+  }
+
+  const string forests_str{to_string(num_forests)};
+  timer::report_time_no_newline("construct", median(construct_times));
+  timer::report_time_no_newline("link", median(link_times));
+  timer::report_time_no_newline("cut", median(cut_times));
+  timer::report_time_no_newline("destroy", median(destroy_times));
+  timer::report_time("total-" + forests_str, median(total_times));
+
+  pbbs::delete_array(edges, m);
+  return 0;
+}
@@ -0,0 +1,81 @@
+// Benchmarks the latency of connectivity queries against the length of the
+// Euler tours that they search.
+//
+// Builds a forest on `-n` vertices whose trees are paths of `-length` vertices
+// each, for each length that is a power of 4 up to `-n`. Each tree's tour
+// holds about 2 * `length` elements. Then asks `-queries` `IsConnected`
+// queries between uniformly random vertices of the same tree one at a time and
+// reports the median time per query in nanoseconds over `-iters` rounds.
+#include <algorithm>
+#include <iostream>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <dynamic_trees/parallel_euler_tour_tree/include/euler_tour_tree.hpp>
+#include <utilities/include/gettime.h>
+#include <utilities/include/parse_command_line.h>
+#include <utilities/include/utils.h>
+
+using Forest = parallel_euler_tour_tree::EulerTourTree<>;
+
+int main(int argc, char** argv) {
+  commandLine P{argc, argv, "[-iters] [-n] [-queries]"};
+  const int num_iters{P.getOptionIntValue("-iters", 4)};
+  const int n{P.getOptionIntValue("-n", 1 << 20)};
+  const int num_queries{P.getOptionIntValue("-queries", 1000000)};
+
+  std::cout << "Running with " << nworkers() << " workers" << std::endl;
+  std::mt19937 generator{0};
+  std::pair<int, int>* edges{
+    pbbs::new_array_no_init<std::pair<int, int>>(n)};
+  std::pair<int, int>* queries{
+    pbbs::new_array_no_init<std::pair<int, int>>(num_queries)};
+  for (int length = 4; ; length *= 4) {
+    length = std::min(length, n);
+    const int num_trees{n / length};
+    int num_edges{0};
+    for (int t = 0; t < num_trees; t++) {
+      for (int i = 1; i < length; i++) {
+        edges[num_edges++] =
+          std::make_pair(t * length + i - 1, t * length + i);
+      }
+    }
+    Forest forest{n};
+    forest.BatchLink(edges, num_edges);
+
+    std::uniform_int_distribution<int> tree_dist{0, num_trees - 1};
+    std::uniform_int_distribution<int> offset_dist{0, length - 1};
+    for (int i = 0; i < num_queries; i++) {
+      const int tree_start{tree_dist(generator) * length};
+      queries[i] = std::make_pair(
+          tree_start + offset_dist(generator),
+          tree_start + offset_dist(generator));
+    }
+
+    vector<double> query_times(num_iters);
+    for (int j = 0; j < num_iters; j++) {
+      int num_connected{0};
+      timer query_t; query_t.start();
+      for (int i = 0; i < num_queries; i++) {
+        num_connected +=
+          forest.IsConnected(queries[i].first, queries[i].second);
+      }
+      query_times[j] = query_t.stop() / num_queries * 1e9;
+      if (num_connected != num_queries) {
+        std::cerr << "Queries answered incorrectly" << std::endl;
+        return 1;
+      }
+    }
+    timer::report_time(
+        "query-ns-" + to_string(length), median(query_times));
+    if (length == n) {
+      break;
+    }
+  }
+
+  pbbs::delete_array(queries, num_queries);
+  pbbs::delete_array(edges, n);
+  return 0;
+}
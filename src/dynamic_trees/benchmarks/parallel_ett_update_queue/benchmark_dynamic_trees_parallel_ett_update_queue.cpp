@@ -0,0 +1,144 @@
+// Benchmarks submitting single-edge updates to a batch-parallel Euler tour
+// tree through an `UpdateQueue` from many threads at once.
+//
+// Loads the edges of the input graph, which must be a forest, into a forest.
+// Then `-producers` threads each repeatedly pick a random edge of their own
+// share of the edges, cut it if it is present and link it otherwise, and wait
+// for the update to be applied. Arrivals follow a Poisson process whose total
+// rate is each of 10^3, 10^4, ..., `-max_rate` updates per second in turn, and
+// each rate runs for `-seconds` seconds. A producer that falls behind its
+// arrivals submits right away, so the offered rate may exceed the throughput.
+//
+// For each rate, reports the throughput in updates per second, the mean
+// number of updates per applied batch, and the median and 99th percentile
+// latency in microseconds from submitting an update to its future being ready.
+// Batches are capped at `-max_batch` updates and `-max_delay_us` microseconds.
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <dynamic_trees/benchmarks/benchmark.hpp>
+#include <dynamic_trees/parallel_euler_tour_tree/include/euler_tour_tree.hpp>
+#include <dynamic_trees/parallel_euler_tour_tree/include/update_queue.hpp>
+#include <utilities/include/parse_command_line.h>
+#include <utilities/include/utils.h>
+
+using Forest = parallel_euler_tour_tree::EulerTourTree<>;
+using Queue = parallel_euler_tour_tree::UpdateQueue<Forest>;
+using Clock = std::chrono::steady_clock;
+
+// Returns the `fraction` quantile of `values`, which must be nonempty.
+double Quantile(std::vector<double>* values, double fraction) {
+  const size_t index{
+    static_cast<size_t>(fraction * (values->size() - 1))};
+  std::nth_element(values->begin(), values->begin() + index, values->end());
+  return (*values)[index];
+}
+
+int main(int argc, char** argv) {
+  commandLine P{argc, argv,
+    "[-producers] [-seconds] [-max_rate] [-max_batch] [-max_delay_us] "
+    "graph_filename"};
+  const int num_producers{P.getOptionIntValue("-producers", 32)};
+  const double seconds{P.getOptionDoubleValue("-seconds", 2.0)};
+  const double max_rate{P.getOptionDoubleValue("-max_rate", 1e6)};
+  const size_t max_batch{
+    static_cast<size_t>(P.getOptionLongValue("-max_batch", 1024))};
+  const std::chrono::microseconds max_delay{
+    P.getOptionLongValue("-max_delay_us", 1000)};
+  char* graph_filename{P.getArgument(0)};
+
+  std::cout << "Running with " << nworkers() << " workers and "
+    << num_producers << " producers" << std::endl;
+  dynamic_trees_benchmark::ReadGraphOutput<int> graph_info{
+    dynamic_trees_benchmark::ReadGraph(graph_filename)};
+  const int n{graph_info.num_vertices};
+  const int m{graph_info.num_edges};
+  std::pair<int, int>* edges{graph_info.edges};
+
+  Forest forest{n};
+  forest.Build(edges, m);
+  // Producer `p` owns edges `p`, `p` + `num_producers`, ..., and remembers
+  // which of them are present. Any subset of the edges of a forest is a
+  // forest, so every link is valid.
+  std::vector<std::vector<bool>> is_present(num_producers);
+  for (int p = 0; p < num_producers; p++) {
+    is_present[p].assign((m - p + num_producers - 1) / num_producers, true);
+  }
+
+  for (double rate = 1e3; rate <= max_rate; rate *= 10) {
+    std::vector<std::vector<double>> latencies(num_producers);
+    {
+      Queue queue{&forest, max_batch, max_delay};
+      const Clock::time_point start{Clock::now()};
+      const Clock::time_point end{
+        start + std::chrono::duration_cast<Clock::duration>(
+            std::chrono::duration<double>(seconds))};
+      std::vector<std::thread> producers;
+      for (int p = 0; p < num_producers; p++) {
+        producers.emplace_back([&, p] {
+          std::mt19937 generator{static_cast<std::mt19937::result_type>(p)};
+          std::exponential_distribution<double> gap_dist{
+            rate / num_producers};
+          std::vector<bool>& present{is_present[p]};
+          if (present.empty()) {
+            return;
+          }
+          std::uniform_int_distribution<size_t> edge_dist{
+            0, present.size() - 1};
+          Clock::time_point arrival{start};
+          while (true) {
+            arrival += std::chrono::duration_cast<Clock::duration>(
+                std::chrono::duration<double>(gap_dist(generator)));
+            if (arrival >= end) {
+              break;
+            }
+            std::this_thread::sleep_until(arrival);
+            const size_t i{edge_dist(generator)};
+            const std::pair<int, int> edge{edges[p + i * num_producers]};
+            const Clock::time_point submitted{Clock::now()};
+            std::shared_future<void> applied{present[i]
+              ? queue.Cut(edge.first, edge.second)
+              : queue.Link(edge.first, edge.second)};
+            present[i] = !present[i];
+            applied.wait();
+            latencies[p].push_back(
+                std::chrono::duration<double, std::micro>(
+                  Clock::now() - submitted).count());
+          }
+        });
+      }
+      for (std::thread& producer : producers) {
+        producer.join();
+      }
+      queue.Flush();
+      const double elapsed{
+        std::chrono::duration<double>(Clock::now() - start).count()};
+
+      std::vector<double> all_latencies;
+      for (const std::vector<double>& producer_latencies : latencies) {
+        all_latencies.insert(all_latencies.end(),
+            producer_latencies.begin(), producer_latencies.end());
+      }
+      const size_t num_batches{queue.NumBatchesApplied()};
+      std::cout << "rate : " << rate
+        << " throughput : " << all_latencies.size() / elapsed
+        << " batch-size : "
+        << static_cast<double>(all_latencies.size()) /
+          std::max<size_t>(num_batches, 1);
+      if (all_latencies.empty()) {
+        std::cout << std::endl;
+      } else {
+        std::cout << " p50-us : " << Quantile(&all_latencies, 0.5)
+          << " p99-us : " << Quantile(&all_latencies, 0.99) << std::endl;
+      }
+    }
+  }
+
+  pbbs::delete_array(edges, m);
+  return 0;
+}
@@ -5,6 +5,14 @@ threads=(2 4 8 16 32 64 72 144)
 iters=3
 graphs=('binary_tree' 'star' 'path' 'recursive_tree')
 
+parallel_targets=('parallel_ett' 'parallel_ett_list_allocator'
+                  'parallel_ett_adjacency_edge_map'
+                  'parallel_ett_concurrent_ht_edge_map'
+                  'parallel_ett_int64_vertices'
+                  'parallel_ett_file_arena'
+                  'parallel_ett_component_labels'
+                  'parallel_ett_build'
+                  'minimum_spanning_forest')
 sequential_targets=('link_cut_tree' 'skip_list_ett' 'splay_tree_ett')
 bin_dir=$(git rev-parse --show-toplevel)/bin
 graphs_dir='data/graphs'
@@ -41,27 +49,34 @@ wait_for_processes () {
 mkdir $output_dir
 rm -i $output_dir/*
 
-cd parallel_ett
-make -s
-benchmark_bin=${bin_dir}/benchmark_dynamic_trees_parallel_ett
-for g in ${graphs[@]}
+for target in ${parallel_targets[@]}
 do
-  get_graph_file $g
-  get_output_file 'parallel_ett' $g
-  for t in ${threads[@]}
+  cd $target
+  make -s
+  benchmark_bin=${bin_dir}/benchmark_dynamic_trees_${target}
+  for g in ${graphs[@]}
   do
-    CILK_NWORKERS=$t numactl -i all $benchmark_bin -iters $iters $graph_file >> $output_file
+    get_graph_file $g
+    get_output_file $target $g
+    for t in ${threads[@]}
+    do
+      CILK_NWORKERS=$t numactl -i all $benchmark_bin -iters $iters $graph_file >> $output_file
+    done
   done
+  cd ..
 done
 
-for g in ${graphs[@]}
+for target in ${parallel_targets[@]}
 do
-  get_graph_file $g
-  get_output_file 'parallel_ett' $g
-  CILK_NWORKERS=1 $benchmark_bin -iters $iters $graph_file >> $output_file &
-  save_last_process_id
+  benchmark_bin=${bin_dir}/benchmark_dynamic_trees_${target}
+  for g in ${graphs[@]}
+  do
+    get_graph_file $g
+    get_output_file $target $g
+    CILK_NWORKERS=1 $benchmark_bin -iters $iters $graph_file >> $output_file &
+    save_last_process_id
+  done
 done
-cd ..
 
 for target in ${sequential_targets[@]}
 do
@@ -30,6 +30,8 @@ class EulerTourTree {
   void Cut(int u, int v);
 
   bool* BatchConnected(std::pair<int, int>* queries, int len);
+  // Writes the answers into [out] instead of allocating a new array.
+  void BatchConnected(std::pair<int, int>* queries, int len, bool* out);
   // Inserting all links in [links] must keep the graph acylic.
   void BatchLink(std::pair<int, int>* links, int len);
   // All edges in [cuts] must be in the graph, and no edges may be repeated.
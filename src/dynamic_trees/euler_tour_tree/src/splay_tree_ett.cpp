@@ -55,10 +55,15 @@ void EulerTourTree::Cut(int u, int v) {
 
 bool* EulerTourTree::BatchConnected(pair<int, int>* queries, int len) {
   bool* ans = new bool[len];
+  BatchConnected(queries, len, ans);
+  return ans;
+}
+
+void EulerTourTree::BatchConnected(
+    pair<int, int>* queries, int len, bool* out) {
   for (int i = 0; i < len; i++) {
-    ans[i] = IsConnected(queries[i].first, queries[i].second);
+    out[i] = IsConnected(queries[i].first, queries[i].second);
   }
-  return ans;
 }
 
 void EulerTourTree::BatchLink(pair<int, int>* links, int len) {
@@ -1,25 +1,378 @@
 #pragma once
 
 #include <algorithm>
+#include <type_traits>
+#include <utility>
 
 namespace link_cut_tree {
 
+template <typename Weight, bool kPathMax>
 class Node;
 
+// Sequential link-cut tree over vertices 0, 1, ..., `num_verts` - 1.
+//
+// If `kPathMax` is true, the tree can also find the heaviest edge on the path
+// between two vertices. Edges added through `LinkWeighted` are nodes of their
+// own that sit between the nodes of their endpoints, so that the weight of an
+// edge is a weight on a node. Nodes 0, 1, ..., `num_verts` - 1 are vertices and
+// carry no weight, and nodes `num_verts`, `num_verts` + 1, ... are edge nodes.
+// Edges added through `BatchLink` have no node and no weight. `Weight` must be
+// ordered by `<`. Keeping the heaviest edges up to date costs time on every
+// rotation, so only trees with `kPathMax` set pay for it; the weighted
+// functions do not compile otherwise.
+//
+// Every operation takes O(log n) amortized time per edge or query. Even
+// queries restructure the tree, so no two calls may run concurrently.
+template <typename Vertex = int, typename Weight = int, bool kPathMax = false>
 class LinkCutTree {
  public:
-  LinkCutTree(int _num_verts);
+  LinkCutTree(Vertex _num_verts);
+  // Also makes room for `num_edge_nodes` edge nodes for `LinkWeighted`.
+  LinkCutTree(Vertex _num_verts, Vertex num_edge_nodes);
   ~LinkCutTree();
-  
-  bool* BatchConnected(std::pair<int, int>* queries, int len);
+  LinkCutTree(const LinkCutTree&) = delete;
+  LinkCutTree& operator=(const LinkCutTree&) = delete;
+
+  bool* BatchConnected(std::pair<Vertex, Vertex>* queries, Vertex len);
+  // Writes the answers into [out] instead of allocating a new array.
+  void BatchConnected(std::pair<Vertex, Vertex>* queries, Vertex len, bool* out);
   // Inserting all links in [links] must keep the graph acylic.
-  void BatchLink(std::pair<int, int>* links, int len);
+  void BatchLink(std::pair<Vertex, Vertex>* links, Vertex len);
   // All edges in [cuts] must be in the graph, and no edges may be repeated.
-  void BatchCut(std::pair<int, int>* cuts, int len);
+  void BatchCut(std::pair<Vertex, Vertex>* cuts, Vertex len);
+
+  bool IsConnected(Vertex u, Vertex v);
+  // Returns the node at the root of the tree containing [v]. The root stays
+  // the same until the tree is linked, cut, or rerooted, which `LinkWeighted`,
+  // `CutWeighted`, `PathMax`, and `Lca` all do.
+  Vertex FindRoot(Vertex v);
+  // [u] and [v] must be vertices in the same tree as [root]. Returns their
+  // lowest common ancestor when the tree is rooted at [root].
+  Vertex Lca(Vertex root, Vertex u, Vertex v);
+  // Adds edge {[u], [v]} with weight [weight] as edge node [edge], which must
+  // not be in use. [u] and [v] must be in different trees.
+  void LinkWeighted(Vertex u, Vertex v, Vertex edge, Weight weight);
+  // Removes edge {[u], [v]}, which was added as edge node [edge].
+  void CutWeighted(Vertex u, Vertex v, Vertex edge);
+  // [u] and [v] must be distinct vertices in the same tree, and every edge on
+  // the path between them must have been added through `LinkWeighted`.
+  // Returns the edge node of the heaviest edge on that path.
+  Vertex PathMax(Vertex u, Vertex v);
+  // Returns the weight of edge node [edge].
+  Weight GetWeight(Vertex edge) const;
 
  private:
-  Node* verts;
-  int num_verts;
+  Node<Weight, kPathMax>* verts;
+  Vertex num_verts;
+  Vertex num_nodes;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+//                           Implementation below.                           //
+///////////////////////////////////////////////////////////////////////////////
+
+namespace _internal {
+
+// The fields that a `Node` needs to find heaviest edges. Nodes of trees that do
+// not find them have none.
+template <typename Node, typename Weight, bool kPathMax>
+class PathMaxFields {
+ protected:
+  bool is_edge{false}; // whether this is an edge node carrying [weight]
+  Weight weight{};
+  Node* max{nullptr}; // heaviest edge node in this splay subtree
 };
 
+template <typename Node, typename Weight>
+class PathMaxFields<Node, Weight, false> {};
+
+} // namespace _internal
+
+template <typename Weight, bool kPathMax>
+class Node
+    : private _internal::PathMaxFields<Node<Weight, kPathMax>, Weight,
+        kPathMax> {
+ public:
+  Node();
+  Node(Node* _par, Node* left, Node *right);
+
+  Node* get_root();
+  void cut(Node* neighbor);
+  void cut_from_par();
+  void link(Node* child);
+  Node* lca(Node* other);
+  void evert(); // reroot
+  // Returns the heaviest edge node on the path from the root to this node, or
+  // null if there is none.
+  Node* path_to_root_max();
+  void make_edge(Weight _weight);
+  Weight get_weight() const { return this->weight; }
+
+ private:
+  Node* par; // parent
+  Node* c[2]; // children
+  bool flip; // whether children are reversed; used for evert()
+
+  Node* get_real_par();
+  void rot();
+  void splay();
+  Node* expose();
+  void fix_c();
+  void push_flip();
+  void update() { update(std::integral_constant<bool, kPathMax>{}); }
+  void update(std::true_type);
+  void update(std::false_type) {}
+};
+
+template <typename Weight, bool kPathMax>
+Node<Weight, kPathMax>::Node(Node* _par, Node* left, Node *right)
+  : par(_par), c{left, right}, flip(0) {
+  fix_c();
+}
+
+template <typename Weight, bool kPathMax>
+Node<Weight, kPathMax>::Node() : Node(nullptr, nullptr, nullptr) {}
+
+template <typename Weight, bool kPathMax>
+Node<Weight, kPathMax>* Node<Weight, kPathMax>::get_real_par() {
+  return par != nullptr && this != par->c[0] && this != par->c[1] ? nullptr : par;
+}
+
+template <typename Weight, bool kPathMax>
+void Node<Weight, kPathMax>::fix_c() {
+  for (int i = 0; i < 2; i++)
+    if (c[i] != nullptr)
+      c[i]->par = this;
+}
+
+template <typename Weight, bool kPathMax>
+void Node<Weight, kPathMax>::push_flip() {
+  if (flip) {
+    flip = 0;
+    std::swap(c[0], c[1]);
+    for (int i = 0; i < 2; i++)
+      if (c[i] != nullptr)
+        c[i]->flip ^= 1;
+  }
+}
+
+// recomputes [max] from the children, which must be up to date
+template <typename Weight, bool kPathMax>
+void Node<Weight, kPathMax>::update(std::true_type) {
+  Node*& max = this->max;
+  max = this->is_edge ? this : nullptr;
+  for (int i = 0; i < 2; i++)
+    if (c[i] != nullptr && c[i]->max != nullptr &&
+        (max == nullptr || max->weight < c[i]->max->weight))
+      max = c[i]->max;
+}
+
+template <typename Weight, bool kPathMax>
+void Node<Weight, kPathMax>::rot() { // rotate v towards its parent; v must have real parent
+  Node* p = get_real_par();
+  par = p->par;
+  if (par != nullptr)
+    for (int i = 0; i < 2; i++)
+      if (par->c[i] == p) {
+        par->c[i] = this;
+        par->fix_c();
+      }
+  const bool rot_dir = this == p->c[0];
+  p->c[!rot_dir] = c[rot_dir];
+  c[rot_dir] = p;
+  p->fix_c();
+  fix_c();
+  p->update();
+  update();
+}
+
+template <typename Weight, bool kPathMax>
+void Node<Weight, kPathMax>::splay() {
+  Node* p, * gp;
+  push_flip(); // guarantee flip bit isn't set after calling splay()
+  while ((p = get_real_par()) != nullptr) {
+    gp = p->get_real_par();
+    if (gp != nullptr)
+      gp->push_flip();
+    p->push_flip();
+    push_flip();
+    if (gp != nullptr)
+      ((gp->c[0] == p) == (p->c[0] == this) ? p : this)->rot();
+    rot();
+  }
+}
+
+// returns 1st vertex encountered that was originally in same path as root (used
+// for LCA)
+template <typename Weight, bool kPathMax>
+Node<Weight, kPathMax>* Node<Weight, kPathMax>::expose() {
+  Node* ret = this;
+  for (Node* curr = this, * pref = nullptr; curr != nullptr;
+       ret = curr, pref = this, curr = par) {
+    curr->splay();
+    curr->c[1] = pref;
+    curr->fix_c();
+    curr->update();
+    splay();
+  }
+  return ret;
+}
+
+template <typename Weight, bool kPathMax>
+void Node<Weight, kPathMax>::evert() {
+  expose();
+  flip ^= 1;
+  push_flip();
+}
+
+template <typename Weight, bool kPathMax>
+Node<Weight, kPathMax>* Node<Weight, kPathMax>::get_root() {
+  expose();
+  Node* root = this;
+  push_flip();
+  while (root->c[0] != nullptr) {
+    root = root->c[0];
+    root->push_flip();
+  }
+  root->splay();
+  return root;
+}
+
+template <typename Weight, bool kPathMax>
+void Node<Weight, kPathMax>::cut_from_par() {
+  expose();
+  c[0] = c[0]->par = nullptr;
+  fix_c();
+  update();
+}
+
+template <typename Weight, bool kPathMax>
+void Node<Weight, kPathMax>::cut(Node* neighbor) {
+  neighbor->evert();
+  evert();
+  neighbor->par = nullptr;
+  for (int i = 0; i < 2; i++)
+    if (c[i] == neighbor)
+      c[i] = nullptr;
+  fix_c();
+  update();
+}
+
+template <typename Weight, bool kPathMax>
+void Node<Weight, kPathMax>::link(Node* child) {
+  child->evert();
+  expose();
+  child->par = this;
+}
+
+template <typename Weight, bool kPathMax>
+Node<Weight, kPathMax>* Node<Weight, kPathMax>::lca(Node* other) {
+  expose();
+  return other->expose();
+}
+
+// after expose(), this node's splay tree holds exactly the path to the root
+template <typename Weight, bool kPathMax>
+Node<Weight, kPathMax>* Node<Weight, kPathMax>::path_to_root_max() {
+  expose();
+  return this->max;
+}
+
+// must be called while the node is isolated
+template <typename Weight, bool kPathMax>
+void Node<Weight, kPathMax>::make_edge(Weight _weight) {
+  this->is_edge = 1;
+  this->weight = _weight;
+  update();
+}
+
+template <typename Vertex, typename Weight, bool kPathMax>
+LinkCutTree<Vertex, Weight, kPathMax>::LinkCutTree(Vertex _num_verts)
+  : LinkCutTree(_num_verts, 0) {}
+
+template <typename Vertex, typename Weight, bool kPathMax>
+LinkCutTree<Vertex, Weight, kPathMax>::LinkCutTree(
+    Vertex _num_verts, Vertex num_edge_nodes)
+  : num_verts(_num_verts), num_nodes(_num_verts + num_edge_nodes) {
+  verts = new Node<Weight, kPathMax>[num_nodes];
+}
+
+template <typename Vertex, typename Weight, bool kPathMax>
+LinkCutTree<Vertex, Weight, kPathMax>::~LinkCutTree() {
+  delete[] verts;
+}
+
+template <typename Vertex, typename Weight, bool kPathMax>
+bool* LinkCutTree<Vertex, Weight, kPathMax>::BatchConnected(
+    std::pair<Vertex, Vertex>* queries, Vertex len) {
+  bool* ans = new bool[len];
+  BatchConnected(queries, len, ans);
+  return ans;
+}
+
+template <typename Vertex, typename Weight, bool kPathMax>
+void LinkCutTree<Vertex, Weight, kPathMax>::BatchConnected(
+    std::pair<Vertex, Vertex>* queries, Vertex len, bool* out) {
+  for (Vertex i = 0; i < len; i++)
+    out[i] = IsConnected(queries[i].first, queries[i].second);
+}
+
+template <typename Vertex, typename Weight, bool kPathMax>
+void LinkCutTree<Vertex, Weight, kPathMax>::BatchLink(
+    std::pair<Vertex, Vertex>* links, Vertex len) {
+  for (Vertex i = 0; i < len; i++)
+    verts[links[i].first].link(&verts[links[i].second]);
+}
+
+template <typename Vertex, typename Weight, bool kPathMax>
+void LinkCutTree<Vertex, Weight, kPathMax>::BatchCut(
+    std::pair<Vertex, Vertex>* cuts, Vertex len) {
+  for (Vertex i = 0; i < len; i++)
+    verts[cuts[i].first].cut(&verts[cuts[i].second]);
+}
+
+template <typename Vertex, typename Weight, bool kPathMax>
+bool LinkCutTree<Vertex, Weight, kPathMax>::IsConnected(Vertex u, Vertex v) {
+  return verts[u].get_root() == verts[v].get_root();
+}
+
+template <typename Vertex, typename Weight, bool kPathMax>
+Vertex LinkCutTree<Vertex, Weight, kPathMax>::FindRoot(Vertex v) {
+  return verts[v].get_root() - verts;
+}
+
+template <typename Vertex, typename Weight, bool kPathMax>
+Vertex LinkCutTree<Vertex, Weight, kPathMax>::Lca(
+    Vertex root, Vertex u, Vertex v) {
+  verts[root].evert();
+  return verts[u].lca(&verts[v]) - verts;
+}
+
+template <typename Vertex, typename Weight, bool kPathMax>
+void LinkCutTree<Vertex, Weight, kPathMax>::LinkWeighted(
+    Vertex u, Vertex v, Vertex edge, Weight weight) {
+  static_assert(kPathMax, "weighted edges need kPathMax");
+  verts[edge].make_edge(weight);
+  verts[u].link(&verts[edge]);
+  verts[edge].link(&verts[v]);
+}
+
+template <typename Vertex, typename Weight, bool kPathMax>
+void LinkCutTree<Vertex, Weight, kPathMax>::CutWeighted(Vertex u, Vertex v, Vertex edge) {
+  verts[u].cut(&verts[edge]);
+  verts[edge].cut(&verts[v]);
+}
+
+template <typename Vertex, typename Weight, bool kPathMax>
+Vertex LinkCutTree<Vertex, Weight, kPathMax>::PathMax(Vertex u, Vertex v) {
+  static_assert(kPathMax, "path maxima need kPathMax");
+  verts[u].evert();
+  return verts[v].path_to_root_max() - verts;
+}
+
+template <typename Vertex, typename Weight, bool kPathMax>
+Weight LinkCutTree<Vertex, Weight, kPathMax>::GetWeight(Vertex edge) const {
+  return verts[edge].get_weight();
+}
+
 } // namespace link_cut_tree
@@ -0,0 +1,640 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <dynamic_trees/link_cut_tree/include/link_cut_tree.hpp>
+#include <dynamic_trees/parallel_euler_tour_tree/include/euler_tour_tree.hpp>
+#include <utilities/include/blockRadixSort.h>
+#include <utilities/include/hash_pair.hpp>
+#include <utilities/include/seq.h>
+#include <utilities/include/sequence_ops.h>
+#include <utilities/include/utils.h>
+
+namespace minimum_spanning_forest {
+
+// Edge {`u`, `v`} with weight `weight`.
+template <typename Vertex, typename Weight>
+struct WeightedEdge {
+  Vertex u;
+  Vertex v;
+  Weight weight;
+};
+
+// Maintains a minimum spanning forest of a weighted graph undergoing batches
+// of edge insertions, answering connectivity queries along the way.
+//
+// By the cycle property, inserting a batch of edges into a graph whose minimum
+// spanning forest is F only ever removes from F edges that are heaviest on
+// some path of F between endpoints of the batch. The compressed path tree of
+// the endpoints is the smallest tree on the endpoints and the vertices where
+// paths between them branch, with an edge for each path of F between two of
+// these vertices that passes through none of the others, weighted with the
+// heaviest edge of F on that path. It has fewer than twice as many vertices as
+// the batch has endpoints. Kruskal's algorithm on the compressed path tree and
+// the batch then tells which edges of the batch join F, and an edge of the
+// compressed path tree that it leaves out names an edge of F that leaves. The
+// changes to F are then applied to a batch-parallel Euler tour tree all at
+// once.
+//
+// Sorting the batch and running Kruskal's algorithm are parallel. Path maxima
+// and lowest common ancestors come from `link_cut_tree::LinkCutTree`, which is
+// sequential, so building the compressed path tree takes O(log n) amortized
+// time per vertex of the tree times the log of its size, and changing F takes
+// O(log n) amortized time per changed edge. The Euler tour tree is only
+// updated once per batch and answers connectivity queries, which may run
+// concurrently with each other and take advantage of parallelism in batches
+// through `BatchConnected`.
+//
+// Vertices are identified by ids 0, 1, ..., n - 1 of the signed integer type
+// `Vertex`, as in `parallel_euler_tour_tree::EulerTourTree`. `Weight` must be
+// an integral type so that batches can be radix sorted, and ties between equal
+// weights are broken in favor of edges already in the forest and otherwise
+// arbitrarily.
+template <typename Vertex = int, typename Weight = int>
+class IncrementalMinimumSpanningForest {
+  static_assert(std::is_integral<Weight>::value,
+      "Weight must be an integral type");
+
+ public:
+  using Edge = WeightedEdge<Vertex, Weight>;
+
+  IncrementalMinimumSpanningForest() = delete;
+  // Initializes an n-vertex graph with no edges.
+  explicit IncrementalMinimumSpanningForest(Vertex num_vertices);
+  ~IncrementalMinimumSpanningForest() = default;
+  IncrementalMinimumSpanningForest(
+      const IncrementalMinimumSpanningForest&) = delete;
+  IncrementalMinimumSpanningForest(IncrementalMinimumSpanningForest&&) = delete;
+  IncrementalMinimumSpanningForest& operator=(
+      const IncrementalMinimumSpanningForest&) = delete;
+  IncrementalMinimumSpanningForest& operator=(
+      IncrementalMinimumSpanningForest&&) = delete;
+
+  // Returns true if `u` and `v` are connected in the graph.
+  bool IsConnected(Vertex u, Vertex v) const;
+  // Returns the number of vertices in the connected component containing `v`.
+  Vertex ComponentSize(Vertex v) const;
+  // For each `i`=0,1,...,`len`-1, sets `out[i]` to whether `queries[i].first`
+  // and `queries[i].second` are connected in the graph. `out` must have space
+  // for `len` elements.
+  //
+  // This function does not modify the graph, so it may run concurrently with
+  // other const functions.
+  void BatchConnected(
+      std::pair<Vertex, Vertex>* queries, Vertex len, bool* out) const;
+
+  // Returns true if edge {`u`, `v`} is in the minimum spanning forest.
+  bool IsForestEdge(Vertex u, Vertex v) const;
+  // Returns the number of edges in the minimum spanning forest.
+  Vertex NumForestEdges() const;
+  // Returns the total weight of the minimum spanning forest.
+  Weight ForestWeight() const;
+
+  // Adds all edges in the `len`-length array `edges` to the graph. The edges
+  // may be self-loops and may repeat each other or edges already in the graph,
+  // in which case the lightest copy of an edge is the one that counts.
+  void BatchInsertEdges(Edge* edges, Vertex len);
+
+ private:
+  using Forest = parallel_euler_tour_tree::EulerTourTree<
+    parallel_skip_list::SumAugmentation<int>,
+    parallel_euler_tour_tree::ElementArena,
+    parallel_euler_tour_tree::HashEdgeMap,
+    Vertex>;
+
+  // Returns edge {`u`, `v`} with its smaller endpoint first.
+  static std::pair<Vertex, Vertex> Normalize(Vertex u, Vertex v);
+  // Builds the compressed path tree of the endpoints of the `len` edges in
+  // `batch`. Returns its vertices, grouped by tree of the forest and, within a
+  // tree, ordered by `EulerTourTree::TourRank` from the first vertex of the
+  // group, which is the root of the group. Stores their number into
+  // `*num_tree_vertices`, and stores into `*parents` an array holding for each
+  // vertex the index of its parent, or -1 for a root. Afterwards,
+  // `tree_ids_[v]` is the index of each vertex v of the tree.
+  Vertex* BuildCompressedPathTree(const Edge* batch, Vertex len,
+      Vertex* num_tree_vertices, Vertex** parents);
+
+  Vertex num_vertices_;
+  Forest forest_;
+  link_cut_tree::LinkCutTree<Vertex, Weight, true> path_max_;
+  // Maps each edge of the minimum spanning forest, with its smaller endpoint
+  // first, to its edge node in `path_max_`.
+  std::unordered_map<std::pair<Vertex, Vertex>, Vertex, HashIntPairStruct>
+    edge_nodes_;
+  // `edge_endpoints_[e - n]` holds the endpoints of edge node `e` while it is
+  // in use.
+  std::vector<std::pair<Vertex, Vertex>> edge_endpoints_;
+  std::vector<Vertex> free_edge_nodes_;
+  // Scratch space for `BuildCompressedPathTree`, which is -1 for every vertex
+  // outside of `BatchInsertEdges`.
+  std::vector<Vertex> tree_ids_;
+  Weight forest_weight_;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+//                           Implementation below.                           //
+///////////////////////////////////////////////////////////////////////////////
+
+namespace _internal {
+
+// Minimum number of edges that `ParallelKruskal` decides on in a round.
+constexpr size_t kKruskalMinRoundSize{1024};
+// `ParallelKruskal` decides on 1/`kKruskalRoundFraction` of the remaining edges
+// in a round if that is more than `kKruskalMinRoundSize`.
+constexpr size_t kKruskalRoundFraction{16};
+
+// Stably sorts the `len` elements of `items` by `weight(item)`, which must be
+// of an integral type of at most 64 bits. The sort is a radix sort on the
+// offsets of the weights from the lightest one, in two passes of 32 bits each
+// if the offsets do not fit in 32 bits.
+template <typename T, typename F>
+void SortByWeight(T* items, size_t len, F weight) {
+  if (len == 0) {
+    return;
+  }
+  using Weight = decltype(weight(items[0]));
+  const auto item_weight{[&](size_t i) { return weight(items[i]); }};
+  const Weight lightest{utils::sequence::reduce<Weight>(
+      static_cast<size_t>(0), len, minF<Weight>(), item_weight)};
+  const Weight heaviest{utils::sequence::reduce<Weight>(
+      static_cast<size_t>(0), len, maxF<Weight>(), item_weight)};
+  // Unsigned arithmetic makes the offsets exact even for signed weights.
+  const auto offset{[&](const T& item) {
+    return static_cast<uint64_t>(weight(item)) -
+      static_cast<uint64_t>(lightest);
+  }};
+  const uint64_t range{
+    static_cast<uint64_t>(heaviest) - static_cast<uint64_t>(lightest)};
+  constexpr uint64_t kLowMask{(uint64_t{1} << 32) - 1};
+  if (range <= kLowMask) {
+    intSort::iSort(items, len, static_cast<long>(range) + 1, offset);
+  } else {
+    intSort::iSort(items, len, static_cast<long>(kLowMask) + 1,
+        [&](const T& item) { return offset(item) & kLowMask; });
+    intSort::iSort(items, len, static_cast<long>(range >> 32) + 1,
+        [&](const T& item) { return offset(item) >> 32; });
+  }
+}
+
+// Runs Kruskal's algorithm on vertices 0, 1, ..., `num_vertices` - 1 and the
+// `len` edges in `edges`, which are sorted by weight, and sets `accepted[i]` to
+// whether `edges[i]` is in the resulting spanning forest.
+//
+// Edges are decided with deterministic reservations. In each round, a prefix
+// of the undecided edges finds the union-find roots of their endpoints, and an
+// edge whose endpoints have the same root is rejected. The rest reserve both
+// of their roots with their indices. An edge that holds the reservation on one
+// of its roots hooks that root under the other one and is accepted, and the
+// others retry in the next round. An edge is only accepted once no lighter
+// edge touches its roots, so this accepts the same edges as the sequential
+// algorithm.
+template <typename Vertex>
+void ParallelKruskal(const std::pair<Vertex, Vertex>* edges, Vertex len,
+    Vertex num_vertices, bool* accepted) {
+  if (len == 0) {
+    return;
+  }
+  Vertex* parents{pbbs::new_array_no_init<Vertex>(num_vertices)};
+  Vertex* reservations{pbbs::new_array_no_init<Vertex>(num_vertices)};
+  parallel_for (Vertex v = 0; v < num_vertices; v++) {
+    parents[v] = v;
+    reservations[v] = len;
+  }
+  Vertex* pending{pbbs::new_array_no_init<Vertex>(len)};
+  Vertex* next_pending{pbbs::new_array_no_init<Vertex>(len)};
+  parallel_for (Vertex i = 0; i < len; i++) {
+    pending[i] = i;
+  }
+  std::pair<Vertex, Vertex>* roots{
+    pbbs::new_array_no_init<std::pair<Vertex, Vertex>>(len)};
+  bool* is_retried{pbbs::new_array_no_init<bool>(len)};
+
+  Vertex num_pending{len};
+  while (num_pending > 0) {
+    const Vertex round_size{static_cast<Vertex>(std::min<size_t>(num_pending,
+        std::max(kKruskalMinRoundSize, num_pending / kKruskalRoundFraction)))};
+    parallel_for (Vertex j = 0; j < round_size; j++) {
+      const Vertex i{pending[j]};
+      const Vertex u{parallel_euler_tour_tree::_internal::FindRoot(
+          parents, edges[i].first)};
+      const Vertex v{parallel_euler_tour_tree::_internal::FindRoot(
+          parents, edges[i].second)};
+      roots[j] = std::make_pair(u, v);
+      if (u != v) {
+        writeMin(&reservations[u], i);
+        writeMin(&reservations[v], i);
+      }
+    }
+    parallel_for (Vertex j = 0; j < round_size; j++) {
+      const Vertex i{pending[j]};
+      const Vertex u{roots[j].first};
+      const Vertex v{roots[j].second};
+      is_retried[j] = false;
+      if (u == v) {
+        accepted[i] = false;
+      } else if (reservations[v] == i) {
+        parents[v] = u;
+        accepted[i] = true;
+      } else if (reservations[u] == i) {
+        parents[u] = v;
+        accepted[i] = true;
+      } else {
+        is_retried[j] = true;
+      }
+    }
+    parallel_for (Vertex j = 0; j < round_size; j++) {
+      reservations[roots[j].first] = len;
+      reservations[roots[j].second] = len;
+    }
+
+    // Move the retried edges ahead of the edges that have not had a round yet.
+    seq::sequence<Vertex> retried{
+      pbbs::pack(seq::sequence<Vertex>(pending, round_size),
+          seq::sequence<bool>(is_retried, round_size))};
+    const Vertex num_retried{static_cast<Vertex>(retried.size())};
+    const Vertex num_untried{num_pending - round_size};
+    parallel_for (Vertex j = 0; j < num_retried; j++) {
+      next_pending[j] = retried[j];
+    }
+    parallel_for (Vertex j = 0; j < num_untried; j++) {
+      next_pending[num_retried + j] = pending[round_size + j];
+    }
+    pbbs::delete_array(retried.as_array(), num_retried);
+    std::swap(pending, next_pending);
+    num_pending = num_retried + num_untried;
+  }
+
+  pbbs::delete_array(is_retried, len);
+  pbbs::delete_array(roots, len);
+  pbbs::delete_array(next_pending, len);
+  pbbs::delete_array(pending, len);
+  pbbs::delete_array(reservations, num_vertices);
+  pbbs::delete_array(parents, num_vertices);
+}
+
+}  // namespace _internal
+
+template <typename Vertex, typename Weight>
+IncrementalMinimumSpanningForest<Vertex, Weight>::
+IncrementalMinimumSpanningForest(Vertex num_vertices)
+    : num_vertices_{num_vertices}
+    , forest_{num_vertices_}
+    , path_max_{num_vertices_, std::max<Vertex>(num_vertices_ - 1, 0)}
+    , edge_endpoints_(std::max<Vertex>(num_vertices_ - 1, 0))
+    , tree_ids_(num_vertices_, -1)
+    , forest_weight_{} {
+  free_edge_nodes_.reserve(edge_endpoints_.size());
+  for (Vertex e = 2 * num_vertices_ - 2; e >= num_vertices_; e--) {
+    free_edge_nodes_.push_back(e);
+  }
+}
+
+template <typename Vertex, typename Weight>
+bool IncrementalMinimumSpanningForest<Vertex, Weight>::IsConnected(
+    Vertex u, Vertex v) const {
+  return forest_.IsConnected(u, v);
+}
+
+template <typename Vertex, typename Weight>
+Vertex IncrementalMinimumSpanningForest<Vertex, Weight>::ComponentSize(
+    Vertex v) const {
+  return forest_.ComponentSize(v);
+}
+
+template <typename Vertex, typename Weight>
+void IncrementalMinimumSpanningForest<Vertex, Weight>::BatchConnected(
+    std::pair<Vertex, Vertex>* queries, Vertex len, bool* out) const {
+  forest_.BatchConnected(queries, len, out);
+}
+
+template <typename Vertex, typename Weight>
+bool IncrementalMinimumSpanningForest<Vertex, Weight>::IsForestEdge(
+    Vertex u, Vertex v) const {
+  return edge_nodes_.count(Normalize(u, v)) > 0;
+}
+
+template <typename Vertex, typename Weight>
+Vertex IncrementalMinimumSpanningForest<Vertex, Weight>::NumForestEdges()
+    const {
+  return edge_nodes_.size();
+}
+
+template <typename Vertex, typename Weight>
+Weight IncrementalMinimumSpanningForest<Vertex, Weight>::ForestWeight() const {
+  return forest_weight_;
+}
+
+template <typename Vertex, typename Weight>
+std::pair<Vertex, Vertex>
+IncrementalMinimumSpanningForest<Vertex, Weight>::Normalize(
+    Vertex u, Vertex v) {
+  return u < v ? std::make_pair(u, v) : std::make_pair(v, u);
+}
+
+// The compressed path tree of a set of vertices of a rooted tree consists of
+// the vertices and the lowest common ancestors of their pairs. Ordering the
+// vertices of a rooted tree by the position of their first occurrence in an
+// Euler tour from the root, which is what `EulerTourTree::TourRank` gives,
+// makes every subtree contiguous, and the lowest common ancestors of the pairs
+// of a set are those of the pairs that are adjacent in this order. The parent
+// of a vertex v of the compressed path tree is then the lower of the lowest
+// common ancestors of v with the vertices just before and just after the
+// contiguous run of descendants of v.
+template <typename Vertex, typename Weight>
+Vertex* IncrementalMinimumSpanningForest<Vertex, Weight>::
+BuildCompressedPathTree(const Edge* batch, Vertex len,
+    Vertex* num_tree_vertices, Vertex** parents) {
+  // `tree_ids_` only needs to tell unclaimed vertices apart until the end.
+  constexpr Vertex kUnclaimed{-1};
+  struct TreeVertex {
+    Vertex vertex;
+    // Index of the vertex's tree of the forest among the trees of the batch.
+    Vertex group;
+    Vertex rank;
+  };
+
+  // Claim each endpoint once.
+  const Vertex num_endpoints{2 * len};
+  bool* is_claimed{pbbs::new_array_no_init<bool>(num_endpoints)};
+  Vertex* endpoints{pbbs::new_array_no_init<Vertex>(num_endpoints)};
+  parallel_for (Vertex i = 0; i < num_endpoints; i++) {
+    endpoints[i] = i % 2 == 0 ? batch[i / 2].u : batch[i / 2].v;
+    is_claimed[i] = CAS(&tree_ids_[endpoints[i]], kUnclaimed, i);
+  }
+  seq::sequence<Vertex> claimed{
+    pbbs::pack(seq::sequence<Vertex>(endpoints, num_endpoints),
+        seq::sequence<bool>(is_claimed, num_endpoints))};
+  pbbs::delete_array(endpoints, num_endpoints);
+  pbbs::delete_array(is_claimed, num_endpoints);
+  const Vertex num_claimed{static_cast<Vertex>(claimed.size())};
+
+  // Group the endpoints by tree, and root each tree at the first endpoint of
+  // its group.
+  std::pair<Vertex, Vertex>* by_root{
+    pbbs::new_array_no_init<std::pair<Vertex, Vertex>>(num_claimed)};
+  for (Vertex i = 0; i < num_claimed; i++) {
+    by_root[i] = std::make_pair(path_max_.FindRoot(claimed[i]), i);
+  }
+  intSort::iSort(by_root, num_claimed, 2 * static_cast<long>(num_vertices_),
+      firstF<Vertex, Vertex>());
+  Vertex* group_ends{pbbs::new_array_no_init<Vertex>(num_claimed)};
+  parallel_for (Vertex j = 0; j < num_claimed; j++) {
+    group_ends[j] =
+      j == 0 || by_root[j].first != by_root[j - 1].first ? 1 : 0;
+  }
+  const Vertex num_groups{utils::sequence::scanI(
+      group_ends, group_ends, num_claimed, addF<Vertex>(), Vertex{0})};
+  Vertex* group_roots{pbbs::new_array_no_init<Vertex>(num_groups)};
+  TreeVertex* endpoint_vertices{
+    pbbs::new_array_no_init<TreeVertex>(num_claimed)};
+  parallel_for (Vertex j = 0; j < num_claimed; j++) {
+    const Vertex i{by_root[j].second};
+    const Vertex group{group_ends[j] - 1};
+    if (j == 0 || group_ends[j] != group_ends[j - 1]) {
+      group_roots[group] = claimed[i];
+    }
+    endpoint_vertices[i].vertex = claimed[i];
+    endpoint_vertices[i].group = group;
+  }
+  pbbs::delete_array(group_ends, num_claimed);
+  pbbs::delete_array(by_root, num_claimed);
+  pbbs::delete_array(claimed.as_array(), num_claimed);
+
+  // Sorts tree vertices by group and then by rank from the group's root.
+  const auto sort_by_tour{[&](TreeVertex* tree_vertices, Vertex num) {
+    parallel_for (Vertex k = 0; k < num; k++) {
+      tree_vertices[k].rank = forest_.TourRank(
+          group_roots[tree_vertices[k].group], tree_vertices[k].vertex);
+    }
+    intSort::iSort(tree_vertices, num, static_cast<long>(num_vertices_) + 1,
+        [](const TreeVertex& x) { return x.rank; });
+    intSort::iSort(tree_vertices, num, static_cast<long>(num_groups),
+        [](const TreeVertex& x) { return x.group; });
+  }};
+  sort_by_tour(endpoint_vertices, num_claimed);
+
+  // Add the lowest common ancestors of endpoints adjacent in a group that are
+  // not endpoints themselves, once each.
+  TreeVertex* ancestors{pbbs::new_array_no_init<TreeVertex>(num_claimed)};
+  bool* is_new{pbbs::new_array_no_init<bool>(num_claimed)};
+  for (Vertex j = 1; j < num_claimed; j++) {
+    const Vertex group{endpoint_vertices[j].group};
+    ancestors[j].group = group;
+    ancestors[j].vertex = group == endpoint_vertices[j - 1].group
+      ? path_max_.Lca(group_roots[group], endpoint_vertices[j - 1].vertex,
+          endpoint_vertices[j].vertex)
+      : kUnclaimed;
+  }
+  is_new[0] = false;
+  parallel_for (Vertex j = 1; j < num_claimed; j++) {
+    is_new[j] = ancestors[j].vertex != kUnclaimed &&
+      CAS(&tree_ids_[ancestors[j].vertex], kUnclaimed, num_endpoints + j);
+  }
+  seq::sequence<Vertex> new_ancestors{
+    pbbs::pack_index<Vertex>(seq::sequence<bool>(is_new, num_claimed))};
+  const Vertex num_new{static_cast<Vertex>(new_ancestors.size())};
+  const Vertex num{num_claimed + num_new};
+  TreeVertex* tree_vertices{pbbs::new_array_no_init<TreeVertex>(num)};
+  parallel_for (Vertex j = 0; j < num_claimed; j++) {
+    tree_vertices[j] = endpoint_vertices[j];
+  }
+  parallel_for (Vertex k = 0; k < num_new; k++) {
+    tree_vertices[num_claimed + k] = ancestors[new_ancestors[k]];
+  }
+  pbbs::delete_array(new_ancestors.as_array(), num_new);
+  pbbs::delete_array(is_new, num_claimed);
+  pbbs::delete_array(ancestors, num_claimed);
+  pbbs::delete_array(endpoint_vertices, num_claimed);
+  sort_by_tour(tree_vertices, num);
+
+  Vertex* vertices{pbbs::new_array_no_init<Vertex>(num)};
+  parallel_for (Vertex k = 0; k < num; k++) {
+    vertices[k] = tree_vertices[k].vertex;
+    tree_ids_[vertices[k]] = k;
+  }
+
+  // Find the parent of each vertex that is not the root of its group by
+  // binary searching for the ends of the run of its descendants.
+  *parents = pbbs::new_array_no_init<Vertex>(num);
+  Vertex group_start{0};
+  for (Vertex k = 0; k < num; k++) {
+    const Vertex group{tree_vertices[k].group};
+    if (k == 0 || group != tree_vertices[k - 1].group) {
+      group_start = k;
+      (*parents)[k] = -1;
+      continue;
+    }
+    const Vertex root{group_roots[group]};
+    const Vertex v{vertices[k]};
+    const auto is_descendant{[&](Vertex j) {
+      return tree_vertices[j].group == group &&
+        path_max_.Lca(root, vertices[j], v) == v;
+    }};
+    Vertex first{group_start + 1};
+    for (Vertex last = k; first < last; ) {
+      const Vertex mid{first + (last - first) / 2};
+      if (is_descendant(mid)) {
+        last = mid;
+      } else {
+        first = mid + 1;
+      }
+    }
+    Vertex last{k};
+    for (Vertex end = num - 1; last < end; ) {
+      const Vertex mid{end - (end - last) / 2};
+      if (is_descendant(mid)) {
+        last = mid;
+      } else {
+        end = mid - 1;
+      }
+    }
+    Vertex parent{path_max_.Lca(root, vertices[first - 1], v)};
+    if (last + 1 < num && tree_vertices[last + 1].group == group) {
+      const Vertex other_parent{path_max_.Lca(root, vertices[last + 1], v)};
+      if (path_max_.Lca(root, parent, other_parent) == parent) {
+        parent = other_parent;
+      }
+    }
+    (*parents)[k] = tree_ids_[parent];
+  }
+
+  pbbs::delete_array(tree_vertices, num);
+  pbbs::delete_array(group_roots, num_groups);
+  *num_tree_vertices = num;
+  return vertices;
+}
+
+// Edges of the compressed path tree come before the edges of the batch in the
+// input to Kruskal's algorithm, so that the stable sort by weight breaks ties
+// in favor of edges already in the forest.
+template <typename Vertex, typename Weight>
+void IncrementalMinimumSpanningForest<Vertex, Weight>::BatchInsertEdges(
+    Edge* edges, Vertex len) {
+  // `pbbs::pack` below cannot take an empty input.
+  if (len == 0) {
+    return;
+  }
+  // Drop self-loops.
+  bool* is_loop_free{pbbs::new_array_no_init<bool>(len)};
+  parallel_for (Vertex i = 0; i < len; i++) {
+    is_loop_free[i] = edges[i].u != edges[i].v;
+  }
+  seq::sequence<Edge> batch_seq{
+    pbbs::pack(seq::sequence<Edge>(edges, len),
+        seq::sequence<bool>(is_loop_free, len))};
+  pbbs::delete_array(is_loop_free, len);
+  Edge* batch{batch_seq.as_array()};
+  const Vertex batch_len{static_cast<Vertex>(batch_seq.size())};
+  if (batch_len == 0) {
+    pbbs::delete_array(batch, batch_len);
+    return;
+  }
+
+  Vertex num_tree_vertices;
+  Vertex* tree_parents;
+  Vertex* tree_vertices{BuildCompressedPathTree(
+      batch, batch_len, &num_tree_vertices, &tree_parents)};
+  // `heaviest[k]` is the edge node of the heaviest edge on the path from
+  // `tree_vertices[k]` to its parent.
+  Vertex* heaviest{pbbs::new_array_no_init<Vertex>(num_tree_vertices)};
+  for (Vertex k = 0; k < num_tree_vertices; k++) {
+    heaviest[k] = tree_parents[k] == -1
+      ? -1
+      : path_max_.PathMax(tree_vertices[tree_parents[k]], tree_vertices[k]);
+  }
+
+  // Candidate `i` is edge `i` of the compressed path tree if `i` is less than
+  // `num_tree_vertices` and edge `i - num_tree_vertices` of the batch
+  // otherwise.
+  struct Candidate {
+    Vertex index;
+    Weight weight;
+  };
+  const Vertex num_candidates{num_tree_vertices + batch_len};
+  Candidate* candidates{pbbs::new_array_no_init<Candidate>(num_candidates)};
+  bool* is_candidate{pbbs::new_array_no_init<bool>(num_candidates)};
+  parallel_for (Vertex i = 0; i < num_candidates; i++) {
+    candidates[i].index = i;
+    if (i < num_tree_vertices) {
+      is_candidate[i] = tree_parents[i] != -1;
+      candidates[i].weight =
+        is_candidate[i] ? path_max_.GetWeight(heaviest[i]) : Weight{};
+    } else {
+      is_candidate[i] = true;
+      candidates[i].weight = batch[i - num_tree_vertices].weight;
+    }
+  }
+  seq::sequence<Candidate> sorted_seq{
+    pbbs::pack(seq::sequence<Candidate>(candidates, num_candidates),
+        seq::sequence<bool>(is_candidate, num_candidates))};
+  pbbs::delete_array(is_candidate, num_candidates);
+  pbbs::delete_array(candidates, num_candidates);
+  Candidate* sorted{sorted_seq.as_array()};
+  const Vertex num_sorted{static_cast<Vertex>(sorted_seq.size())};
+  _internal::SortByWeight(
+      sorted, num_sorted, [](const Candidate& c) { return c.weight; });
+
+  std::pair<Vertex, Vertex>* kruskal_edges{
+    pbbs::new_array_no_init<std::pair<Vertex, Vertex>>(num_sorted)};
+  parallel_for (Vertex j = 0; j < num_sorted; j++) {
+    const Vertex i{sorted[j].index};
+    kruskal_edges[j] = i < num_tree_vertices
+      ? std::make_pair(tree_parents[i], i)
+      : std::make_pair(tree_ids_[batch[i - num_tree_vertices].u],
+          tree_ids_[batch[i - num_tree_vertices].v]);
+  }
+  bool* accepted{pbbs::new_array_no_init<bool>(num_sorted)};
+  _internal::ParallelKruskal(
+      kruskal_edges, num_sorted, num_tree_vertices, accepted);
+  pbbs::delete_array(kruskal_edges, num_sorted);
+  parallel_for (Vertex k = 0; k < num_tree_vertices; k++) {
+    tree_ids_[tree_vertices[k]] = -1;
+  }
+
+  // Cut the forest edges that Kruskal's algorithm leaves out before linking
+  // the batch edges that it keeps, so that edge nodes are free to reuse.
+  std::vector<std::pair<Vertex, Vertex>> cuts;
+  std::vector<std::pair<Vertex, Vertex>> links;
+  for (Vertex j = 0; j < num_sorted; j++) {
+    const Vertex i{sorted[j].index};
+    if (i < num_tree_vertices && !accepted[j]) {
+      const Vertex node{heaviest[i]};
+      const std::pair<Vertex, Vertex> replaced{
+        edge_endpoints_[node - num_vertices_]};
+      path_max_.CutWeighted(replaced.first, replaced.second, node);
+      forest_weight_ -= path_max_.GetWeight(node);
+      edge_nodes_.erase(Normalize(replaced.first, replaced.second));
+      free_edge_nodes_.push_back(node);
+      cuts.push_back(replaced);
+    }
+  }
+  for (Vertex j = 0; j < num_sorted; j++) {
+    const Vertex i{sorted[j].index};
+    if (i >= num_tree_vertices && accepted[j]) {
+      const Edge& edge{batch[i - num_tree_vertices]};
+      const Vertex node{free_edge_nodes_.back()};
+      free_edge_nodes_.pop_back();
+      path_max_.LinkWeighted(edge.u, edge.v, node, edge.weight);
+      forest_weight_ += edge.weight;
+      edge_nodes_[Normalize(edge.u, edge.v)] = node;
+      edge_endpoints_[node - num_vertices_] = std::make_pair(edge.u, edge.v);
+      links.emplace_back(edge.u, edge.v);
+    }
+  }
+  pbbs::delete_array(accepted, num_sorted);
+  pbbs::delete_array(sorted, num_sorted);
+  pbbs::delete_array(heaviest, num_tree_vertices);
+  pbbs::delete_array(tree_parents, num_tree_vertices);
+  pbbs::delete_array(tree_vertices, num_tree_vertices);
+  pbbs::delete_array(batch, batch_len);
+
+  forest_.ApplyBatch(cuts.data(), cuts.size(), links.data(), links.size(),
+      nullptr, 0, nullptr);
+}
+
+}  // namespace minimum_spanning_forest
@@ -0,0 +1,181 @@
+#include <dynamic_trees/minimum_spanning_forest/include/minimum_spanning_forest.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <utility>
+#include <vector>
+
+using MinimumSpanningForest =
+  minimum_spanning_forest::IncrementalMinimumSpanningForest<>;
+using Edge = MinimumSpanningForest::Edge;
+
+constexpr int num_vertices{300};
+
+// Minimum spanning forest of a graph computed from scratch with Kruskal's
+// algorithm.
+struct ReferenceForest {
+  std::vector<int> components;
+  int num_edges;
+  int weight;
+};
+
+int FindRoot(std::vector<int>* parents, int v) {
+  while ((*parents)[v] != v) {
+    v = (*parents)[v] = (*parents)[(*parents)[v]];
+  }
+  return v;
+}
+
+ReferenceForest ComputeReferenceForest(std::vector<Edge> edges) {
+  std::sort(edges.begin(), edges.end(),
+      [](const Edge& a, const Edge& b) { return a.weight < b.weight; });
+  std::vector<int> parents(num_vertices);
+  std::iota(parents.begin(), parents.end(), 0);
+  ReferenceForest forest{{}, 0, 0};
+  for (const Edge& e : edges) {
+    const int u{FindRoot(&parents, e.u)};
+    const int v{FindRoot(&parents, e.v)};
+    if (u != v) {
+      parents[u] = v;
+      forest.num_edges++;
+      forest.weight += e.weight;
+    }
+  }
+  for (int v = 0; v < num_vertices; v++) {
+    forest.components.push_back(FindRoot(&parents, v));
+  }
+  return forest;
+}
+
+void CheckForest(
+    const std::vector<Edge>& edges, const MinimumSpanningForest& forest) {
+  const ReferenceForest reference{ComputeReferenceForest(edges)};
+  assert(forest.NumForestEdges() == reference.num_edges);
+  assert(forest.ForestWeight() == reference.weight);
+
+  constexpr int num_queries{num_vertices * num_vertices};
+  std::pair<int, int>* queries{
+      pbbs::new_array_no_init<std::pair<int, int>>(num_queries)};
+  bool* answers{pbbs::new_array_no_init<bool>(num_queries)};
+  for (int u = 0; u < num_vertices; u++) {
+    for (int v = 0; v < num_vertices; v++) {
+      queries[u * num_vertices + v] = std::make_pair(u, v);
+    }
+  }
+  forest.BatchConnected(queries, num_queries, answers);
+  for (int u = 0; u < num_vertices; u++) {
+    int component_size{0};
+    for (int v = 0; v < num_vertices; v++) {
+      const bool connected{
+        reference.components[u] == reference.components[v]};
+      assert(answers[u * num_vertices + v] == connected);
+      component_size += connected;
+    }
+    assert(forest.ComponentSize(u) == component_size);
+  }
+  pbbs::delete_array(answers, num_queries);
+  pbbs::delete_array(queries, num_queries);
+}
+
+// Inserts `num_rounds` batches of `batch_size` random edges with weights
+// below `max_weight`. Small weights give many ties. Some of the edges are
+// self-loops or repeat earlier edges with new weights.
+void CheckRandomInsertions(int num_rounds, int batch_size, int max_weight) {
+  std::mt19937 rng{};
+  rng.seed(num_rounds + batch_size + max_weight);
+  std::uniform_int_distribution<int> vert_dist{0, num_vertices - 1};
+  std::uniform_int_distribution<int> weight_dist{0, max_weight - 1};
+
+  MinimumSpanningForest forest{num_vertices};
+  std::vector<Edge> edges;
+  std::vector<Edge> batch;
+  for (int i = 0; i < num_rounds; i++) {
+    batch.clear();
+    for (int j = 0; j < batch_size; j++) {
+      const int u{vert_dist(rng)};
+      if (j % 10 == 0) {
+        batch.push_back(Edge{u, u, weight_dist(rng)});
+      } else if (j % 10 == 1 && !edges.empty()) {
+        const Edge& e{edges[rng() % edges.size()]};
+        batch.push_back(Edge{e.v, e.u, weight_dist(rng)});
+      } else {
+        batch.push_back(Edge{u, vert_dist(rng), weight_dist(rng)});
+      }
+    }
+    forest.BatchInsertEdges(batch.data(), batch.size());
+    edges.insert(edges.end(), batch.begin(), batch.end());
+    CheckForest(edges, forest);
+  }
+
+  // An empty batch leaves the forest alone.
+  forest.BatchInsertEdges(nullptr, 0);
+  CheckForest(edges, forest);
+}
+
+// Links all vertices into a path and then inserts `num_rounds` batches of
+// `batch_size` random chords, so that paths in the forest are long and the
+// compressed path trees of the batches skip over many vertices. Weights may be
+// negative.
+void CheckPathChords(int num_rounds, int batch_size, int max_weight) {
+  std::mt19937 rng{};
+  rng.seed(num_rounds + batch_size + max_weight);
+  std::uniform_int_distribution<int> vert_dist{0, num_vertices - 1};
+  std::uniform_int_distribution<int> weight_dist{-max_weight, max_weight - 1};
+
+  MinimumSpanningForest forest{num_vertices};
+  std::vector<Edge> edges;
+  for (int v = 0; v + 1 < num_vertices; v++) {
+    edges.push_back(Edge{v, v + 1, weight_dist(rng)});
+  }
+  forest.BatchInsertEdges(edges.data(), edges.size());
+  CheckForest(edges, forest);
+  std::vector<Edge> batch;
+  for (int i = 0; i < num_rounds; i++) {
+    batch.clear();
+    for (int j = 0; j < batch_size; j++) {
+      batch.push_back(Edge{vert_dist(rng), vert_dist(rng), weight_dist(rng)});
+    }
+    forest.BatchInsertEdges(batch.data(), batch.size());
+    edges.insert(edges.end(), batch.begin(), batch.end());
+    CheckForest(edges, forest);
+  }
+}
+
+// Checks that sorting weights whose range does not fit in 32 bits is stable.
+void CheckSortByWeight() {
+  std::mt19937_64 rng{};
+  constexpr int len{10000};
+  std::vector<std::pair<int64_t, int>> items;
+  for (int i = 0; i < len; i++) {
+    const int64_t weight{static_cast<int64_t>(rng() % 1000) *
+      (int64_t{1} << 40) - static_cast<int64_t>(rng() % 3)};
+    items.emplace_back(i % 2 == 0 ? weight : -weight, i);
+  }
+  std::vector<std::pair<int64_t, int>> expected{items};
+  std::stable_sort(expected.begin(), expected.end(),
+      [](const std::pair<int64_t, int>& a, const std::pair<int64_t, int>& b) {
+        return a.first < b.first;
+      });
+  minimum_spanning_forest::_internal::SortByWeight(items.data(), len,
+      [](const std::pair<int64_t, int>& item) { return item.first; });
+  assert(items == expected);
+}
+
+int main() {
+  // Large batches exercise the parallel paths of the underlying Euler tour
+  // tree, and small batches exercise the sequential ones.
+  CheckRandomInsertions(10, 60, 1000);
+  CheckRandomInsertions(10, 60, 5);
+  CheckRandomInsertions(5, 500, 1000000);
+  CheckRandomInsertions(5, 500, 10);
+  CheckRandomInsertions(200, 3, 100);
+  CheckPathChords(10, 20, 1000);
+  CheckPathChords(5, 400, 10);
+  CheckSortByWeight();
+
+  std::cout << "Test complete." << std::endl;
+}
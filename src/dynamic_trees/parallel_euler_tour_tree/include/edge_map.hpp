@@ -0,0 +1,548 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+#include <sequence/parallel_skip_list/include/skip_list_base.hpp>
+#include <utilities/include/concurrentMap.h>
+#include <utilities/include/seq.h>
+#include <utilities/include/sequence_ops.h>
+#include <utilities/include/utils.h>
+
+namespace parallel_euler_tour_tree {
+
+namespace _internal {
+
+// Integer type that holds both endpoints of an edge on vertices with ids of
+// type `Vertex`.
+template <typename Vertex>
+using EdgeKey = typename std::conditional<
+    sizeof(Vertex) <= sizeof(uint32_t), uint64_t, unsigned __int128>::type;
+
+// Hash function on `EdgeKey`s for `concurrent_map::concurrentHT`.
+struct EdgeKeyHash {
+  size_t operator()(uint64_t key) const;
+  size_t operator()(unsigned __int128 key) const;
+};
+
+// `ElementStorage<Elem>::Type` is `Elem::StorageType` if `Elem` declares one
+// and `parallel_skip_list::HeapStorage` otherwise.
+template <typename Elem, typename = void>
+struct ElementStorage {
+  using Type = parallel_skip_list::HeapStorage;
+};
+template <typename Elem>
+struct ElementStorage<Elem, typename std::conditional<
+    true, void, typename Elem::StorageType>::type> {
+  using Type = typename Elem::StorageType;
+};
+
+}  // namespace _internal
+
+// Edge maps map each edge {u, v} of an `EulerTourTree` to the sequence element
+// representing directed edge (u, v). Only one of (u, v) and (v, u) is stored;
+// the other is found through the `twin_` pointer in `Elem`.
+//
+// An edge map of `Elem`s on vertices whose ids have the signed integer type
+// `Vertex` is constructed as `Map(num_vertices)` and provides
+//
+//   // Adds edge `edges[i]` with element `elements[i]` for each
+//   // `i`=0,1,...,`len`-1. The edges must not already be in the map.
+//   void BatchInsert(const std::pair<Vertex, Vertex>* edges,
+//       Elem* const* elements, Vertex len);
+//   // Removes edge {`u`, `v`}. Returns false if the edge was not in the map.
+//   bool Delete(Vertex u, Vertex v);
+//   // Returns the element for (`u`, `v`), or null if edge {`u`, `v`} is not in
+//   // the map.
+//   Elem* Find(Vertex u, Vertex v) const;
+//
+// `BatchInsert` may use parallelism internally but may not run concurrently
+// with any other call. `Delete` and `Find` may run concurrently with other
+// calls to `Delete` and `Find`.
+//
+// `HashEdgeMap` and `AdjacencyEdgeMap` keep their tables in `Elem::StorageType`
+// if `Elem` declares one, so they may live in a `file_arena::FileArena` along
+// with their elements. `ConcurrentHTEdgeMap` only works with
+// `parallel_skip_list::HeapStorage`.
+
+// Linear-probing hash table keyed by both endpoints packed into one integer,
+// which is 64 bits wide for `Vertex`s of up to 32 bits and 128 bits wide
+// otherwise.
+//
+// Beyond the edge map interface, `Insert`, `Delete`, and `Find` may all run
+// concurrently with each other, except that a key must not be inserted and
+// deleted at the same time. Before calling `Insert`, call `Reserve` (which may
+// not run concurrently with anything) with the number of upcoming insertions.
+// It grows the table or clears out the tombstones left behind by deletions
+// when the table gets too full, so probe lengths stay short no matter how many
+// edges have been added and removed over the map's lifetime.
+template <typename Elem, typename Vertex = int>
+class HashEdgeMap {
+ public:
+  HashEdgeMap() = delete;
+  // The table starts small and grows as edges are added, so `num_vertices` is
+  // unused.
+  explicit HashEdgeMap(Vertex num_vertices);
+  ~HashEdgeMap();
+  HashEdgeMap(const HashEdgeMap&) = delete;
+  HashEdgeMap(HashEdgeMap&&) = delete;
+  HashEdgeMap& operator=(const HashEdgeMap&) = delete;
+  HashEdgeMap& operator=(HashEdgeMap&&) = delete;
+
+  void BatchInsert(const std::pair<Vertex, Vertex>* edges,
+      Elem* const* elements, Vertex len);
+  bool Delete(Vertex u, Vertex v);
+  Elem* Find(Vertex u, Vertex v) const;
+
+  // Makes room for `num_inserts` more calls to `Insert`.
+  void Reserve(Vertex num_inserts);
+  // Adds edge {`u`, `v`} with element `edge` for (`u`, `v`). Returns false if
+  // the edge was already in the map.
+  bool Insert(Vertex u, Vertex v, Elem* edge);
+  // Returns the number of slots in the table.
+  size_t Capacity() const;
+
+ private:
+  using Storage = typename _internal::ElementStorage<Elem>::Type;
+  template <typename T>
+  using Pointer = typename Storage::template Pointer<T>;
+  using Key = _internal::EdgeKey<Vertex>;
+#if !defined(MCX16)
+  static_assert(sizeof(Key) <= sizeof(uint64_t),
+      "vertex ids wider than 32 bits need 128-bit CAS (-mcx16 -DMCX16)");
+#endif
+
+  struct Slot {
+    Key key;
+    Pointer<Elem> value;
+  };
+
+  // Rebuilds the table without tombstones with room for `num_inserts` more
+  // keys.
+  void Rebuild(Vertex num_inserts);
+  // Initializes `table_` to an empty table with `capacity` slots.
+  void AllocateTable(size_t capacity);
+  bool InsertKey(Key key, Elem* edge);
+
+  Pointer<Slot> table_;
+  size_t capacity_;
+  // Number of slots that are not empty, i.e., the number of keys plus the
+  // number of tombstones, counting reserved slots as full.
+  size_t num_occupied_;
+};
+
+// Wrapper around `concurrent_map::concurrentHT`, keyed like `HashEdgeMap`, with
+// room for the at most `num_vertices - 1` edges of a forest. The table is
+// never resized, and the tombstones left behind by deletions are only reused
+// by later insertions.
+template <typename Elem, typename Vertex = int>
+class ConcurrentHTEdgeMap {
+ public:
+  ConcurrentHTEdgeMap() = delete;
+  explicit ConcurrentHTEdgeMap(Vertex num_vertices);
+  ~ConcurrentHTEdgeMap();
+  ConcurrentHTEdgeMap(const ConcurrentHTEdgeMap&) = delete;
+  ConcurrentHTEdgeMap(ConcurrentHTEdgeMap&&) = delete;
+  ConcurrentHTEdgeMap& operator=(const ConcurrentHTEdgeMap&) = delete;
+  ConcurrentHTEdgeMap& operator=(ConcurrentHTEdgeMap&&) = delete;
+
+  void BatchInsert(const std::pair<Vertex, Vertex>* edges,
+      Elem* const* elements, Vertex len);
+  bool Delete(Vertex u, Vertex v);
+  Elem* Find(Vertex u, Vertex v) const;
+
+ private:
+  static_assert(std::is_same<typename _internal::ElementStorage<Elem>::Type,
+        parallel_skip_list::HeapStorage>::value,
+      "ConcurrentHTEdgeMap only holds its table on the heap");
+
+  concurrent_map::concurrentHT<
+      _internal::EdgeKey<Vertex>, Elem*, _internal::EdgeKeyHash> map_;
+};
+
+// Per-vertex adjacency index. Each vertex has a few inline slots that each
+// hold a neighbor and the element for the edge to that neighbor. Edge {u, v}
+// is recorded in both u's and v's slots when they have room, so looking it up
+// usually only reads those slots. Vertices in a forest mostly have low degree,
+// so an edge only falls back to an overflow `HashEdgeMap` when both of its
+// endpoints have full slots.
+template <typename Elem, typename Vertex = int>
+class AdjacencyEdgeMap {
+ public:
+  AdjacencyEdgeMap() = delete;
+  explicit AdjacencyEdgeMap(Vertex num_vertices);
+  ~AdjacencyEdgeMap();
+  AdjacencyEdgeMap(const AdjacencyEdgeMap&) = delete;
+  AdjacencyEdgeMap(AdjacencyEdgeMap&&) = delete;
+  AdjacencyEdgeMap& operator=(const AdjacencyEdgeMap&) = delete;
+  AdjacencyEdgeMap& operator=(AdjacencyEdgeMap&&) = delete;
+
+  void BatchInsert(const std::pair<Vertex, Vertex>* edges,
+      Elem* const* elements, Vertex len);
+  bool Delete(Vertex u, Vertex v);
+  Elem* Find(Vertex u, Vertex v) const;
+
+ private:
+  using Storage = typename _internal::ElementStorage<Elem>::Type;
+  template <typename T>
+  using Pointer = typename Storage::template Pointer<T>;
+  static constexpr int kInlineSlots{2};
+
+  // The inline slots of a vertex. Slot `i` is empty if `neighbors[i]` is -1.
+  struct Adjacency {
+    Vertex neighbors[kInlineSlots];
+    Pointer<Elem> edges[kInlineSlots];
+  };
+
+  // Tries to record element `edge` for (`u`, `v`) in `u`'s slots. Returns
+  // false if `u` has no empty slot.
+  bool InsertInline(Vertex u, Vertex v, Elem* edge);
+  bool DeleteInline(Vertex u, Vertex v);
+  Elem* FindInline(Vertex u, Vertex v) const;
+
+  Vertex num_vertices_;
+  Pointer<Adjacency> adjacency_;
+  HashEdgeMap<Elem, Vertex> overflow_;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+//                           Implementation below.                           //
+///////////////////////////////////////////////////////////////////////////////
+
+namespace _internal {
+
+// `HashEdgeMap` stores edge {u, v} with u < v under the key holding u in its
+// high half and v in its low half. Since u and v are nonnegative, the top bit
+// of a key is never set, so the keys below never collide with an edge.
+//
+// A 128-bit key may be read in two halves, so a read racing with a `CAS` may
+// see half of the old key and half of the new one. Neither half of an edge's
+// key has its top bit set, so such a mix matches no edge and neither of the
+// keys below, and probing just moves past it.
+template <typename Key>
+constexpr Key EmptyKey() { return ~static_cast<Key>(0); }
+template <typename Key>
+constexpr Key TombstoneKey() { return EmptyKey<Key>() - 1; }
+
+template <typename Vertex>
+EdgeKey<Vertex> MakeEdgeKey(Vertex u, Vertex v) {
+  return (static_cast<EdgeKey<Vertex>>(u) << (sizeof(Vertex) * 8)) |
+    static_cast<typename std::make_unsigned<Vertex>::type>(v);
+}
+
+inline uint64_t HashEdgeKey(uint64_t key) { return pbbs::hash64(key); }
+inline uint64_t HashEdgeKey(unsigned __int128 key) {
+  return pbbs::hash64(
+      pbbs::hash64(static_cast<uint64_t>(key >> 64)) ^
+      static_cast<uint64_t>(key));
+}
+
+inline size_t EdgeKeyHash::operator()(uint64_t key) const {
+  return HashEdgeKey(key);
+}
+
+inline size_t EdgeKeyHash::operator()(unsigned __int128 key) const {
+  return HashEdgeKey(key);
+}
+
+constexpr size_t kMinEdgeMapCapacity{1 << 10};
+// `HashEdgeMap::Reserve` rebuilds the table when more than
+// 1/`kEdgeMapMaxLoadInverse` of the slots would be occupied and sizes the new
+// table so that at most 1/`kEdgeMapRebuildLoadInverse` of its slots are
+// occupied.
+constexpr size_t kEdgeMapMaxLoadInverse{2};
+constexpr size_t kEdgeMapRebuildLoadInverse{4};
+
+}  // namespace _internal
+
+template <typename Elem, typename Vertex>
+HashEdgeMap<Elem, Vertex>::HashEdgeMap(Vertex) : num_occupied_{0} {
+  AllocateTable(_internal::kMinEdgeMapCapacity);
+}
+
+template <typename Elem, typename Vertex>
+HashEdgeMap<Elem, Vertex>::~HashEdgeMap() {
+  Storage::template DeleteArray<Slot>(this, table_, capacity_);
+}
+
+template <typename Elem, typename Vertex>
+void HashEdgeMap<Elem, Vertex>::AllocateTable(size_t capacity) {
+  capacity_ = capacity;
+  table_ = Storage::template NewArray<Slot>(this, capacity_);
+  parallel_for (size_t i = 0; i < capacity_; i++) {
+    table_[i].key = _internal::EmptyKey<Key>();
+    table_[i].value = nullptr;
+  }
+}
+
+template <typename Elem, typename Vertex>
+size_t HashEdgeMap<Elem, Vertex>::Capacity() const {
+  return capacity_;
+}
+
+template <typename Elem, typename Vertex>
+void HashEdgeMap<Elem, Vertex>::Reserve(Vertex num_inserts) {
+  if ((num_occupied_ + num_inserts) * _internal::kEdgeMapMaxLoadInverse >
+      capacity_) {
+    Rebuild(num_inserts);
+  }
+  num_occupied_ += num_inserts;
+}
+
+template <typename Elem, typename Vertex>
+void HashEdgeMap<Elem, Vertex>::Rebuild(Vertex num_inserts) {
+  Slot* old_table{table_};
+  const size_t old_capacity{capacity_};
+  const size_t num_keys{utils::sequence::reduce<size_t>(
+      static_cast<size_t>(0), old_capacity, addF<size_t>(),
+      [&](size_t i) -> size_t {
+        return old_table[i].key != _internal::EmptyKey<Key>() &&
+          old_table[i].key != _internal::TombstoneKey<Key>();
+      })};
+
+  const size_t min_capacity{(num_keys + num_inserts) *
+    _internal::kEdgeMapRebuildLoadInverse};
+  AllocateTable(std::max(_internal::kMinEdgeMapCapacity,
+        static_cast<size_t>(1) << pbbs::log2_up(min_capacity)));
+  parallel_for (size_t i = 0; i < old_capacity; i++) {
+    const Key key{old_table[i].key};
+    if (key != _internal::EmptyKey<Key>() &&
+        key != _internal::TombstoneKey<Key>()) {
+      InsertKey(key, old_table[i].value);
+    }
+  }
+  num_occupied_ = num_keys;
+  Storage::template DeleteArray<Slot>(this, old_table, old_capacity);
+}
+
+// Tombstones are never reused, which keeps `Insert` from racing with a
+// concurrent `Delete` or `Find` on the same slot. `Reserve` clears them out
+// instead.
+template <typename Elem, typename Vertex>
+bool HashEdgeMap<Elem, Vertex>::InsertKey(Key key, Elem* edge) {
+  const size_t mask{capacity_ - 1};
+  for (size_t i = _internal::HashEdgeKey(key) & mask; ; i = (i + 1) & mask) {
+    const Key slot_key{table_[i].key};
+    if (slot_key == _internal::EmptyKey<Key>() &&
+        CAS(&table_[i].key, _internal::EmptyKey<Key>(), key)) {
+      table_[i].value = edge;
+      return true;
+    } else if (slot_key == key) {
+      return false;
+    }
+  }
+}
+
+template <typename Elem, typename Vertex>
+bool HashEdgeMap<Elem, Vertex>::Insert(Vertex u, Vertex v, Elem* edge) {
+  if (u > v) {
+    std::swap(u, v);
+    edge = edge->twin_;
+  }
+  return InsertKey(_internal::MakeEdgeKey(u, v), edge);
+}
+
+template <typename Elem, typename Vertex>
+void HashEdgeMap<Elem, Vertex>::BatchInsert(
+    const std::pair<Vertex, Vertex>* edges, Elem* const* elements,
+    Vertex len) {
+  Reserve(len);
+  parallel_for (Vertex i = 0; i < len; i++) {
+    Insert(edges[i].first, edges[i].second, elements[i]);
+  }
+}
+
+template <typename Elem, typename Vertex>
+bool HashEdgeMap<Elem, Vertex>::Delete(Vertex u, Vertex v) {
+  if (u > v) {
+    std::swap(u, v);
+  }
+  const Key key{_internal::MakeEdgeKey(u, v)};
+  const size_t mask{capacity_ - 1};
+  for (size_t i = _internal::HashEdgeKey(key) & mask; ; i = (i + 1) & mask) {
+    const Key slot_key{table_[i].key};
+    if (slot_key == _internal::EmptyKey<Key>()) {
+      return false;
+    } else if (slot_key == key) {
+      return CAS(&table_[i].key, key, _internal::TombstoneKey<Key>());
+    }
+  }
+}
+
+// A `Find` that races with an `Insert` of the same key may see the key before
+// its value is written, in which case it returns null as if it had run before
+// the `Insert`.
+template <typename Elem, typename Vertex>
+Elem* HashEdgeMap<Elem, Vertex>::Find(Vertex u, Vertex v) const {
+  const bool swapped{u > v};
+  if (swapped) {
+    std::swap(u, v);
+  }
+  const Key key{_internal::MakeEdgeKey(u, v)};
+  const size_t mask{capacity_ - 1};
+  for (size_t i = _internal::HashEdgeKey(key) & mask; ; i = (i + 1) & mask) {
+    const Key slot_key{table_[i].key};
+    if (slot_key == _internal::EmptyKey<Key>()) {
+      return nullptr;
+    } else if (slot_key == key) {
+      Elem* uv{table_[i].value};
+      return swapped && uv != nullptr ? uv->twin_ : uv;
+    }
+  }
+}
+
+template <typename Elem, typename Vertex>
+ConcurrentHTEdgeMap<Elem, Vertex>::ConcurrentHTEdgeMap(Vertex num_vertices)
+    : map_{nullptr, static_cast<size_t>(std::max<Vertex>(num_vertices - 1, 0)),
+          _internal::EmptyKey<_internal::EdgeKey<Vertex>>(),
+          _internal::TombstoneKey<_internal::EdgeKey<Vertex>>()} {}
+
+template <typename Elem, typename Vertex>
+ConcurrentHTEdgeMap<Elem, Vertex>::~ConcurrentHTEdgeMap() {
+  map_.del();
+}
+
+template <typename Elem, typename Vertex>
+void ConcurrentHTEdgeMap<Elem, Vertex>::BatchInsert(
+    const std::pair<Vertex, Vertex>* edges, Elem* const* elements,
+    Vertex len) {
+  parallel_for (Vertex i = 0; i < len; i++) {
+    Vertex u, v;
+    std::tie(u, v) = edges[i];
+    Elem* edge{elements[i]};
+    if (u > v) {
+      std::swap(u, v);
+      edge = edge->twin_;
+    }
+    map_.insert(_internal::MakeEdgeKey(u, v), edge);
+  }
+}
+
+template <typename Elem, typename Vertex>
+bool ConcurrentHTEdgeMap<Elem, Vertex>::Delete(Vertex u, Vertex v) {
+  if (u > v) {
+    std::swap(u, v);
+  }
+  return map_.deleteVal(_internal::MakeEdgeKey(u, v));
+}
+
+template <typename Elem, typename Vertex>
+Elem* ConcurrentHTEdgeMap<Elem, Vertex>::Find(Vertex u, Vertex v) const {
+  if (u > v) {
+    Elem* vu{*map_.find(_internal::MakeEdgeKey(v, u))};
+    return vu == nullptr ? nullptr : vu->twin_;
+  } else {
+    return *map_.find(_internal::MakeEdgeKey(u, v));
+  }
+}
+
+template <typename Elem, typename Vertex>
+AdjacencyEdgeMap<Elem, Vertex>::AdjacencyEdgeMap(Vertex num_vertices)
+    : num_vertices_{num_vertices}
+    , adjacency_{Storage::template NewArray<Adjacency>(this, num_vertices_)}
+    , overflow_{num_vertices_} {
+  parallel_for (Vertex i = 0; i < num_vertices_; i++) {
+    for (int j = 0; j < kInlineSlots; j++) {
+      adjacency_[i].neighbors[j] = -1;
+    }
+  }
+}
+
+template <typename Elem, typename Vertex>
+AdjacencyEdgeMap<Elem, Vertex>::~AdjacencyEdgeMap() {
+  Storage::template DeleteArray<Adjacency>(this, adjacency_, num_vertices_);
+}
+
+template <typename Elem, typename Vertex>
+bool AdjacencyEdgeMap<Elem, Vertex>::InsertInline(
+    Vertex u, Vertex v, Elem* edge) {
+  Adjacency* adjacency{&adjacency_[u]};
+  for (int i = 0; i < kInlineSlots; i++) {
+    if (adjacency->neighbors[i] == -1 &&
+        CAS(&adjacency->neighbors[i], static_cast<Vertex>(-1), v)) {
+      adjacency->edges[i] = edge;
+      return true;
+    }
+  }
+  return false;
+}
+
+template <typename Elem, typename Vertex>
+bool AdjacencyEdgeMap<Elem, Vertex>::DeleteInline(Vertex u, Vertex v) {
+  Adjacency* adjacency{&adjacency_[u]};
+  for (int i = 0; i < kInlineSlots; i++) {
+    if (adjacency->neighbors[i] == v) {
+      adjacency->neighbors[i] = -1;
+      return true;
+    }
+  }
+  return false;
+}
+
+template <typename Elem, typename Vertex>
+Elem* AdjacencyEdgeMap<Elem, Vertex>::FindInline(Vertex u, Vertex v) const {
+  const Adjacency* adjacency{&adjacency_[u]};
+  for (int i = 0; i < kInlineSlots; i++) {
+    if (adjacency->neighbors[i] == v) {
+      return adjacency->edges[i];
+    }
+  }
+  return nullptr;
+}
+
+template <typename Elem, typename Vertex>
+void AdjacencyEdgeMap<Elem, Vertex>::BatchInsert(
+    const std::pair<Vertex, Vertex>* edges, Elem* const* elements,
+    Vertex len) {
+  bool* overflowed{pbbs::new_array_no_init<bool>(len)};
+  parallel_for (Vertex i = 0; i < len; i++) {
+    Vertex u, v;
+    std::tie(u, v) = edges[i];
+    Elem* uv{elements[i]};
+    const bool inserted_at_u{InsertInline(u, v, uv)};
+    const bool inserted_at_v{InsertInline(v, u, uv->twin_)};
+    overflowed[i] = !inserted_at_u && !inserted_at_v;
+  }
+  seq::sequence<bool> overflowed_seq{seq::sequence<bool>(overflowed, len)};
+  seq::sequence<std::pair<Vertex, Vertex>> overflow_edges_seq{
+    pbbs::pack(seq::sequence<std::pair<Vertex, Vertex>>(
+          const_cast<std::pair<Vertex, Vertex>*>(edges), len),
+        overflowed_seq)};
+  seq::sequence<Elem*> overflow_elements_seq{
+    pbbs::pack(seq::sequence<Elem*>(const_cast<Elem**>(elements), len),
+        overflowed_seq)};
+  if (overflow_edges_seq.size() > 0) {
+    overflow_.BatchInsert(overflow_edges_seq.as_array(),
+        overflow_elements_seq.as_array(), overflow_edges_seq.size());
+  }
+  pbbs::delete_array(
+      overflow_elements_seq.as_array(), overflow_elements_seq.size());
+  pbbs::delete_array(overflow_edges_seq.as_array(), overflow_edges_seq.size());
+  pbbs::delete_array(overflowed, len);
+}
+
+// An edge is in the overflow map exactly when it was recorded in neither
+// endpoint's slots.
+template <typename Elem, typename Vertex>
+bool AdjacencyEdgeMap<Elem, Vertex>::Delete(Vertex u, Vertex v) {
+  const bool deleted_at_u{DeleteInline(u, v)};
+  const bool deleted_at_v{DeleteInline(v, u)};
+  return deleted_at_u || deleted_at_v || overflow_.Delete(u, v);
+}
+
+template <typename Elem, typename Vertex>
+Elem* AdjacencyEdgeMap<Elem, Vertex>::Find(Vertex u, Vertex v) const {
+  Elem* uv{FindInline(u, v)};
+  if (uv != nullptr) {
+    return uv;
+  }
+  Elem* vu{FindInline(v, u)};
+  if (vu != nullptr) {
+    return vu->twin_;
+  }
+  return overflow_.Find(u, v);
+}
+
+}  // namespace parallel_euler_tour_tree
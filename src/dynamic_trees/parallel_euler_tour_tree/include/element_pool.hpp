@@ -0,0 +1,154 @@
+#pragma once
+
+#include <new>
+#include <type_traits>
+
+#include <sequence/parallel_skip_list/include/augmented_skip_list.hpp>
+#include <utilities/include/list_allocator.h>
+#include <utilities/include/random.h>
+#include <utilities/include/utils.h>
+
+namespace parallel_euler_tour_tree {
+
+// Element pools supply the edge elements of an `EulerTourTree`. A forest on n
+// vertices has at most n - 1 edges, so it needs at most 2(n - 1) edge elements
+// at any time.
+//
+// A pool of `Elem`s is constructed as `Pool(capacity, randomness)`, where
+// `randomness` seeds the heights of the elements, and provides
+//
+//   // Stores `len` newly allocated elements into `out`.
+//   void Allocate(Elem** out, size_t len);
+//   // Frees the `len` elements in `elements`.
+//   void Free(Elem** elements, size_t len);
+//
+// where allocated elements are in the state of an element constructed as
+// `Elem{random_int}`. Each call may use parallelism internally, but calls may
+// not run concurrently with each other.
+
+// Pool owned by a single forest that constructs all `capacity` elements up
+// front in a `parallel_skip_list::AugmentedElementBlock`. Freed elements are
+// recycled through `Elem::Reset()` rather than destroyed, so allocating and
+// freeing never touch a shared free list and never reallocate an element's
+// neighbor or value arrays. The pool shares no state with other pools.
+//
+// The pool keeps its elements and free list in `Elem::StorageType`, so it works
+// with any storage policy.
+template <typename Elem>
+class ElementArena {
+ public:
+  ElementArena() = delete;
+  ElementArena(size_t capacity, pbbs::random randomness);
+  ~ElementArena();
+  ElementArena(const ElementArena&) = delete;
+  ElementArena(ElementArena&&) = delete;
+  ElementArena& operator=(const ElementArena&) = delete;
+  ElementArena& operator=(ElementArena&&) = delete;
+
+  void Allocate(Elem** out, size_t len);
+  void Free(Elem** elements, size_t len);
+
+ private:
+  using Storage = typename Elem::StorageType;
+  template <typename T>
+  using Pointer = typename Elem::template Pointer<T>;
+
+  size_t capacity_;
+  parallel_skip_list::AugmentedElementBlock<Elem> elements_;
+  // The first `num_free_` entries of `free_list_` are the free elements.
+  Pointer<Pointer<Elem>> free_list_;
+  size_t num_free_;
+};
+
+// Pool that constructs and destroys elements on demand through the global
+// `list_allocator<Elem>` and the allocators shared by all `Elem`s. Constructing
+// the pool calls `Elem::Initialize()`, and the shared allocators are never
+// finished, so elements still allocated when the pool is destroyed are not
+// destroyed. All pools of this type share state, so operations on different
+// pools must not run concurrently. The shared allocators live on the heap, so
+// `Elem` must use `parallel_skip_list::HeapStorage`.
+template <typename Elem>
+class ListAllocatorPool {
+ public:
+  ListAllocatorPool() = delete;
+  ListAllocatorPool(size_t capacity, pbbs::random randomness);
+  ListAllocatorPool(const ListAllocatorPool&) = delete;
+  ListAllocatorPool(ListAllocatorPool&&) = delete;
+  ListAllocatorPool& operator=(const ListAllocatorPool&) = delete;
+  ListAllocatorPool& operator=(ListAllocatorPool&&) = delete;
+
+  void Allocate(Elem** out, size_t len);
+  void Free(Elem** elements, size_t len);
+
+ private:
+  static_assert(std::is_same<typename Elem::StorageType,
+        parallel_skip_list::HeapStorage>::value,
+      "ListAllocatorPool only holds elements on the heap");
+
+  pbbs::random randomness_;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+//                           Implementation below.                           //
+///////////////////////////////////////////////////////////////////////////////
+
+template <typename Elem>
+ElementArena<Elem>::ElementArena(size_t capacity, pbbs::random randomness)
+    : capacity_{capacity}
+    , elements_{capacity, randomness}
+    , num_free_{capacity} {
+  free_list_ = Storage::template NewArray<Pointer<Elem>>(this, capacity_);
+  parallel_for (size_t i = 0; i < capacity_; i++) {
+    free_list_[i] = &elements_[i];
+  }
+}
+
+template <typename Elem>
+ElementArena<Elem>::~ElementArena() {
+  Storage::template DeleteArray<Pointer<Elem>>(this, free_list_, capacity_);
+}
+
+template <typename Elem>
+void ElementArena<Elem>::Allocate(Elem** out, size_t len) {
+  num_free_ -= len;
+  Pointer<Elem>* allocated{free_list_ + num_free_};
+  parallel_for (size_t i = 0; i < len; i++) {
+    out[i] = allocated[i];
+  }
+}
+
+template <typename Elem>
+void ElementArena<Elem>::Free(Elem** elements, size_t len) {
+  Pointer<Elem>* freed{free_list_ + num_free_};
+  parallel_for (size_t i = 0; i < len; i++) {
+    elements[i]->Reset();
+    freed[i] = elements[i];
+  }
+  num_free_ += len;
+}
+
+template <typename Elem>
+ListAllocatorPool<Elem>::ListAllocatorPool(size_t, pbbs::random randomness)
+    : randomness_{randomness} {
+  Elem::Initialize();
+  list_allocator<Elem>::init();
+}
+
+template <typename Elem>
+void ListAllocatorPool<Elem>::Allocate(Elem** out, size_t len) {
+  parallel_for (size_t i = 0; i < len; i++) {
+    out[i] = list_allocator<Elem>::alloc();
+    new (out[i]) Elem{randomness_.ith_rand(i)};
+  }
+  randomness_ = randomness_.next();
+}
+
+template <typename Elem>
+void ListAllocatorPool<Elem>::Free(Elem** elements, size_t len) {
+  parallel_for (size_t i = 0; i < len; i++) {
+    elements[i]->~Elem();
+    list_allocator<Elem>::free(elements[i]);
+  }
+}
+
+}  // namespace parallel_euler_tour_tree
@@ -1,23 +1,125 @@
 #pragma once
 
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <limits>
+#include <new>
+#include <random>
+#include <string>
+#include <tuple>
 #include <utility>
+#include <vector>
 
-#include <dynamic_trees/parallel_euler_tour_tree/src/edge_map.hpp>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <dynamic_trees/parallel_euler_tour_tree/include/edge_map.hpp>
+#include <dynamic_trees/parallel_euler_tour_tree/include/element_pool.hpp>
 #include <dynamic_trees/parallel_euler_tour_tree/src/euler_tour_sequence.hpp>
+#include <sequence/parallel_skip_list/include/augmented_skip_list.hpp>
+#include <utilities/include/blockRadixSort.h>
 #include <utilities/include/random.h>
+#include <utilities/include/seq.h>
+#include <utilities/include/sequence_ops.h>
+#include <utilities/include/utils.h>
 
 namespace parallel_euler_tour_tree {
 
 // Euler tour trees represent forests. We may add an edge using `Link`, remove
-// an edge using `Cut`, and query whether two vertices are in the same tree
-// using `IsConnected`. This implementation can also exploit parallelism when
-// many edges are added at once through `BatchLink` or many edges are deleted at
-// once through `BatchCut`.
+// an edge using `Cut`, query whether two vertices are in the same tree using
+// `IsConnected`, and query the number of vertices in a tree using
+// `ComponentSize`. This implementation can also exploit parallelism when
+// many edges are added at once through `BatchLink`, many edges are deleted at
+// once through `BatchCut`, or many connectivity queries are asked at once
+// through `BatchConnected`. A window that mixes all three kinds of operations
+// can be applied at once through `ApplyBatch`. `BatchInsertSpanningEdges` adds
+// edges that may close cycles by linking only a spanning forest of them.
+// A whole forest can be loaded at once through `Build`, or written to a file
+// with `Save` and restored from it with `Load`. Batches that are large
+// compared to the forest are applied the same way, by laying out the tours
+// they touch from scratch; see `SetRebuildRatio`.
+//
+// Each vertex also holds a value, and `ComponentAggregate` combines the values
+// over a tree using `Augmentation`, which is an augmentation as described in
+// "augmented_skip_list.hpp" (e.g., `parallel_skip_list::SumAugmentation<T>`).
+// `SubtreeAggregate` does the same over the subtree hanging off an edge, and
+// `CutSideSizes` counts the vertices that cutting an edge would leave on each
+// side of it without cutting it. `IsAncestor` answers ancestor queries in a
+// tree rooted at a given vertex.
+// The order in which vertices appear in a tour is unspecified, so
+// `Augmentation::Combine` should be commutative.
+//
+// Edge elements come from an `ElementPool`, which is one of the pools in
+// "element_pool.hpp". By default, each forest preallocates all the elements it
+// could ever need and shares no state with other forests, so different forests
+// may be created, modified, and destroyed concurrently.
+//
+// Edges are normally identified by their endpoints, which the forest maps to
+// their elements with an `EdgeMap`, which is one of the edge maps in
+// "edge_map.hpp". Callers that keep track of their edges can
+// instead ask `BatchLink` for `EdgeHandle`s and cut through
+// `BatchCutByHandle`, which skips the edge map. A forest constructed with
+// `EdgeLookup::kHandlesOnly` does not keep an edge map at all.
+//
+// Vertices are identified by ids 0, 1, ..., n - 1 of the signed integer type
+// `Vertex`, which is also the type of vertex counts and batch lengths. The
+// default `int` keeps elements and edge map entries compact, while forests
+// with 2^31 or more vertices can use `int64_t`. A batch of `len` edges indexes
+// 2 * `len` elements, so `len` must be at most half the largest `Vertex`.
+//
+// `Storage` is a storage policy as described in "skip_list_base.hpp". With
+// `file_arena::FileArenaStorage`, the forest lives in a file mapped by a
+// `file_arena::FileArena` and links its elements by offsets, so it can be
+// reopened without rebuilding anything:
+//
+//   file_arena::FileArena arena;
+//   arena.Create("forest.arena", capacity);
+//   arena.SetRoot(arena.New<Forest>(n));
+//   ...
+//   // Later, possibly in another process:
+//   arena.Open("forest.arena");
+//   Forest* forest{arena.GetRoot<Forest>()};
+//
+// Such a forest must be created and destroyed through `FileArena::New` and
+// `FileArena::Delete`, must use `ElementArena` and either `HashEdgeMap` or
+// `AdjacencyEdgeMap`, and must use a trivially copyable `VertexValue`.
+// `EdgeHandle`s do not survive reopening the arena.
+template <
+  typename Augmentation = parallel_skip_list::SumAugmentation<int>,
+  template <typename> class ElementPool = ElementArena,
+  template <typename, typename> class EdgeMap = HashEdgeMap,
+  typename Vertex = int,
+  typename Storage = parallel_skip_list::HeapStorage>
 class EulerTourTree {
  public:
+  using VertexValue = typename Augmentation::ValueType;
+
+  // Identifies an edge in the forest. A handle is valid from when `BatchLink`
+  // returns it until its edge is cut.
+  class EdgeHandle;
+
+  // How a forest finds the elements of an edge that is to be cut or queried.
+  enum class EdgeLookup {
+    // Keep an edge map from endpoints to elements. All functions are
+    // available.
+    kEdgeMap,
+    // Keep no edge map. Functions that take an edge by its endpoints, namely
+    // `Cut`, `BatchCut`, `BatchCutIfPresent`, `ApplyBatch` with cuts, the
+    // subtree queries, and the cut side queries, may not be called; edges may
+    // only be cut through `BatchCutByHandle`.
+    kHandlesOnly,
+  };
+
   EulerTourTree() = delete;
-  // Initializes n-vertex forest with no edges.
-  explicit EulerTourTree(int num_vertices);
+  // Initializes n-vertex forest with no edges. Every vertex has value
+  // `Augmentation::Identity()`. The first forest of its type to be constructed
+  // in a process also runs `CalibratedRebuildRatio()`.
+  explicit EulerTourTree(
+      Vertex num_vertices, EdgeLookup edge_lookup = EdgeLookup::kEdgeMap);
   ~EulerTourTree();
   EulerTourTree(const EulerTourTree&) = delete;
   EulerTourTree(EulerTourTree&&) = delete;
@@ -25,30 +127,2531 @@ class EulerTourTree {
   EulerTourTree& operator=(EulerTourTree&&) = delete;
 
   // Returns true if `u` and `v` are in the same tree in the represented forest.
-  bool IsConnected(int u, int v) const;
+  bool IsConnected(Vertex u, Vertex v) const;
   // Adds edge {`u`, `v`} to forest. The addition of this edge must not create a
   // cycle in the graph.
-  void Link(int u, int v);
+  void Link(Vertex u, Vertex v);
   // Removes edge {`u`, `v`} from forest. The edge must be present in the
   // forest.
-  void Cut(int u, int v);
+  void Cut(Vertex u, Vertex v);
 
   // Adds all edges in the `len`-length array `links` to the forest. Adding
   // these edges must not create cycles in the graph.
-  void BatchLink(std::pair<int, int>* links, int len);
+  //
+  // If `handles` is not null, it must have space for `len` elements, and
+  // `handles[i]` is set to a handle for edge `links[i]`.
+  void BatchLink(std::pair<Vertex, Vertex>* links, Vertex len,
+      EdgeHandle* handles = nullptr);
+  // Same as `BatchLink`, but rather than splicing the edges into the existing
+  // tours, this lays out every tour of the forest from scratch, which takes
+  // O(n + m) expected work with no contention between elements, where m is the
+  // number of edges afterwards. This is the fastest way to load a whole forest
+  // at once.
+  void Build(std::pair<Vertex, Vertex>* links, Vertex len,
+      EdgeHandle* handles = nullptr);
+  // Writes the forest to the file at `path` in a binary format that `Load`
+  // reads: the order in which the tours visit the edges around each vertex,
+  // and the value of each vertex. Returns false if the file could not be
+  // written.
+  //
+  // Like `BatchInsertSpanningEdges`, this uses scratch space in the forest.
+  bool Save(const std::string& path);
+  // Loads the forest that `Save` wrote to the file at `path`, which must come
+  // from a forest with the same `Vertex` and `VertexValue` types. This forest
+  // must have no edges and must have as many vertices as the saved one.
+  // Returns false and leaves the forest unchanged if the file cannot be read
+  // or does not hold a snapshot of such a forest.
+  //
+  // The file is memory-mapped, and the tours are laid out straight from it as
+  // in `Build`, without sorting or joining. This takes O(n + m) expected work,
+  // where m is the number of edges, and only the edge map (if any) looks up
+  // the edges.
+  bool Load(const std::string& path);
+  // Same as `Load(path)`, but reads the snapshot from the `size` bytes at
+  // `data`, such as a file that the caller has memory-mapped. `data` must be
+  // aligned to 16 bytes.
+  bool Load(const char* data, size_t size);
+  // Adds to the forest a spanning forest of the edges in the `len`-length array
+  // `edges` together with the edges already in the forest, so that afterwards
+  // two vertices are connected exactly when the forest or the batch connects
+  // them. Unlike with `BatchLink`, the edges may form cycles, may repeat, may
+  // be self-loops, and may join vertices that are already connected.
+  // `accepted` must have space for `len` elements, and `accepted[i]` is set to
+  // whether `edges[i]` was added. Which edges of a cycle are left out is
+  // unspecified.
+  //
+  // This takes O(k log(1 + n/k)) expected work for a batch of k edges, like
+  // `BatchLink`. It uses scratch space in the forest, so it may not run
+  // concurrently with `ComputeComponentLabels`.
+  void BatchInsertSpanningEdges(
+      std::pair<Vertex, Vertex>* edges, Vertex len, bool* accepted);
   // Removes all edges in the `len`-length array `cuts` from the forest. These
   // edges must be present in the forest and must be distinct.
-  void BatchCut(std::pair<int, int>* cuts, int len);
+  void BatchCut(std::pair<Vertex, Vertex>* cuts, Vertex len);
+
+  // Batches of links or cuts with at least `ratio` * n edges, where n is the
+  // number of vertices, lay out the tours they touch from scratch as in `Build`
+  // instead of splitting and joining tours. Other tours are left alone. This
+  // applies to `BatchLink`, the cuts of every batch cut function, and
+  // `ApplyBatch`. An infinite `ratio` turns rebuilding off, and a ratio of 0
+  // rebuilds on every batch above the size at which batches run sequentially.
+  //
+  // By default, a forest uses `CalibratedRebuildRatio()`.
+  void SetRebuildRatio(double ratio);
+  // Returns the result of `CalibrateRebuildRatio()`, which runs only the first
+  // time this is called in a process and is cached after that. Forests that
+  // differ only in `Storage` share the result. Constructing a forest calls
+  // this, so a program that wants to pay for calibration up front rather
+  // than in its first forest's constructor may call it itself.
+  static double CalibratedRebuildRatio();
+  // Times batches of cuts and links of increasing size on a random tree both
+  // with and without rebuilding and returns the smallest ratio of batch size to
+  // forest size at which rebuilding was as fast, to within 1/8 of the ratio, or
+  // infinity if it never was. Splitting and joining takes O(k log(1 + n/k))
+  // expected work for a batch of k edges while rebuilding takes O(n), so the
+  // crossover depends mostly on k/n and carries over to forests of other sizes.
+  //
+  // This takes a fraction of a second.
+  static double CalibrateRebuildRatio();
+  // Same as `BatchCut`, except that the cuts need not be distinct or present in
+  // the forest. Each edge in the forest that appears in `cuts`, in either
+  // direction, is removed once, and the other cuts are ignored.
+  //
+  // If `applied` is not null, it must have space for `len` elements, and
+  // `applied[i]` is set to whether `cuts[i]` was the cut that removed its
+  // edge. Which of several copies of a cut removes the edge is unspecified.
+  //
+  // Like `BatchInsertSpanningEdges`, this uses scratch space in the forest.
+  void BatchCutIfPresent(
+      std::pair<Vertex, Vertex>* cuts, Vertex len, bool* applied = nullptr);
+  // Removes all edges referred to by the `len`-length array `handles` from the
+  // forest. The handles must be valid and must refer to distinct edges.
+  void BatchCutByHandle(const EdgeHandle* handles, Vertex len);
+  // For each `i`=0,1,...,`len`-1, sets `out[i]` to whether `queries[i].first`
+  // and `queries[i].second` are in the same tree in the represented forest.
+  // `out` must have space for `len` elements.
+  //
+  // This function does not modify the forest, so it may run concurrently with
+  // other `IsConnected` and `BatchConnected` calls.
+  void BatchConnected(
+      std::pair<Vertex, Vertex>* queries, Vertex len, bool* out) const;
+  // Has the same effect as calling `BatchCut(cuts, num_cuts)`, then
+  // `BatchLink(links, num_links)`, and then `BatchConnected(queries,
+  // num_queries, out)`, and has the same requirements on its input as those
+  // functions do. The links may re-add edges that are cut in the same batch.
+  //
+  // This is faster than the three separate calls because it shares work
+  // between them: it looks up all the cut edges at once, and it semisorts the
+  // link endpoints and query endpoints by vertex together.
+  void ApplyBatch(
+      std::pair<Vertex, Vertex>* cuts, Vertex num_cuts,
+      std::pair<Vertex, Vertex>* links, Vertex num_links,
+      std::pair<Vertex, Vertex>* queries, Vertex num_queries, bool* out);
+
+  // Returns the number of vertices in the tree containing `v`.
+  Vertex ComponentSize(Vertex v) const;
+  // For each `i`=0,1,...,`len`-1, sets `out[i]` to the number of vertices in
+  // the tree containing `vertices[i]`. `out` must have space for `len`
+  // elements.
+  //
+  // Like `BatchConnected`, this may run concurrently with other const
+  // functions.
+  void BatchComponentSize(Vertex* vertices, Vertex len, Vertex* out) const;
+  // Labels the trees in the forest with 0, 1, ..., c - 1, where c is the
+  // number of trees, and returns c. For each vertex `v`, sets `out[v]` to the
+  // label of the tree containing `v`. `out` must have space for n elements.
+  // Which tree gets which label is unspecified.
+  //
+  // This takes O(n) expected work, whereas finding the representative of each
+  // vertex separately takes O(n log n). It uses scratch space in the forest,
+  // so it is not const.
+  Vertex ComputeComponentLabels(Vertex* out);
+
+  // For each `i`=0,1,...,`len`-1, assigns value `values[i]` to vertex
+  // `vertices[i]`. The vertices must be distinct.
+  void BatchUpdateVertexValues(
+      Vertex* vertices, const VertexValue* values, Vertex len);
+  // Returns the result of applying the augmentation over the values of all
+  // vertices in the tree containing `v`.
+  VertexValue ComponentAggregate(Vertex v) const;
+  // For each `i`=0,1,...,`len`-1, sets `out[i]` to
+  // `ComponentAggregate(vertices[i])`. `out` must have space for `len`
+  // elements.
+  //
+  // Like `BatchConnected`, this may run concurrently with other const
+  // functions.
+  void BatchComponentAggregate(
+      Vertex* vertices, Vertex len, VertexValue* out) const;
+  // Calls `f(u)` on each vertex `u` in the tree containing `v` whose value
+  // satisfies `pred`. `pred` must hold on `Augmentation::Combine(a, b)`
+  // whenever it holds on `a` or on `b`. This lets the search skip parts of the
+  // tour that hold no such vertex, so finding k vertices takes O(k log n)
+  // expected work rather than work proportional to the size of the tree.
+  //
+  // Like `BatchConnected`, this may run concurrently with other const
+  // functions.
+  template <typename P, typename F>
+  void ForEachMatchingVertex(Vertex v, P pred, F f) const;
+
+  // Edge {`v`, `parent`} must be in the forest. Consider the tree containing
+  // the edge as rooted at some vertex on `parent`'s side of the edge. Returns
+  // the result of applying the augmentation over the values of the vertices in
+  // the subtree rooted at `v`. Equivalently, this is the aggregate over the
+  // tree that would contain `v` if the edge were cut.
+  VertexValue SubtreeAggregate(Vertex v, Vertex parent) const;
+  // Returns the number of vertices in the subtree described in
+  // `SubtreeAggregate`.
+  Vertex SubtreeSize(Vertex v, Vertex parent) const;
+  // For each `i`=0,1,...,`len`-1, sets `out[i]` to
+  // `SubtreeAggregate(queries[i].first, queries[i].second)`. `out` must have
+  // space for `len` elements.
+  //
+  // Like `BatchConnected`, this may run concurrently with other const
+  // functions.
+  void BatchSubtreeAggregate(
+      std::pair<Vertex, Vertex>* queries, Vertex len, VertexValue* out) const;
+  // For each `i`=0,1,...,`len`-1, sets `out[i]` to
+  // `SubtreeSize(queries[i].first, queries[i].second)`. `out` must have space
+  // for `len` elements.
+  void BatchSubtreeSize(
+      std::pair<Vertex, Vertex>* queries, Vertex len, Vertex* out) const;
+  // Edge {`u`, `v`} must be in the forest. Returns the number of vertices that
+  // would be in the trees containing `u` and `v`, respectively, if the edge
+  // were cut. The forest is not modified.
+  std::pair<Vertex, Vertex> CutSideSizes(Vertex u, Vertex v) const;
+  // For each `i`=0,1,...,`len`-1, sets `out[i]` to
+  // `CutSideSizes(edges[i].first, edges[i].second)`. `out` must have space for
+  // `len` elements.
+  //
+  // Like `BatchConnected`, this may run concurrently with other const
+  // functions.
+  void BatchCutSideSizes(std::pair<Vertex, Vertex>* edges, Vertex len,
+      std::pair<Vertex, Vertex>* out) const;
+
+  // Consider the tree containing `root` as rooted at `root`. Returns true if
+  // `u` is an ancestor of `v` in that tree, where every vertex is an ancestor
+  // of itself. Returns false if `u` or `v` is in a different tree.
+  //
+  // The answer comes from the positions of `v` and of the edges between `u`
+  // and its parent in the tour read from `root`, so no rooted numbering of the
+  // tree is kept, and changing the root or the tree costs nothing extra.
+  // Finding the parent edge walks over the edges of `u` starting from the
+  // ends of (`u`, `u`) in the tour, so a query takes O(d log n) expected time,
+  // where d is at most the degree of `u`.
+  bool IsAncestor(Vertex root, Vertex u, Vertex v) const;
+  // For each `i`=0,1,...,`len`-1, sets `out[i]` to
+  // `IsAncestor(roots[i], queries[i].first, queries[i].second)`. `out` must
+  // have space for `len` elements.
+  //
+  // Queries with the same root and the same `u` share one walk over the edges
+  // of `u`, so asking about a high-degree vertex many times costs O(d log n)
+  // expected work once plus O(log n) per query.
+  //
+  // Like `BatchConnected`, this may run concurrently with other const
+  // functions.
+  void BatchIsAncestor(const Vertex* roots, std::pair<Vertex, Vertex>* queries,
+      Vertex len, bool* out) const;
+  // Returns the number of vertices that the tour of the tree containing `root`
+  // visits from `root` through `v`, reading the tour from `root`, so `root`
+  // itself has rank 1. Returns 0 if `v` is in a different tree.
+  //
+  // Ordering the vertices of a tree by rank lists the vertices of each subtree
+  // of the tree rooted at `root` contiguously, though a vertex may come after
+  // some of its descendants. Like `IsAncestor`, this may run concurrently with
+  // other const functions, and it takes O(log n) expected time.
+  Vertex TourRank(Vertex root, Vertex v) const;
 
  private:
-  void BatchCutRecurse(std::pair<int, int>* cuts, int len,
-      bool* ignored, _internal::Element** join_targets,
-      _internal::Element** edge_elements);
+  template <typename, template <typename> class,
+      template <typename, typename> class, typename, typename>
+  friend class EulerTourTree;
+
+  using Element = _internal::Element<Augmentation, Vertex, Storage>;
+  using TourValue = _internal::TourValue<Augmentation, Vertex>;
+  // The forest that `CalibrateRebuildRatio` times, which is this forest on the
+  // heap.
+  using HeapForest = EulerTourTree<Augmentation, ElementPool, EdgeMap, Vertex,
+        parallel_skip_list::HeapStorage>;
 
-  int num_vertices_;
-  _internal::Element* vertices_;
-  _internal::EdgeMap edges_;
+  // Same as the public constructor, but uses `rebuild_ratio` as the rebuild
+  // ratio instead of calibrating.
+  EulerTourTree(
+      Vertex num_vertices, EdgeLookup edge_lookup, double rebuild_ratio);
+  // Does the work of `CalibratedRebuildRatio` for `HeapForest`.
+  static double CachedRebuildRatio();
+
+  // Returns the tour value summed over the subtree described in
+  // `SubtreeAggregate`.
+  TourValue GetSubtreeValue(Vertex v, Vertex parent) const;
+  // Returns the element (p, `u`), where p is the parent of `u` when the tree
+  // containing `root` is rooted at `root`. Returns null if `u` is `root` or is
+  // in a different tree.
+  const Element* FindParentEntry(Vertex root, Vertex u) const;
+  // Returns `IsAncestor(root, u, v)`, where `entry` is
+  // `FindParentEntry(root, u)`.
+  bool IsAncestorFromEntry(
+      Vertex root, Vertex u, Vertex v, const Element* entry) const;
+
+  // Adds edge {`u`, `v`} and returns the element for (`u`, `v`).
+  Element* LinkEdge(Vertex u, Vertex v);
+  // Removes edge {`u`, `v`}, where `uv` is the element for (`u`, `v`).
+  void CutEdge(Vertex u, Vertex v, Element* uv);
+
+  void BatchLinkSequential(
+      std::pair<Vertex, Vertex>* links, Vertex len, EdgeHandle* handles);
+  void BatchCutSequential(
+      std::pair<Vertex, Vertex>* cuts, Element** cut_elements, Vertex len);
+
+  // Allocates elements (u, v) and (v, u) into `new_elements[i]` and
+  // `new_elements[len + i]` for each edge {u, v} = `links[i]` and adds them to
+  // the edge map if there is one.
+  void AllocateEdgeElements(
+      std::pair<Vertex, Vertex>* links, Vertex len, Element** new_elements);
+  // Links edges whose elements have been allocated by `AllocateEdgeElements`
+  // into `new_elements`. `half_edges` is a `len`-length list of pairs (u, j),
+  // semisorted by u, holding a pair for each element (u, v) =
+  // `new_elements[j]`.
+  void BatchLinkSorted(
+      const std::pair<Vertex, Vertex>* half_edges, Vertex len,
+      Element** new_elements);
+
+  // For each `i`=0,1,...,`len`-1, stores `query(vertices[i])` into `out[i]`.
+  // `query` is evaluated only once for each distinct vertex.
+  template <typename T, typename F>
+  void BatchVertexQuery(
+      const Vertex* vertices, Vertex len, F query, T* out) const;
+  // Same as `BatchVertexQuery`, but given a `len`-length list of pairs (v, i),
+  // semisorted by v, stores `query(v)` into `out[i]` for each pair.
+  template <typename T, typename F>
+  void BatchVertexQuerySorted(
+      const std::pair<Vertex, Vertex>* sorted_vertices, Vertex len, F query,
+      T* out) const;
+  // Semisorts the `len`-length list `pairs` by their first elements, which are
+  // vertices. The sort is stable.
+  void SortByVertex(std::pair<Vertex, Vertex>* pairs, Vertex len) const;
+
+  void BatchCutRecurse(std::pair<Vertex, Vertex>* cuts, Element** cut_elements,
+      Vertex len, bool* ignored, std::pair<Element*, Element*>* join_targets);
+
+  // Returns true if a batch of `len` links or cuts should be applied by
+  // rebuilding the tours it touches.
+  bool ShouldRebuild(Vertex len) const;
+  // Returns an array holding every element of the forest, with (v, v) at index
+  // v, followed by room for `num_extra` more elements. Stores the number of
+  // elements of the forest into `*num_elements`.
+  //
+  // The edge elements out of each vertex v come in the order that the tour
+  // visits them. If `vertex_offsets` is not null, it must have room for n + 1
+  // entries, and those of v are stored from index n + `vertex_offsets[v]` up
+  // to index n + `vertex_offsets[v + 1]`. This uses the labels of the
+  // elements as scratch space.
+  Element** CollectElements(size_t num_extra, size_t* num_elements,
+      size_t* vertex_offsets = nullptr);
+  // Like `CollectElements`, but collects only the elements of the tours
+  // containing the `len` elements in `members`, which may share tours, in no
+  // particular order. This uses the labels of the elements as scratch space.
+  Element** CollectTourElements(Element* const* members, size_t len,
+      size_t num_extra, size_t* num_elements);
+  // Same as `BatchLinkSorted` and `BatchCutRecurse`, respectively, but rebuilds
+  // every tour that the batch touches.
+  void BatchLinkRebuild(
+      const std::pair<Vertex, Vertex>* half_edges, Vertex len,
+      Element** new_elements);
+  void BatchCutRebuild(std::pair<Vertex, Vertex>* cuts, Element** cut_elements,
+      Vertex len);
+
+  Vertex num_vertices_;
+  parallel_skip_list::AugmentedElementBlock<Element> vertices_;
+  ElementPool<Element> edge_elements_;
+  // Null if the forest was constructed with `EdgeLookup::kHandlesOnly`.
+  typename Storage::template Pointer<EdgeMap<Element, Vertex>> edges_;
   pbbs::random randomness_;
+  // See `SetRebuildRatio`.
+  double rebuild_ratio_;
+};
+
+template <typename Augmentation, template <typename> class ElementPool,
+    template <typename, typename> class EdgeMap, typename Vertex,
+    typename Storage>
+class EulerTourTree<
+    Augmentation, ElementPool, EdgeMap, Vertex, Storage>::EdgeHandle {
+ public:
+  EdgeHandle() = default;
+
+ private:
+  friend class EulerTourTree;
+
+  EdgeHandle(Vertex u, Vertex v, Element* uv) : u_{u}, v_{v}, uv_{uv} {}
+
+  Vertex u_;
+  Vertex v_;
+  // Element for (`u_`, `v_`).
+  Element* uv_;
 };
 
+///////////////////////////////////////////////////////////////////////////////
+//                           Implementation below.                           //
+///////////////////////////////////////////////////////////////////////////////
+
+// Some structural details:
+// To represent a tree in a forest, for each vertex v, add a loop edge (v, v),
+// and for each edge {u, v}, replace it with two directed edges (u, v) and (v,
+// u). Because the transformed tree has equal indegree and outdegree for each
+// vertex, it admits an Euler tour.
+//
+// Take any Euler tour of the tree and place it in a circular sequence data
+// structure like a skip list. Euler tours behave nicely under edge additions
+// and edge deletions, so links and cuts reduce to a few splits and joins on
+// sequences.
+//
+// The skip list is augmented with the number of vertices in each tour and with
+// the user's augmentation over vertex values: element (v, v) has size 1 and
+// holds v's value, and edge elements have size 0 and hold the identity. All
+// splits and joins go through `Element::BatchSplit` and `Element::BatchJoin` so
+// that these values stay correct.
+
+namespace _internal {
+
+// On BatchCut, randomly ignore 1/`kBatchCutRecursiveFactor` cuts and recurse
+// on them later.
+constexpr int kBatchCutRecursiveFactor{100};
+
+// Returns the root of `v` in the union-find forest given by `parents`, halving
+// the path to the root along the way. This may run concurrently with other
+// calls to `FindRoot` and `Unite` on the same forest.
+template <typename Vertex>
+Vertex FindRoot(Vertex* parents, Vertex v) {
+  while (true) {
+    const Vertex parent{parents[v]};
+    if (parent == v) {
+      return v;
+    }
+    const Vertex grandparent{parents[parent]};
+    if (grandparent != parent) {
+      CAS(&parents[v], parent, grandparent);
+    }
+    v = grandparent;
+  }
+}
+
+// Merges the sets of `u` and `v` in the union-find forest given by `parents`
+// and returns true if they were different sets. This may run concurrently with
+// other calls to `FindRoot` and `Unite` on the same forest. Exactly one of
+// several concurrent calls that would merge the same two sets returns true.
+//
+// A root is only ever hooked under a smaller root, so parents always have
+// smaller ids than their children and the forest never has a cycle.
+template <typename Vertex>
+bool Unite(Vertex* parents, Vertex u, Vertex v) {
+  while (true) {
+    u = FindRoot(parents, u);
+    v = FindRoot(parents, v);
+    if (u == v) {
+      return false;
+    }
+    if (u < v) {
+      std::swap(u, v);
+    }
+    if (CAS(&parents[u], u, v)) {
+      return true;
+    }
+  }
+}
+
+// `RankLists` ranks inputs of at most this many nodes sequentially.
+constexpr size_t kRankListsBaseSize{4096};
+// `RankLists` picks about one in every `kRankListsRulerFactor` nodes to be a
+// ruler.
+constexpr size_t kRankListsRulerFactor{16};
+
+// Takes `len` nodes forming disjoint lists, where `next[i]` is the node after
+// node i, or `len` if i ends its list. Stores into `last[i]` the node that ends
+// the list holding i and into `distances[i]` the sum of `weights[j]` over the
+// nodes j from i up to but excluding `last[i]`. If `weights` is null, every
+// node weighs 1, so `distances[i]` counts the nodes after i.
+//
+// Nodes that end their lists and a random sample of the others are rulers.
+// Every ruler and every list head walks ahead to the next ruler, recording its
+// distance from the nodes it passes. The lists of rulers are then ranked
+// recursively, and every other node reads its rank off of the walker that
+// passed it. Walks are O(log len) long with high probability, so this takes
+// O(len) expected work and O(log^2 len) depth with high probability.
+inline void RankLists(const size_t* next, const size_t* weights, size_t len,
+    size_t* last, size_t* distances, pbbs::random randomness) {
+  const auto weight{[&](size_t i) {
+    return weights == nullptr ? 1 : weights[i];
+  }};
+  bool* has_predecessor{pbbs::new_array_no_init<bool>(len)};
+  parallel_for (size_t i = 0; i < len; i++) {
+    has_predecessor[i] = false;
+  }
+  parallel_for (size_t i = 0; i < len; i++) {
+    if (next[i] != len) {
+      has_predecessor[next[i]] = true;
+    }
+  }
+  if (len <= kRankListsBaseSize) {
+    for (size_t i = 0; i < len; i++) {
+      if (has_predecessor[i]) {
+        continue;
+      }
+      size_t end{i};
+      size_t distance{0};
+      while (next[end] != len) {
+        distance += weight(end);
+        end = next[end];
+      }
+      for (size_t j = i; j != len; j = next[j]) {
+        last[j] = end;
+        distances[j] = distance;
+        distance -= next[j] == len ? 0 : weight(j);
+      }
+    }
+    pbbs::delete_array(has_predecessor, len);
+    return;
+  }
+
+  bool* is_ruler{pbbs::new_array_no_init<bool>(len)};
+  bool* is_sampled{pbbs::new_array_no_init<bool>(len)};
+  parallel_for (size_t i = 0; i < len; i++) {
+    is_sampled[i] = next[i] != len &&
+      randomness.ith_rand(i) % kRankListsRulerFactor == 0;
+    is_ruler[i] = is_sampled[i] || next[i] == len;
+  }
+  // A walker stores the ruler it reaches in `anchors` and its distance to it in
+  // `anchor_distances`. Any other node that is not a ruler stores the walker
+  // that passed it and the walker's distance to it.
+  size_t* anchors{pbbs::new_array_no_init<size_t>(len)};
+  size_t* anchor_distances{pbbs::new_array_no_init<size_t>(len)};
+  parallel_for (size_t i = 0; i < len; i++) {
+    if (is_sampled[i] || (!is_ruler[i] && !has_predecessor[i])) {
+      size_t distance{weight(i)};
+      size_t j{next[i]};
+      while (!is_ruler[j]) {
+        anchors[j] = i;
+        anchor_distances[j] = distance;
+        distance += weight(j);
+        j = next[j];
+      }
+      anchors[i] = j;
+      anchor_distances[i] = distance;
+    }
+  }
+
+  // The sampled rulers form lists of their own, which end where a sampled ruler
+  // reaches a ruler that ends its list. `last` numbers the sampled rulers for
+  // now.
+  seq::sequence<size_t> sampled{
+    pbbs::pack_index<size_t>(seq::sequence<bool>(is_sampled, len))};
+  const size_t num_sampled{sampled.size()};
+  parallel_for (size_t k = 0; k < num_sampled; k++) {
+    last[sampled[k]] = k;
+  }
+  size_t* sampled_next{pbbs::new_array_no_init<size_t>(num_sampled)};
+  size_t* sampled_weights{pbbs::new_array_no_init<size_t>(num_sampled)};
+  parallel_for (size_t k = 0; k < num_sampled; k++) {
+    const size_t anchor{anchors[sampled[k]]};
+    sampled_next[k] = is_sampled[anchor] ? last[anchor] : num_sampled;
+    sampled_weights[k] = anchor_distances[sampled[k]];
+  }
+  size_t* sampled_last{pbbs::new_array_no_init<size_t>(num_sampled)};
+  size_t* sampled_distances{pbbs::new_array_no_init<size_t>(num_sampled)};
+  RankLists(sampled_next, sampled_weights, num_sampled, sampled_last,
+      sampled_distances, randomness.next());
+
+  parallel_for (size_t k = 0; k < num_sampled; k++) {
+    const size_t final_ruler{sampled[sampled_last[k]]};
+    last[sampled[k]] = anchors[final_ruler];
+    distances[sampled[k]] =
+      sampled_distances[k] + anchor_distances[final_ruler];
+  }
+  parallel_for (size_t i = 0; i < len; i++) {
+    if (next[i] == len) {
+      last[i] = i;
+      distances[i] = 0;
+    }
+  }
+  parallel_for (size_t i = 0; i < len; i++) {
+    if (!is_ruler[i] && !has_predecessor[i]) {
+      last[i] = last[anchors[i]];
+      distances[i] = anchor_distances[i] + distances[anchors[i]];
+    }
+  }
+  parallel_for (size_t i = 0; i < len; i++) {
+    if (!is_ruler[i] && has_predecessor[i]) {
+      last[i] = last[anchors[i]];
+      distances[i] = distances[anchors[i]] - anchor_distances[i];
+    }
+  }
+
+  pbbs::delete_array(sampled_distances, num_sampled);
+  pbbs::delete_array(sampled_last, num_sampled);
+  pbbs::delete_array(sampled_weights, num_sampled);
+  pbbs::delete_array(sampled_next, num_sampled);
+  pbbs::delete_array(sampled.as_array(), num_sampled);
+  pbbs::delete_array(anchor_distances, len);
+  pbbs::delete_array(anchors, len);
+  pbbs::delete_array(is_sampled, len);
+  pbbs::delete_array(is_ruler, len);
+  pbbs::delete_array(has_predecessor, len);
+}
+
+// A file written by `EulerTourTree::Save` starts with a `SnapshotHeader`.
+// Sections follow at the byte offsets given by `SnapshotLayout`:
+//   - n + 1 `uint64_t` offsets. The edge elements out of vertex v, in the order
+//     that the tour visits them, are entries `offsets[v]` up to
+//     `offsets[v + 1]` of the next two sections.
+//   - For each edge element (v, w), the vertex w.
+//   - For each edge element (v, w), the position of (w, v) among the edge
+//     elements out of w.
+//   - The value of each vertex.
+// Both per-element sections hold `Vertex`s.
+struct SnapshotHeader {
+  char magic[8];
+  uint32_t vertex_size;
+  uint32_t value_size;
+  uint64_t num_vertices;
+  uint64_t num_edge_elements;
+};
+
+constexpr char kSnapshotMagic[8]{'E', 'T', 'T', 'S', 'N', 'A', 'P', '1'};
+// Every section starts at a multiple of this many bytes so that it can be read
+// in place from a memory-mapped file.
+constexpr size_t kSnapshotAlignment{16};
+
+struct SnapshotLayout {
+  size_t offsets;
+  size_t heads;
+  size_t twin_positions;
+  size_t values;
+  // Size of the whole file.
+  size_t size;
+};
+
+template <typename Vertex, typename VertexValue>
+SnapshotLayout GetSnapshotLayout(
+    uint64_t num_vertices, uint64_t num_edge_elements) {
+  const auto align{[](size_t offset) {
+    return (offset + kSnapshotAlignment - 1) / kSnapshotAlignment *
+      kSnapshotAlignment;
+  }};
+  SnapshotLayout layout;
+  layout.offsets = align(sizeof(SnapshotHeader));
+  layout.heads = align(layout.offsets + (num_vertices + 1) * sizeof(uint64_t));
+  layout.twin_positions =
+    align(layout.heads + num_edge_elements * sizeof(Vertex));
+  layout.values =
+    align(layout.twin_positions + num_edge_elements * sizeof(Vertex));
+  layout.size = layout.values + num_vertices * sizeof(VertexValue);
+  return layout;
+}
+
+}  // namespace _internal
+
+template <typename Augmentation, template <typename> class ElementPool,
+    template <typename, typename> class EdgeMap, typename Vertex,
+    typename Storage>
+void EulerTourTree<
+    Augmentation, ElementPool, EdgeMap, Vertex, Storage>::BatchLinkSequential(
+    std::pair<Vertex, Vertex>* links, Vertex len, EdgeHandle* handles) {
+  for (Vertex i = 0; i < len; i++) {
+    Vertex u, v;
+    std::tie(u, v) = links[i];
+    Element* uv{LinkEdge(u, v)};
+    if (handles != nullptr) {
+      handles[i] = EdgeHandle{u, v, uv};
+    }
+  }
+}
+
+template <typename Augmentation, template <typename> class ElementPool,
+    template <typename, typename> class EdgeMap, typename Vertex,
+    typename Storage>
+void EulerTourTree<
+    Augmentation, ElementPool, EdgeMap, Vertex, Storage>::BatchCutSequential(
+    std::pair<Vertex, Vertex>* cuts, Element** cut_elements, Vertex len) {
+  for (Vertex i = 0; i < len; i++) {
+    CutEdge(cuts[i].first, cuts[i].second, cut_elements[i]);
+  }
+}
+
+template <typename Augmentation, template <typename> class ElementPool,
+    template <typename, typename> class EdgeMap, typename Vertex,
+    typename Storage>
+EulerTourTree<
+    Augmentation, ElementPool, EdgeMap, Vertex, Storage>::EulerTourTree(
+    Vertex num_vertices, EdgeLookup edge_lookup)
+    : EulerTourTree{num_vertices, edge_lookup, CalibratedRebuildRatio()} {}
+
+template <typename Augmentation, template <typename> class ElementPool,
+    template <typename, typename> class EdgeMap, typename Vertex,
+    typename Storage>
+EulerTourTree<
+    Augmentation, ElementPool, EdgeMap, Vertex, Storage>::EulerTourTree(
+    Vertex num_vertices, EdgeLookup edge_lookup, double rebuild_ratio)
+    : num_vertices_{num_vertices}
+    , vertices_{static_cast<size_t>(num_vertices_), pbbs::random{}.fork(0),
+        TourValue::Vertex(Augmentation::Identity())}
+    // An `n`-vertex forest has at most `n - 1` edges, each represented by two
+    // elements.
+    , edge_elements_{
+        2 * static_cast<size_t>(std::max<Vertex>(num_vertices_ - 1, 0)),
+        pbbs::random{}.fork(1)}
+    , edges_{nullptr}
+    , randomness_{pbbs::random{}.fork(2)}
+    , rebuild_ratio_{rebuild_ratio} {
+  if (edge_lookup == EdgeLookup::kEdgeMap) {
+    EdgeMap<Element, Vertex>* edges{
+        Storage::template NewArray<EdgeMap<Element, Vertex>>(this, 1)};
+    edges_ = new (edges) EdgeMap<Element, Vertex>{num_vertices_};
+  }
+  std::pair<Element*, Element*>* self_joins{
+      pbbs::new_array_no_init<std::pair<Element*, Element*>>(num_vertices_)};
+  parallel_for (Vertex i = 0; i < num_vertices_; i++) {
+    // The Euler tour on a vertex v (a singleton tree) is simply (v, v).
+    self_joins[i] = std::make_pair(&vertices_[i], &vertices_[i]);
+  }
+  Element::BatchJoin(self_joins, num_vertices_);
+  pbbs::delete_array(self_joins, num_vertices_);
+}
+
+template <typename Augmentation, template <typename> class ElementPool,
+    template <typename, typename> class EdgeMap, typename Vertex,
+    typename Storage>
+EulerTourTree<
+    Augmentation, ElementPool, EdgeMap, Vertex, Storage>::~EulerTourTree() {
+  if (edges_ != nullptr) {
+    Storage::template DeleteArray<EdgeMap<Element, Vertex>>(this, edges_, 1);
+  }
+}
+
+template <typename Augmentation, template <typename> class ElementPool,
+    template <typename, typename> class EdgeMap, typename Vertex,
+    typename Storage>
+bool EulerTourTree<
+    Augmentation, ElementPool, EdgeMap, Vertex, Storage>::IsConnected(
+    Vertex u, Vertex v) const {
+  return vertices_[u].FindRepresentative() == vertices_[v].FindRepresentative();
+}
+
+template <typename Augmentation, template <typename> class ElementPool,
+    template <typename, typename> class EdgeMap, typename Vertex,
+    typename Storage>
+Vertex EulerTourTree<
+    Augmentation, ElementPool, EdgeMap, Vertex, Storage>::ComponentSize(
+    Vertex v) const {
+  return vertices_[v].GetSum().size;
+}
+
+template <typename Augmentation, template <typename> class ElementPool,
+    template <typename, typename> class EdgeMap, typename Vertex,
+    typename Storage>
+void EulerTourTree<Augmentation, ElementPool, EdgeMap, Vertex, Storage>::Link(
+    Vertex u, Vertex v) {
+  LinkEdge(u, v);
+}
+
+template <typename Augmentation, template <typename> class ElementPool,
+    template <typename, typename> class EdgeMap, typename Vertex,
+    typename Storage>
+typename EulerTourTree<
+    Augmentation, ElementPool, EdgeMap, Vertex, Storage>::Element*
+EulerTourTree<Augmentation, ElementPool, EdgeMap, Vertex, Storage>::LinkEdge(
+    Vertex u, Vertex v) {
+  Element* new_elements[2];
+  edge_elements_.Allocate(new_elements, 2);
+  Element* uv{new_elements[0]};
+  Element* vu{new_elements[1]};
+  uv->twin_ = vu;
+  vu->twin_ = uv;
+  if (edges_ != nullptr) {
+    const std::pair<Vertex, Vertex> edge{u, v};
+    edges_->BatchInsert(&edge, &uv, 1);
+  }
+  Element* u_left{&vertices_[u]};
+  Element* v_left{&vertices_[v]};
+  Element* u_right{u_left->GetNextElement()};
+  Element* v_right{v_left->GetNextElement()};
+  Element* splits[]{u_left, v_left};
+  Element::BatchSplit(splits, 2);
+  std::pair<Element*, Element*> joins[]{
+    std::make_pair(u_left, uv),
+    std::make_pair(uv, v_right),
+    std::make_pair(v_left, vu),
+    std::make_pair(vu, u_right)
+  };
+  Element::BatchJoin(joins, 4);
+  return uv;
+}
+
+template <typename Augmentation, template <typename> class ElementPool,
+    template <typename, typename> class EdgeMap, typename Vertex,
+    typename Storage>
+void EulerTourTree<
+    Augmentation, ElementPool, EdgeMap, Vertex, Storage>::AllocateEdgeElements(
+    std::pair<Vertex, Vertex>* links, Vertex len, Element** new_elements) {
+  edge_elements_.Allocate(new_elements, 2 * len);
+  parallel_for (Vertex i = 0; i < len; i++) {
+    Element* uv{new_elements[i]};
+    Element* vu{new_elements[len + i]};
+    uv->twin_ = vu;
+    vu->twin_ = uv;
+  }
+  if (edges_ != nullptr) {
+    edges_->BatchInsert(links, new_elements, len);
+  }
+}
+
+template <typename Augmentation, template <typename> class ElementPool,
+    template <typename, typename> class EdgeMap, typename Vertex,
+    typename Storage>
+void EulerTourTree<
+    Augmentation, ElementPool, EdgeMap, Vertex, Storage>::BatchLinkSorted(
+    const std::pair<Vertex, Vertex>* half_edges, Vertex len,
+    Element** new_elements) {
+  if (ShouldRebuild(len / 2)) {
+    BatchLinkRebuild(half_edges, len, new_elements);
+    return;
+  }
+
+  // For each vertex x that shows up in an added edge, split on (x, x). Let
+  // succ(x) denote the successor of (x, x) prior to splitting.
+  // Because `half_edges` is semisorted, the new neighbors y_1, y_2, ..., y_k of
+  // x are adjacent in it. Join (x, x) to (x, y_1). Join (y_i, x) to (x,
+  // y_{i+1}) for each i < k. Join (y_k, x) to succ(x).
+
+  Element** split_successors{pbbs::new_array_no_init<Element*>(len)};
+  // Split on each vertex that appears in the input. A vertex appears once in
+  // `splits` per incident added edge, but `BatchSplit` tolerates duplicates.
+  Element** splits{pbbs::new_array_no_init<Element*>(len)};
+  parallel_for (Vertex i = 0; i < len; i++) {
+    const Vertex u{half_edges[i].first};
+    splits[i] = &vertices_[u];
+    if (i == len - 1 || u != half_edges[i + 1].first) {
+      split_successors[i] = vertices_[u].GetNextElement();
+    }
+  }
+  Element::BatchSplit(splits, len);
+
+  // `joins[2 * i]` joins (v, u) to its successor. `joins[2 * i + 1]` joins (u,
+  // u) to (u, v) if (u, v) is the first added edge out of `u` and is unused
+  // otherwise.
+  std::pair<Element*, Element*>* joins{
+      pbbs::new_array_no_init<std::pair<Element*, Element*>>(2 * len)};
+  bool* join_used{pbbs::new_array_no_init<bool>(2 * len)};
+  parallel_for (Vertex i = 0; i < len; i++) {
+    const Vertex u{half_edges[i].first};
+    Element* uv{new_elements[half_edges[i].second]};
+    Element* vu{uv->twin_};
+    join_used[2 * i + 1] = i == 0 || u != half_edges[i - 1].first;
+    if (join_used[2 * i + 1]) {
+      joins[2 * i + 1] = std::make_pair(&vertices_[u], uv);
+    }
+    join_used[2 * i] = true;
+    if (i == len - 1 || u != half_edges[i + 1].first) {
+      joins[2 * i] = std::make_pair(vu, split_successors[i]);
+    } else {
+      joins[2 * i] = std::make_pair(vu, new_elements[half_edges[i + 1].second]);
+    }
+  }
+  seq::sequence<std::pair<Element*, Element*>> joins_seq{
+    pbbs::pack(seq::sequence<std::pair<Element*, Element*>>(joins, 2 * len),
+        seq::sequence<bool>(join_used, 2 * len))};
+  Element::BatchJoin(joins_seq.as_array(), joins_seq.size());
+
+  pbbs::delete_array(joins_seq.as_array(), joins_seq.size());
+  pbbs::delete_array(join_used, 2 * len);
+  pbbs::delete_array(joins, 2 * len);
+  pbbs::delete_array(splits, len);
+  pbbs::delete_array(split_successors, len);
+}
+
+// Each edge element's head and position come from its twin: label every edge
+// element with its tail and read off its twin's label, then do the same with
+// each edge element's position around its tail.
+template <typename Augmentation, template <typename> class ElementPool,
+    template <typename, typename> class EdgeMap, typename Vertex,
+    typename Storage>
+bool EulerTourTree<Augmentation, ElementPool, EdgeMap, Vertex, Storage>::Save(
+    const std::string& path) {
+  size_t num_elements;
+  size_t* offsets{pbbs::new_array_no_init<size_t>(num_vertices_ + 1)};
+  Element** elements{CollectElements(0, &num_elements, offsets)};
+  Element** edge_elements{elements + num_vertices_};
+  const size_t num_edge_elements{num_elements - num_vertices_};
+
+  Vertex* heads{pbbs::new_array_no_init<Vertex>(num_edge_elements)};
+  Vertex* twin_positions{pbbs::new_array_no_init<Vertex>(num_edge_elements)};
+  parallel_for (Vertex v = 0; v < num_vertices_; v++) {
+    parallel_for (size_t i = offsets[v]; i < offsets[v + 1]; i++) {
+      edge_elements[i]->label_ = v;
+    }
+  }
+  parallel_for (size_t i = 0; i < num_edge_elements; i++) {
+    heads[i] = edge_elements[i]->twin_->label_;
+  }
+  parallel_for (Vertex v = 0; v < num_vertices_; v++) {
+    parallel_for (size_t i = offsets[v]; i < offsets[v + 1]; i++) {
+      edge_elements[i]->label_ = i - offsets[v];
+    }
+  }
+  parallel_for (size_t i = 0; i < num_edge_elements; i++) {
+    twin_positions[i] = edge_elements[i]->twin_->label_;
+  }
+  parallel_for (size_t i = 0; i < num_edge_elements; i++) {
+    edge_elements[i]->label_ = _internal::kUnlabeled;
+  }
+  uint64_t* file_offsets{pbbs::new_array_no_init<uint64_t>(num_vertices_ + 1)};
+  VertexValue* values{pbbs::new_array_no_init<VertexValue>(num_vertices_)};
+  parallel_for (Vertex v = 0; v <= num_vertices_; v++) {
+    file_offsets[v] = offsets[v];
+  }
+  parallel_for (Vertex v = 0; v < num_vertices_; v++) {
+    values[v] = vertices_[v].GetValue().value;
+  }
+  pbbs::delete_array(elements, num_elements);
+  pbbs::delete_array(offsets, num_vertices_ + 1);
+
+  _internal::SnapshotHeader header{};
+  std::copy(std::begin(_internal::kSnapshotMagic),
+      std::end(_internal::kSnapshotMagic), header.magic);
+  header.vertex_size = sizeof(Vertex);
+  header.value_size = sizeof(VertexValue);
+  header.num_vertices = num_vertices_;
+  header.num_edge_elements = num_edge_elements;
+  const _internal::SnapshotLayout layout{
+    _internal::GetSnapshotLayout<Vertex, VertexValue>(
+        num_vertices_, num_edge_elements)};
+  std::ofstream file{path, std::ios::binary | std::ios::trunc};
+  size_t position{0};
+  // Pads the file up to `offset` and writes `size` bytes from `data` there.
+  const auto write_at{[&](size_t offset, const void* data, size_t size) {
+    constexpr char kPadding[_internal::kSnapshotAlignment]{};
+    file.write(kPadding, offset - position);
+    file.write(static_cast<const char*>(data), size);
+    position = offset + size;
+  }};
+  write_at(0, &header, sizeof(header));
+  write_at(layout.offsets, file_offsets,
+      (num_vertices_ + 1) * sizeof(uint64_t));
+  write_at(layout.heads, heads, num_edge_elements * sizeof(Vertex));
+  write_at(layout.twin_positions, twin_positions,
+      num_edge_elements * sizeof(Vertex));
+  write_at(layout.values, values, num_vertices_ * sizeof(VertexValue));
+  file.close();
+
+  pbbs::delete_array(values, num_vertices_);
+  pbbs::delete_array(file_offsets, num_vertices_ + 1);
+  pbbs::delete_array(twin_positions, num_edge_elements);
+  pbbs::delete_array(heads, num_edge_elements);
+  return !file.fail();
+}
+
+template <typename Augmentation, template <typename> class ElementPool,
+    template <typename, typename> class EdgeMap, typename Vertex,
+    typename Storage>
+bool EulerTourTree<Augmentation, ElementPool, EdgeMap, Vertex, Storage>::Load(
+    const std::string& path) {
+  const int fd{open(path.c_str(), O_RDONLY)};
+  if (fd < 0) {
+    return false;
+  }
+  struct stat file_status;
+  void* data{MAP_FAILED};
+  if (fstat(fd, &file_status) == 0 && file_status.st_size > 0) {
+    data = mmap(nullptr, file_status.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  }
+  close(fd);
+  if (data == MAP_FAILED) {
+    return false;
+  }
+  madvise(data, file_status.st_size, MADV_SEQUENTIAL);
+  const bool loaded{Load(static_cast<const char*>(data), file_status.st_size)};
+  munmap(data, file_status.st_size);
+  return loaded;
+}
+
+// The snapshot lists the edge elements around each vertex in the order that
+// `CollectElements` finds them, so the tour goes from (v, v) to the first edge
+// element around v, and from (v, w) to the edge element after (w, v) around w,
+// or to (w, w) if (w, v) is the last one.
+template <typename Augmentation, template <typename> class ElementPool,
+    template <typename, typename> class EdgeMap, typename Vertex,
+    typename Storage>
+bool EulerTourTree<Augmentation, ElementPool, EdgeMap, Vertex, Storage>::Load(
+    const char* data, size_t size) {
+  const _internal::SnapshotHeader* header{
+    reinterpret_cast<const _internal::SnapshotHeader*>(data)};
+  if (size < sizeof(*header) ||
+      reinterpret_cast<uintptr_t>(data) % _internal::kSnapshotAlignment != 0 ||
+      !std::equal(std::begin(_internal::kSnapshotMagic),
+        std::end(_internal::kSnapshotMagic), header->magic) ||
+      header->vertex_size != sizeof(Vertex) ||
+      header->value_size != sizeof(VertexValue) ||
+      header->num_vertices != static_cast<uint64_t>(num_vertices_) ||
+      header->num_edge_elements >
+        2 * static_cast<uint64_t>(std::max<Vertex>(num_vertices_ - 1, 0))) {
+    return false;
+  }
+  const size_t num_edge_elements{header->num_edge_elements};
+  const _internal::SnapshotLayout layout{
+    _internal::GetSnapshotLayout<Vertex, VertexValue>(
+        num_vertices_, num_edge_elements)};
+  if (size < layout.size) {
+    return false;
+  }
+  const uint64_t* offsets{
+    reinterpret_cast<const uint64_t*>(data + layout.offsets)};
+  const Vertex* heads{reinterpret_cast<const Vertex*>(data + layout.heads)};
+  const Vertex* twin_positions{
+    reinterpret_cast<const Vertex*>(data + layout.twin_positions)};
+  const VertexValue* values{
+    reinterpret_cast<const VertexValue*>(data + layout.values)};
+
+  // Check that the edge elements pair up into twins and form a forest before
+  // touching the forest.
+  if (offsets[0] != 0 || offsets[num_vertices_] != num_edge_elements) {
+    return false;
+  }
+  const size_t num_invalid_vertices{utils::sequence::reduce<size_t>(
+      static_cast<size_t>(0), static_cast<size_t>(num_vertices_),
+      addF<size_t>(),
+      [&](size_t v) -> size_t {
+        if (offsets[v] > offsets[v + 1] ||
+            offsets[v + 1] > num_edge_elements) {
+          return 1;
+        }
+        for (uint64_t i = offsets[v]; i < offsets[v + 1]; i++) {
+          const Vertex w{heads[i]};
+          if (w < 0 || w >= num_vertices_ || static_cast<size_t>(w) == v ||
+              twin_positions[i] < 0) {
+            return 1;
+          }
+          const uint64_t twin{offsets[w] + twin_positions[i]};
+          if (twin >= offsets[w + 1] || twin >= num_edge_elements ||
+              static_cast<size_t>(heads[twin]) != v ||
+              offsets[v] + twin_positions[twin] != i) {
+            return 1;
+          }
+        }
+        return 0;
+      })};
+  if (num_invalid_vertices > 0) {
+    return false;
+  }
+  // The edges must also form a forest. Each edge, seen from its smaller
+  // endpoint, must join two trees that no other edge has joined already, which
+  // also rules out a head repeated around the same vertex.
+  Vertex* parents{pbbs::new_array_no_init<Vertex>(num_vertices_)};
+  parallel_for (Vertex v = 0; v < num_vertices_; v++) {
+    parents[v] = v;
+  }
+  const size_t num_cycle_edges{utils::sequence::reduce<size_t>(
+      static_cast<size_t>(0), static_cast<size_t>(num_vertices_),
+      addF<size_t>(),
+      [&](size_t v) -> size_t {
+        size_t count{0};
+        for (uint64_t i = offsets[v]; i < offsets[v + 1]; i++) {
+          if (static_cast<size_t>(heads[i]) > v &&
+              !_internal::Unite(parents, static_cast<Vertex>(v), heads[i])) {
+            count++;
+          }
+        }
+        return count;
+      })};
+  pbbs::delete_array(parents, num_vertices_);
+  if (num_cycle_edges > 0) {
+    return false;
+  }
+
+  Element** edge_elements{
+    pbbs::new_array_no_init<Element*>(num_edge_elements)};
+  edge_elements_.Allocate(edge_elements, num_edge_elements);
+  parallel_for (size_t i = 0; i < num_edge_elements; i++) {
+    edge_elements[i]->twin_ =
+      edge_elements[offsets[heads[i]] + twin_positions[i]];
+  }
+  // `pbbs::pack` cannot take an empty input, and a forest without edges has
+  // nothing to map.
+  if (edges_ != nullptr && num_edge_elements > 0) {
+    // Map each edge to its element out of its smaller endpoint.
+    std::pair<Vertex, Vertex>* half_edges{
+      pbbs::new_array_no_init<std::pair<Vertex, Vertex>>(num_edge_elements)};
+    bool* is_forward{pbbs::new_array_no_init<bool>(num_edge_elements)};
+    parallel_for (Vertex v = 0; v < num_vertices_; v++) {
+      for (uint64_t i = offsets[v]; i < offsets[v + 1]; i++) {
+        half_edges[i] = std::make_pair(v, heads[i]);
+        is_forward[i] = v < heads[i];
+      }
+    }
+    seq::sequence<bool> is_forward_seq{
+      seq::sequence<bool>(is_forward, num_edge_elements)};
+    seq::sequence<std::pair<Vertex, Vertex>> links_seq{
+      pbbs::pack(seq::sequence<std::pair<Vertex, Vertex>>(
+            half_edges, num_edge_elements), is_forward_seq)};
+    seq::sequence<Element*> link_elements_seq{
+      pbbs::pack(seq::sequence<Element*>(edge_elements, num_edge_elements),
+          is_forward_seq)};
+    const Vertex num_links{static_cast<Vertex>(links_seq.size())};
+    edges_->BatchInsert(
+        links_seq.as_array(), link_elements_seq.as_array(), num_links);
+    pbbs::delete_array(link_elements_seq.as_array(), num_links);
+    pbbs::delete_array(links_seq.as_array(), num_links);
+    pbbs::delete_array(is_forward, num_edge_elements);
+    pbbs::delete_array(half_edges, num_edge_elements);
+  }
+
+  const size_t num_elements{num_vertices_ + num_edge_elements};
+  Element** elements{pbbs::new_array_no_init<Element*>(num_elements)};
+  Element** successors{pbbs::new_array_no_init<Element*>(num_elements)};
+  TourValue* tour_values{pbbs::new_array_no_init<TourValue>(num_vertices_)};
+  parallel_for (Vertex v = 0; v < num_vertices_; v++) {
+    elements[v] = &vertices_[v];
+    successors[v] = offsets[v] < offsets[v + 1]
+      ? edge_elements[offsets[v]]
+      : &vertices_[v];
+    tour_values[v] = TourValue::Vertex(values[v]);
+  }
+  // Every vertex is still a singleton, so this only touches its own element.
+  Element::BatchUpdate(elements, tour_values, num_vertices_);
+  parallel_for (size_t i = 0; i < num_edge_elements; i++) {
+    const Vertex w{heads[i]};
+    const uint64_t next{offsets[w] + twin_positions[i] + 1};
+    elements[num_vertices_ + i] = edge_elements[i];
+    successors[num_vertices_ + i] =
+      next < offsets[w + 1] ? edge_elements[next] : &vertices_[w];
+  }
+  Element::BatchBuild(elements, successors, num_elements);
+
+  pbbs::delete_array(tour_values, num_vertices_);
+  pbbs::delete_array(successors, num_elements);
+  pbbs::delete_array(elements, num_elements);
+  pbbs::delete_array(edge_elements, num_edge_elements);
+  return true;
+}
+
+template <typename Augmentation, template <typename> class ElementPool,
+    template <typename, typename> class EdgeMap, typename Vertex,
+    typename Storage>
+double EulerTourTree<
+    Augmentation, ElementPool, EdgeMap, Vertex,
+    Storage>::CalibratedRebuildRatio() {
+  return HeapForest::CachedRebuildRatio();
+}
+
+// The forests that `CalibrateRebuildRatio` times are built with their ratios
+// given, so they do not come back here while `ratio` is being initialized.
+template <typename Augmentation, template <typename> class ElementPool,
+    template <typename, typename> class EdgeMap, typename Vertex,
+    typename Storage>
+double EulerTourTree<
+    Augmentation, ElementPool, EdgeMap, Vertex, Storage>::CachedRebuildRatio() {
+  static const double ratio{CalibrateRebuildRatio()};
+  return ratio;
+}
+
+template <typename Augmentation, template <typename> class ElementPool,
+    template <typename, typename> class EdgeMap, typename Vertex,
+    typename Storage>
+void EulerTourTree<
+    Augmentation, ElementPool, EdgeMap, Vertex, Storage>::SetRebuildRatio(
+    double ratio) {
+  rebuild_ratio_ = ratio;
+}
+
+// Time both ways of applying batches to a random recursive tree, in which the
+// parent of each vertex v > 0 is a uniformly random vertex less than v. Each
+// timing is the fastest of a few runs to filter out noise. Doubling the ratio
+// brackets the crossover within a factor of 2, and bisection narrows it down.
+template <typename Augmentation, template <typename> class ElementPool,
+    template <typename, typename> class EdgeMap, typename Vertex,
+    typename Storage>
+double EulerTourTree<
+    Augmentation, ElementPool, EdgeMap, Vertex,
+    Storage>::CalibrateRebuildRatio() {
+  constexpr Vertex kNumVertices{1 << 14};
+  constexpr int kNumRuns{3};
+  std::vector<std::pair<Vertex, Vertex>> edges(kNumVertices - 1);
+  pbbs::random randomness{};
+  for (Vertex v = 1; v < kNumVertices; v++) {
+    edges[v - 1] = std::make_pair(
+        static_cast<Vertex>(randomness.ith_rand(v) % v), v);
+  }
+  std::shuffle(edges.begin(), edges.end(), std::mt19937{0});
+
+  HeapForest incremental{kNumVertices, HeapForest::EdgeLookup::kEdgeMap,
+    std::numeric_limits<double>::infinity()};
+  HeapForest rebuilt{kNumVertices, HeapForest::EdgeLookup::kEdgeMap, 0.0};
+  incremental.BatchLink(edges.data(), edges.size());
+  rebuilt.BatchLink(edges.data(), edges.size());
+  // Returns the time to cut and relink the first `len` edges of `forest`.
+  const auto time_batches{[&](HeapForest* forest, Vertex len) {
+    double fastest{std::numeric_limits<double>::infinity()};
+    for (int i = 0; i < kNumRuns; i++) {
+      const auto start{std::chrono::steady_clock::now()};
+      forest->BatchCut(edges.data(), len);
+      forest->BatchLink(edges.data(), len);
+      const std::chrono::duration<double> elapsed{
+        std::chrono::steady_clock::now() - start};
+      fastest = std::min(fastest, elapsed.count());
+    }
+    return fastest;
+  }};
+
+  // Returns true if rebuilding is as fast as splitting and joining on batches
+  // of `ratio` * n edges.
+  const auto rebuilding_wins{[&](double ratio) {
+    const Vertex len{static_cast<Vertex>(ratio * (kNumVertices - 1))};
+    return time_batches(&rebuilt, len) <= time_batches(&incremental, len);
+  }};
+
+  constexpr double kMinRatio{1.0 / 64};
+  constexpr int kNumBisections{3};
+  double high{kMinRatio};
+  while (high <= 1.0 && !rebuilding_wins(high)) {
+    high *= 2;
+  }
+  if (high > 1.0) {
+    return std::numeric_limits<double>::infinity();
+  } else if (high == kMinRatio) {
+    return high;
+  }
+  double low{high / 2};
+  for (int i = 0; i < kNumBisections; i++) {
+    const double middle{(low + high) / 2};
+    if (rebuilding_wins(middle)) {
+      high = middle;
+    } else {
+      low = middle;
+    }
+  }
+  return high;
+}
+
+template <typename Augmentation, template <typename> class ElementPool,
+    template <typename, typename> class EdgeMap, typename Vertex,
+    typename Storage>
+bool EulerTourTree<
+    Augmentation, ElementPool, EdgeMap, Vertex, Storage>::ShouldRebuild(
+    Vertex len) const {
+  return len >= rebuild_ratio_ * num_vertices_;
+}
+
+// The edge elements out of vertex v are (v, v).next, and then (x, v).next after
+// each edge element (v, x) out of v until reaching (v, v) again. Pointing each
+// edge element (v, x) at (x, v).next therefore strings the edge elements out of
+// v into a list that ends at (v, v), and ranking these lists gives each edge
+// element its tail and its distance from the end of the walk around its tail.
+template <typename Augmentation, template <typename> class ElementPool,
+    template <typename, typename> class EdgeMap, typename Vertex,
+    typename Storage>
+typename EulerTourTree<
+    Augmentation, ElementPool, EdgeMap, Vertex, Storage>::Element**
+EulerTourTree<
+    Augmentation, ElementPool, EdgeMap, Vertex, Storage>::CollectElements(
+    size_t num_extra, size_t* num_elements, size_t* vertex_offsets) {
+  Element** vertex_elements{pbbs::new_array_no_init<Element*>(num_vertices_)};
+  parallel_for (Vertex v = 0; v < num_vertices_; v++) {
+    vertex_elements[v] = &vertices_[v];
+  }
+  size_t len;
+  Element** tour_elements{
+    CollectTourElements(vertex_elements, num_vertices_, 0, &len)};
+  pbbs::delete_array(vertex_elements, num_vertices_);
+
+  parallel_for (size_t i = 0; i < len; i++) {
+    tour_elements[i]->label_ = i;
+  }
+  size_t* next{pbbs::new_array_no_init<size_t>(len)};
+  parallel_for (size_t i = 0; i < len; i++) {
+    const Element* element{tour_elements[i]};
+    next[i] = element->GetValue().size > 0
+      ? len
+      : static_cast<size_t>(element->twin_->GetNextElement()->label_);
+  }
+  size_t* last{pbbs::new_array_no_init<size_t>(len)};
+  size_t* distances{pbbs::new_array_no_init<size_t>(len)};
+  _internal::RankLists(next, nullptr, len, last, distances, randomness_);
+  randomness_ = randomness_.next();
+  pbbs::delete_array(next, len);
+
+  size_t* offsets{vertex_offsets != nullptr
+    ? vertex_offsets
+    : pbbs::new_array_no_init<size_t>(num_vertices_ + 1)};
+  parallel_for (Vertex v = 0; v < num_vertices_; v++) {
+    const Element* first{vertices_[v].GetNextElement()};
+    offsets[v] = first == &vertices_[v] ? 0 : distances[first->label_];
+  }
+  // `utils::sequence::scan` cannot take an empty input.
+  const size_t num_edge_elements{num_vertices_ == 0
+    ? 0
+    : utils::sequence::scan(offsets, offsets, num_vertices_, addF<size_t>(),
+        static_cast<size_t>(0))};
+  offsets[num_vertices_] = num_edge_elements;
+  *num_elements = len;
+  // Edge element (v, x) lies `distances` elements before the end of the walk
+  // around v, which ends at index n + `offsets[v + 1]`.
+  Element** elements{pbbs::new_array_no_init<Element*>(len + num_extra)};
+  parallel_for (size_t i = 0; i < len; i++) {
+    Element* element{tour_elements[i]};
+    const Vertex tail{
+      static_cast<Vertex>(tour_elements[last[i]] - &vertices_[0])};
+    if (last[i] == i) {
+      elements[tail] = element;
+    } else {
+      elements[num_vertices_ + offsets[tail + 1] - distances[i]] = element;
+    }
+    element->label_ = _internal::kUnlabeled;
+  }
+  if (vertex_offsets == nullptr) {
+    pbbs::delete_array(offsets, num_vertices_ + 1);
+  }
+  pbbs::delete_array(distances, len);
+  pbbs::delete_array(last, len);
+  pbbs::delete_array(tour_elements, len);
+  return elements;
+}
+
+// Label each tour with the first member in it, and then list the elements of
+// each labeled tour by descending its skip list in parallel. A tour of s
+// vertices has s - 1 edges and so 3s - 2 elements.
+template <typename Augmentation, template <typename> class ElementPool,
+    template <typename, typename> class EdgeMap, typename Vertex,
+    typename Storage>
+typename EulerTourTree<
+    Augmentation, ElementPool, EdgeMap, Vertex, Storage>::Element**
+EulerTourTree<
+    Augmentation, ElementPool, EdgeMap, Vertex, Storage>::CollectTourElements(
+    Element* const* members, size_t len, size_t num_extra,
+    size_t* num_elements) {
+  // `pbbs::pack` and `utils::sequence::scan` below cannot take an empty input.
+  if (len == 0) {
+    *num_elements = 0;
+    return pbbs::new_array_no_init<Element*>(num_extra);
+  }
+  constexpr Vertex kUnlabeled{_internal::kUnlabeled};
+  Element** representatives{pbbs::new_array_no_init<Element*>(len)};
+  parallel_for (size_t i = 0; i < len; i++) {
+    representatives[i] = members[i]->FindRepresentative();
+    CAS(&representatives[i]->label_, kUnlabeled, static_cast<Vertex>(i));
+  }
+  bool* is_first{pbbs::new_array_no_init<bool>(len)};
+  parallel_for (size_t i = 0; i < len; i++) {
+    is_first[i] = representatives[i]->label_ == static_cast<Vertex>(i);
+  }
+  seq::sequence<Element*> tours{
+    pbbs::pack(seq::sequence<Element*>(representatives, len),
+        seq::sequence<bool>(is_first, len))};
+  parallel_for (size_t i = 0; i < len; i++) {
+    representatives[i]->label_ = kUnlabeled;
+  }
+  pbbs::delete_array(is_first, len);
+  pbbs::delete_array(representatives, len);
+
+  const size_t num_tours{tours.size()};
+  size_t* cursors{pbbs::new_array_no_init<size_t>(num_tours)};
+  parallel_for (size_t i = 0; i < num_tours; i++) {
+    cursors[i] = 3 * tours[i]->GetSum().size - 2;
+  }
+  *num_elements = utils::sequence::scan(cursors, cursors, num_tours,
+      addF<size_t>(), static_cast<size_t>(0));
+  Element** elements{
+    pbbs::new_array_no_init<Element*>(*num_elements + num_extra)};
+  parallel_for (size_t i = 0; i < num_tours; i++) {
+    size_t* cursor{&cursors[i]};
+    tours[i]->ParallelForEachMatchingElement(
+        [](const TourValue&) { return true; },
+        [&](Element* element) {
+          elements[pbbs::fetch_and_add(cursor, 1)] = element;
+        });
+  }
+  pbbs::delete_array(cursors, num_tours);
+  pbbs::delete_array(tours.as_array(), num_tours);
+  return elements;
+}
+
+// Each element keeps its successor except at the vertices that gain edges,
+// where the new edges are spliced in as in `BatchLinkSorted`: if x gains
+// neighbors y_1, y_2, ..., y_k, then (x, x) precedes (x, y_1), (y_i, x)
+// precedes (x, y_{i+1}) for each i < k, and (y_k, x) precedes what used to
+// follow (x, x). Only the tours of vertices that gain edges are rebuilt, and
+// (x, x) is labeled with the index of (x, y_1) while the successors are found.
+template <typename Augmentation, template <typename> class ElementPool,
+    template <typename, typename> class EdgeMap, typename Vertex,
+    typename Storage>
+void EulerTourTree<
+    Augmentation, ElementPool, EdgeMap, Vertex, Storage>::BatchLinkRebuild(
+    const std::pair<Vertex, Vertex>* half_edges, Vertex len,
+    Element** new_elements) {
+  Element** linked_vertices{pbbs::new_array_no_init<Element*>(len)};
+  parallel_for (Vertex i = 0; i < len; i++) {
+    linked_vertices[i] = &vertices_[half_edges[i].first];
+  }
+  size_t num_old_elements;
+  Element** elements{
+    CollectTourElements(linked_vertices, len, len, &num_old_elements)};
+  pbbs::delete_array(linked_vertices, len);
+  const size_t num_elements{num_old_elements + len};
+  parallel_for (Vertex i = 0; i < len; i++) {
+    const Vertex u{half_edges[i].first};
+    if (i == 0 || u != half_edges[i - 1].first) {
+      vertices_[u].label_ = half_edges[i].second;
+    }
+  }
+  Element** successors{pbbs::new_array_no_init<Element*>(num_elements)};
+  parallel_for (size_t i = 0; i < num_old_elements; i++) {
+    const Vertex label{elements[i]->label_};
+    successors[i] = label == _internal::kUnlabeled
+      ? elements[i]->GetNextElement()
+      : new_elements[label];
+  }
+  parallel_for (Vertex i = 0; i < len; i++) {
+    elements[num_old_elements + i] = new_elements[i];
+  }
+  // (u, v) = `new_elements[j]` and (v, u) = `new_elements[j +/- len / 2]`.
+  const Vertex num_links{len / 2};
+  parallel_for (Vertex i = 0; i < len; i++) {
+    const Vertex u{half_edges[i].first};
+    const Vertex j{half_edges[i].second};
+    const size_t twin_index{num_old_elements +
+      (j < num_links ? j + num_links : j - num_links)};
+    if (i == len - 1 || u != half_edges[i + 1].first) {
+      successors[twin_index] = vertices_[u].GetNextElement();
+    } else {
+      successors[twin_index] = new_elements[half_edges[i + 1].second];
+    }
+  }
+  parallel_for (Vertex i = 0; i < len; i++) {
+    vertices_[half_edges[i].first].label_ = _internal::kUnlabeled;
+  }
+  Element::BatchBuild(elements, successors, num_elements);
+  pbbs::delete_array(successors, num_elements);
+  pbbs::delete_array(elements, num_elements);
+}
+
+// Each remaining element's successor is found as in `BatchCutRecurse`: start
+// at its old successor, and while that is a cut element e, move on to
+// e.twin.next. Instead of walking, which takes time linear in the degree of a
+// vertex that loses all its edges, point each cut element e at e.twin.next if
+// that is cut too, and rank the resulting lists: the successor is then
+// f.twin.next for the cut element f that ends the list holding the old
+// successor. This takes work linear in the size of the tours that hold the
+// cuts, and the other tours are left alone.
+template <typename Augmentation, template <typename> class ElementPool,
+    template <typename, typename> class EdgeMap, typename Vertex,
+    typename Storage>
+void EulerTourTree<
+    Augmentation, ElementPool, EdgeMap, Vertex, Storage>::BatchCutRebuild(
+    std::pair<Vertex, Vertex>* cuts, Element** cut_elements, Vertex len) {
+  Element** freed{pbbs::new_array_no_init<Element*>(2 * len)};
+  parallel_for (Vertex i = 0; i < len; i++) {
+    Element* uv{cut_elements[i]};
+    Element* vu{uv->twin_};
+    uv->split_mark_ = vu->split_mark_ = true;
+    freed[2 * i] = uv;
+    freed[2 * i + 1] = vu;
+    if (edges_ != nullptr) {
+      Vertex u, v;
+      std::tie(u, v) = cuts[i];
+      edges_->Delete(u, v);
+    }
+  }
+
+  size_t num_old_elements;
+  Element** old_elements{
+    CollectTourElements(cut_elements, len, 0, &num_old_elements)};
+  parallel_for (size_t i = 0; i < num_old_elements; i++) {
+    old_elements[i]->label_ = i;
+  }
+  size_t* next{pbbs::new_array_no_init<size_t>(num_old_elements)};
+  parallel_for (size_t i = 0; i < num_old_elements; i++) {
+    next[i] = num_old_elements;
+    if (old_elements[i]->split_mark_) {
+      const Element* successor{old_elements[i]->twin_->GetNextElement()};
+      if (successor->split_mark_) {
+        next[i] = successor->label_;
+      }
+    }
+  }
+  size_t* last{pbbs::new_array_no_init<size_t>(num_old_elements)};
+  size_t* distances{pbbs::new_array_no_init<size_t>(num_old_elements)};
+  _internal::RankLists(
+      next, nullptr, num_old_elements, last, distances, randomness_);
+  randomness_ = randomness_.next();
+
+  Element** old_successors{
+    pbbs::new_array_no_init<Element*>(num_old_elements)};
+  bool* is_kept{pbbs::new_array_no_init<bool>(num_old_elements)};
+  parallel_for (size_t i = 0; i < num_old_elements; i++) {
+    is_kept[i] = !old_elements[i]->split_mark_;
+    if (is_kept[i]) {
+      Element* successor{old_elements[i]->GetNextElement()};
+      if (successor->split_mark_) {
+        successor =
+          old_elements[last[successor->label_]]->twin_->GetNextElement();
+      }
+      old_successors[i] = successor;
+    }
+  }
+  parallel_for (size_t i = 0; i < num_old_elements; i++) {
+    old_elements[i]->label_ = _internal::kUnlabeled;
+  }
+  pbbs::delete_array(distances, num_old_elements);
+  pbbs::delete_array(last, num_old_elements);
+  pbbs::delete_array(next, num_old_elements);
+  seq::sequence<bool> is_kept_seq{
+    seq::sequence<bool>(is_kept, num_old_elements)};
+  seq::sequence<Element*> elements_seq{
+    pbbs::pack(seq::sequence<Element*>(old_elements, num_old_elements),
+        is_kept_seq)};
+  seq::sequence<Element*> successors_seq{
+    pbbs::pack(seq::sequence<Element*>(old_successors, num_old_elements),
+        is_kept_seq)};
+  pbbs::delete_array(is_kept, num_old_elements);
+  pbbs::delete_array(old_successors, num_old_elements);
+  pbbs::delete_array(old_elements, num_old_elements);
+
+  const size_t num_elements{elements_seq.size()};
+  Element::BatchBuild(
+      elements_seq.as_array(), successors_seq.as_array(), num_elements);
+  pbbs::delete_array(successors_seq.as_array(), num_elements);
+  pbbs::delete_array(elements_seq.as_array(), num_elements);
+  edge_elements_.Free(freed, 2 * len);
+  pbbs::delete_array(freed, 2 * len);
+}
+
+template <typename Augmentation, template <typename> class ElementPool,
+    template <typename, typename> class EdgeMap, typename Vertex,
+    typename Storage>
+void EulerTourTree<
+    Augmentation, ElementPool, EdgeMap, Vertex, Storage>::BatchLink(
+    std::pair<Vertex, Vertex>* links, Vertex len, EdgeHandle* handles) {
+  if (len <= 75) {
+    BatchLinkSequential(links, len, handles);
+    return;
+  }
+
+  // For each added edge {x, y}, allocate elements (x, y) and (y, x). Then
+  // identify which vertices each vertex x will be newly connected to by
+  // semisorting the elements by their first vertex.
+  Element** new_elements{pbbs::new_array_no_init<Element*>(2 * len)};
+  AllocateEdgeElements(links, len, new_elements);
+  if (handles != nullptr) {
+    parallel_for (Vertex i = 0; i < len; i++) {
+      handles[i] =
+        EdgeHandle{links[i].first, links[i].second, new_elements[i]};
+    }
+  }
+  std::pair<Vertex, Vertex>* half_edges{
+      pbbs::new_array_no_init<std::pair<Vertex, Vertex>>(2 * len)};
+  parallel_for (Vertex i = 0; i < len; i++) {
+    half_edges[2 * i] = std::make_pair(links[i].first, i);
+    half_edges[2 * i + 1] = std::make_pair(links[i].second, len + i);
+  }
+  SortByVertex(half_edges, 2 * len);
+  BatchLinkSorted(half_edges, 2 * len, new_elements);
+  pbbs::delete_array(half_edges, 2 * len);
+  pbbs::delete_array(new_elements, 2 * len);
+}
+
+template <typename Augmentation, template <typename> class ElementPool,
+    template <typename, typename> class EdgeMap, typename Vertex,
+    typename Storage>
+void EulerTourTree<Augmentation, ElementPool, EdgeMap, Vertex, Storage>::Build(
+    std::pair<Vertex, Vertex>* links, Vertex len, EdgeHandle* handles) {
+  Element** new_elements{pbbs::new_array_no_init<Element*>(2 * len)};
+  AllocateEdgeElements(links, len, new_elements);
+  if (handles != nullptr) {
+    parallel_for (Vertex i = 0; i < len; i++) {
+      handles[i] =
+        EdgeHandle{links[i].first, links[i].second, new_elements[i]};
+    }
+  }
+  std::pair<Vertex, Vertex>* half_edges{
+      pbbs::new_array_no_init<std::pair<Vertex, Vertex>>(2 * len)};
+  parallel_for (Vertex i = 0; i < len; i++) {
+    half_edges[2 * i] = std::make_pair(links[i].first, i);
+    half_edges[2 * i + 1] = std::make_pair(links[i].second, len + i);
+  }
+  SortByVertex(half_edges, 2 * len);
+  BatchLinkRebuild(half_edges, 2 * len, new_elements);
+  pbbs::delete_array(half_edges, 2 * len);
+  pbbs::delete_array(new_elements, 2 * len);
+}
+
+// Contract each tree of the forest to its representative element. An edge of
+// the batch belongs in the spanning forest if it joins two representatives
+// that the edges accepted so far have not already joined, which is what a
+// concurrent union-find over the representatives decides. To give the
+// union-find small ids, each representative that the batch touches is labeled
+// with the index of one of the endpoints in the batch that it represents.
+template <typename Augmentation, template <typename> class ElementPool,
+    template <typename, typename> class EdgeMap, typename Vertex,
+    typename Storage>
+void EulerTourTree<
+    Augmentation, ElementPool, EdgeMap, Vertex,
+    Storage>::BatchInsertSpanningEdges(
+    std::pair<Vertex, Vertex>* edges, Vertex len, bool* accepted) {
+  constexpr Vertex kUnlabeled{_internal::kUnlabeled};
+  // `pbbs::pack` below cannot take an empty input.
+  if (len == 0) {
+    return;
+  }
+
+  // `endpoints[2 * i]` and `endpoints[2 * i + 1]` are the endpoints of
+  // `edges[i]`. They are later replaced by the ids of their representatives.
+  Vertex* endpoints{pbbs::new_array_no_init<Vertex>(2 * len)};
+  parallel_for (Vertex i = 0; i < len; i++) {
+    endpoints[2 * i] = edges[i].first;
+    endpoints[2 * i + 1] = edges[i].second;
+  }
+  Element** representatives{pbbs::new_array_no_init<Element*>(2 * len)};
+  BatchVertexQuery(endpoints, 2 * len,
+      [&](Vertex v) { return vertices_[v].FindRepresentative(); },
+      representatives);
+  parallel_for (Vertex i = 0; i < 2 * len; i++) {
+    CAS(&representatives[i]->label_, kUnlabeled, i);
+  }
+  Vertex* parents{pbbs::new_array_no_init<Vertex>(2 * len)};
+  parallel_for (Vertex i = 0; i < 2 * len; i++) {
+    endpoints[i] = representatives[i]->label_;
+    parents[i] = i;
+  }
+  parallel_for (Vertex i = 0; i < len; i++) {
+    accepted[i] =
+      _internal::Unite(parents, endpoints[2 * i], endpoints[2 * i + 1]);
+  }
+  parallel_for (Vertex i = 0; i < 2 * len; i++) {
+    representatives[i]->label_ = kUnlabeled;
+  }
+  pbbs::delete_array(parents, 2 * len);
+  pbbs::delete_array(representatives, 2 * len);
+  pbbs::delete_array(endpoints, 2 * len);
+
+  seq::sequence<std::pair<Vertex, Vertex>> links_seq{
+    pbbs::pack(seq::sequence<std::pair<Vertex, Vertex>>(edges, len),
+        seq::sequence<bool>(accepted, len))};
+  BatchLink(links_seq.as_array(), links_seq.size());
+  pbbs::delete_array(links_seq.as_array(), links_seq.size());
+}
+
+template <typename Augmentation, template <typename> class ElementPool,
+    template <typename, typename> class EdgeMap, typename Vertex,
+    typename Storage>
+void EulerTourTree<Augmentation, ElementPool, EdgeMap, Vertex, Storage>::Cut(
+    Vertex u, Vertex v) {
+  CutEdge(u, v, edges_->Find(u, v));
+}
+
+template <typename Augmentation, template <typename> class ElementPool,
+    template <typename, typename> class EdgeMap, typename Vertex,
+    typename Storage>
+void EulerTourTree<
+    Augmentation, ElementPool, EdgeMap, Vertex, Storage>::CutEdge(
+    Vertex u, Vertex v, Element* uv) {
+  Element* vu{uv->twin_};
+  if (edges_ != nullptr) {
+    edges_->Delete(u, v);
+  }
+  Element* u_left{uv->GetPreviousElement()};
+  Element* v_left{vu->GetPreviousElement()};
+  Element* v_right{uv->GetNextElement()};
+  Element* u_right{vu->GetNextElement()};
+  Element* splits[]{uv, vu, u_left, v_left};
+  Element::BatchSplit(splits, 4);
+  edge_elements_.Free(splits, 2);
+  std::pair<Element*, Element*> joins[]{
+    std::make_pair(u_left, u_right),
+    std::make_pair(v_left, v_right)
+  };
+  Element::BatchJoin(joins, 2);
+}
+
+// `cut_elements[i]` is the sequence element corresponding to edge `cuts[i]`.
+// Callers look these up before recursing so that each edge is looked up once,
+// or not at all in the case of `BatchCutByHandle`.
+//
+// `ignored` and `join_targets` are scratch space.
+// `ignored[i]` will be set to true if `cuts[i]` will not be executed in this
+// round of recursion.
+// `join_targets` stores pairs of sequence elements that need to be joined to
+// each other. `join_targets[2 * i]` and `join_targets[2 * i + 1]` hold the
+// joins that close up the gaps left by removing `cuts[i]`, and a join is
+// skipped if its first element is null.
+template <typename Augmentation, template <typename> class ElementPool,
+    template <typename, typename> class EdgeMap, typename Vertex,
+    typename Storage>
+void EulerTourTree<
+    Augmentation, ElementPool, EdgeMap, Vertex, Storage>::BatchCutRecurse(
+    std::pair<Vertex, Vertex>* cuts, Element** cut_elements, Vertex len,
+    bool* ignored, std::pair<Element*, Element*>* join_targets) {
+  if (len <= 75) {
+    BatchCutSequential(cuts, cut_elements, len);
+    return;
+  }
+  if (ShouldRebuild(len)) {
+    BatchCutRebuild(cuts, cut_elements, len);
+    return;
+  }
+
+  // Notation: "(x, y).next" is the next element in the tour (x, y) is in. "(x,
+  // y).prev" is the previous element. "(x, y).twin" is (y, x).
+  // For each edge {x, y} to cut:
+  // Sequentially, we'd want to join (y, x).prev to (x, y).next and (x, y).prev
+  // to (y, x).next. We can't correctly do this if any of those four elements
+  // are to be cut and removed as well. Instead, for dealing with connecting (y,
+  // x).prev to (x, y).next (dealing with connecting (x, y).prev to (y,x ).next
+  // is symmetric), we do the following:
+  // - If (y, x).prev is to be cut, then do nothing --- some other thread will
+  // deal with this.
+  // - Otherwise, start with element e = (x, y).next. So long as e is to be cut,
+  // traverse to the next possible join location at e := e.next.twin. Join
+  // (y,x).prev to e.
+  // This strategy doesn't have good depth since we may have to traverse on e
+  // for a long time. To fix this, we randomly ignore some cuts so that all
+  // traversal lengths are O(log n) with high probability. We perform all
+  // unignored cuts as described above, and recurse on the ignored cuts
+  // afterwards.
+
+  parallel_for (Vertex i = 0; i < len; i++) {
+    ignored[i] =
+      randomness_.ith_rand(i) % _internal::kBatchCutRecursiveFactor == 0;
+
+    if (!ignored[i]) {
+      Element* uv{cut_elements[i]};
+      Element* vu{uv->twin_};
+      uv->split_mark_ = vu->split_mark_ = true;
+    }
+  }
+  randomness_ = randomness_.next();
+
+  parallel_for (Vertex i = 0; i < len; i++) {
+    if (!ignored[i]) {
+      Element* uv{cut_elements[i]};
+      Element* vu{uv->twin_};
+
+      Element* left_target{uv->GetPreviousElement()};
+      if (left_target->split_mark_) {
+        join_targets[2 * i].first = nullptr;
+      } else {
+        Element* right_target{vu->GetNextElement()};
+        while (right_target->split_mark_) {
+          right_target = right_target->twin_->GetNextElement();
+        }
+        join_targets[2 * i] = std::make_pair(left_target, right_target);
+      }
+
+      left_target = vu->GetPreviousElement();
+      if (left_target->split_mark_) {
+        join_targets[2 * i + 1].first = nullptr;
+      } else {
+        Element* right_target{uv->GetNextElement()};
+        while (right_target->split_mark_) {
+          right_target = right_target->twin_->GetNextElement();
+        }
+        join_targets[2 * i + 1] = std::make_pair(left_target, right_target);
+      }
+    }
+  }
+
+  // Split before and after each unignored edge. An element may appear in
+  // `splits` more than once, but `BatchSplit` tolerates duplicates.
+  Element** splits{pbbs::new_array_no_init<Element*>(4 * len)};
+  bool* split_used{pbbs::new_array_no_init<bool>(4 * len)};
+  parallel_for (Vertex i = 0; i < len; i++) {
+    for (int j = 0; j < 4; j++) {
+      split_used[4 * i + j] = !ignored[i];
+    }
+    if (!ignored[i]) {
+      Element* uv{cut_elements[i]};
+      Element* vu{uv->twin_};
+      splits[4 * i] = uv;
+      splits[4 * i + 1] = vu;
+      splits[4 * i + 2] = uv->GetPreviousElement();
+      splits[4 * i + 3] = vu->GetPreviousElement();
+    }
+  }
+  seq::sequence<Element*> splits_seq{
+    pbbs::pack(seq::sequence<Element*>(splits, 4 * len),
+        seq::sequence<bool>(split_used, 4 * len))};
+  Element::BatchSplit(splits_seq.as_array(), splits_seq.size());
+  pbbs::delete_array(splits_seq.as_array(), splits_seq.size());
+  pbbs::delete_array(split_used, 4 * len);
+  pbbs::delete_array(splits, 4 * len);
+
+  bool* join_used{pbbs::new_array_no_init<bool>(2 * len)};
+  Element** freed{pbbs::new_array_no_init<Element*>(2 * len)};
+  bool* freed_used{pbbs::new_array_no_init<bool>(2 * len)};
+  parallel_for (Vertex i = 0; i < len; i++)  {
+    join_used[2 * i] = !ignored[i] && join_targets[2 * i].first != nullptr;
+    join_used[2 * i + 1] =
+      !ignored[i] && join_targets[2 * i + 1].first != nullptr;
+    freed_used[2 * i] = freed_used[2 * i + 1] = !ignored[i];
+    if (!ignored[i]) {
+      Element* uv{cut_elements[i]};
+      freed[2 * i] = uv;
+      freed[2 * i + 1] = uv->twin_;
+      if (edges_ != nullptr) {
+        Vertex u, v;
+        std::tie(u, v) = cuts[i];
+        edges_->Delete(u, v);
+      }
+    }
+  }
+  seq::sequence<Element*> freed_seq{
+    pbbs::pack(seq::sequence<Element*>(freed, 2 * len),
+        seq::sequence<bool>(freed_used, 2 * len))};
+  edge_elements_.Free(freed_seq.as_array(), freed_seq.size());
+  pbbs::delete_array(freed_seq.as_array(), freed_seq.size());
+  pbbs::delete_array(freed_used, 2 * len);
+  pbbs::delete_array(freed, 2 * len);
+  seq::sequence<std::pair<Element*, Element*>> joins_seq{
+    pbbs::pack(
+        seq::sequence<std::pair<Element*, Element*>>(join_targets, 2 * len),
+        seq::sequence<bool>(join_used, 2 * len))};
+  Element::BatchJoin(joins_seq.as_array(), joins_seq.size());
+  pbbs::delete_array(joins_seq.as_array(), joins_seq.size());
+  pbbs::delete_array(join_used, 2 * len);
+
+  seq::sequence<std::pair<Vertex, Vertex>> cuts_seq{
+      seq::sequence<std::pair<Vertex, Vertex>>(cuts, len)};
+  seq::sequence<Element*> cut_elements_seq{
+      seq::sequence<Element*>(cut_elements, len)};
+  seq::sequence<bool> ignored_seq{seq::sequence<bool>(ignored, len)};
+  seq::sequence<std::pair<Vertex, Vertex>> next_cuts_seq{
+    pbbs::pack(cuts_seq, ignored_seq)};
+  seq::sequence<Element*> next_cut_elements_seq{
+    pbbs::pack(cut_elements_seq, ignored_seq)};
+  BatchCutRecurse(next_cuts_seq.as_array(), next_cut_elements_seq.as_array(),
+      next_cuts_seq.size(), ignored, join_targets);
+  pbbs::delete_array(
+      next_cut_elements_seq.as_array(), next_cut_elements_seq.size());
+  pbbs::delete_array(next_cuts_seq.as_array(), next_cuts_seq.size());
+}
+
+template <typename Augmentation, template <typename> class ElementPool,
+    template <typename, typename> class EdgeMap, typename Vertex,
+    typename Storage>
+void EulerTourTree<
+    Augmentation, ElementPool, EdgeMap, Vertex, Storage>::BatchCut(
+    std::pair<Vertex, Vertex>* cuts, Vertex len) {
+  if (len <= 75) {
+    for (Vertex i = 0; i < len; i++) {
+      Cut(cuts[i].first, cuts[i].second);
+    }
+    return;
+  }
+  Element** cut_elements{pbbs::new_array_no_init<Element*>(len)};
+  parallel_for (Vertex i = 0; i < len; i++) {
+    cut_elements[i] = edges_->Find(cuts[i].first, cuts[i].second);
+  }
+  bool* ignored{pbbs::new_array_no_init<bool>(len)};
+  std::pair<Element*, Element*>* join_targets{
+    pbbs::new_array_no_init<std::pair<Element*, Element*>>(2 * len)};
+  BatchCutRecurse(cuts, cut_elements, len, ignored, join_targets);
+  pbbs::delete_array(join_targets, 2 * len);
+  pbbs::delete_array(ignored, len);
+  pbbs::delete_array(cut_elements, len);
+}
+
+// An edge is present if the edge map finds an element for it. Copies of the
+// same edge, in either direction, find the same pair of twin elements, and the
+// copies race to claim the label of the element of the pair at the lower
+// address so that only one of them is applied.
+template <typename Augmentation, template <typename> class ElementPool,
+    template <typename, typename> class EdgeMap, typename Vertex,
+    typename Storage>
+void EulerTourTree<
+    Augmentation, ElementPool, EdgeMap, Vertex, Storage>::BatchCutIfPresent(
+    std::pair<Vertex, Vertex>* cuts, Vertex len, bool* applied) {
+  constexpr Vertex kUnlabeled{_internal::kUnlabeled};
+  // `pbbs::pack` below cannot take an empty input.
+  if (len == 0) {
+    return;
+  }
+
+  Element** cut_elements{pbbs::new_array_no_init<Element*>(len)};
+  // `claimants[i]` is the element whose label `cuts[i]` claims, or null if the
+  // edge is absent.
+  Element** claimants{pbbs::new_array_no_init<Element*>(len)};
+  parallel_for (Vertex i = 0; i < len; i++) {
+    Element* uv{edges_->Find(cuts[i].first, cuts[i].second)};
+    cut_elements[i] = uv;
+    claimants[i] = uv == nullptr ? nullptr : std::min(uv, uv->twin_);
+    if (claimants[i] != nullptr) {
+      CAS(&claimants[i]->label_, kUnlabeled, i);
+    }
+  }
+  bool* is_applied{
+    applied != nullptr ? applied : pbbs::new_array_no_init<bool>(len)};
+  parallel_for (Vertex i = 0; i < len; i++) {
+    is_applied[i] = claimants[i] != nullptr && claimants[i]->label_ == i;
+  }
+  parallel_for (Vertex i = 0; i < len; i++) {
+    if (is_applied[i]) {
+      claimants[i]->label_ = kUnlabeled;
+    }
+  }
+  pbbs::delete_array(claimants, len);
+
+  seq::sequence<bool> is_applied_seq{seq::sequence<bool>(is_applied, len)};
+  seq::sequence<std::pair<Vertex, Vertex>> applied_cuts_seq{
+    pbbs::pack(seq::sequence<std::pair<Vertex, Vertex>>(cuts, len),
+        is_applied_seq)};
+  seq::sequence<Element*> applied_elements_seq{
+    pbbs::pack(seq::sequence<Element*>(cut_elements, len), is_applied_seq)};
+  pbbs::delete_array(cut_elements, len);
+  if (applied == nullptr) {
+    pbbs::delete_array(is_applied, len);
+  }
+
+  const Vertex num_applied{static_cast<Vertex>(applied_cuts_seq.size())};
+  bool* ignored{pbbs::new_array_no_init<bool>(num_applied)};
+  std::pair<Element*, Element*>* join_targets{
+    pbbs::new_array_no_init<std::pair<Element*, Element*>>(2 * num_applied)};
+  BatchCutRecurse(applied_cuts_seq.as_array(),
+      applied_elements_seq.as_array(), num_applied, ignored, join_targets);
+  pbbs::delete_array(join_targets, 2 * num_applied);
+  pbbs::delete_array(ignored, num_applied);
+  pbbs::delete_array(applied_elements_seq.as_array(), num_applied);
+  pbbs::delete_array(applied_cuts_seq.as_array(), num_applied);
+}
+
+template <typename Augmentation, template <typename> class ElementPool,
+    template <typename, typename> class EdgeMap, typename Vertex,
+    typename Storage>
+void EulerTourTree<
+    Augmentation, ElementPool, EdgeMap, Vertex, Storage>::BatchCutByHandle(
+    const EdgeHandle* handles, Vertex len) {
+  std::pair<Vertex, Vertex>* cuts{
+    pbbs::new_array_no_init<std::pair<Vertex, Vertex>>(len)};
+  Element** cut_elements{pbbs::new_array_no_init<Element*>(len)};
+  parallel_for (Vertex i = 0; i < len; i++) {
+    cuts[i] = std::make_pair(handles[i].u_, handles[i].v_);
+    cut_elements[i] = handles[i].uv_;
+  }
+  bool* ignored{pbbs::new_array_no_init<bool>(len)};
+  std::pair<Element*, Element*>* join_targets{
+    pbbs::new_array_no_init<std::pair<Element*, Element*>>(2 * len)};
+  BatchCutRecurse(cuts, cut_elements, len, ignored, join_targets);
+  pbbs::delete_array(join_targets, 2 * len);
+  pbbs::delete_array(ignored, len);
+  pbbs::delete_array(cut_elements, len);
+  pbbs::delete_array(cuts, len);
+}
+
+// The key range is computed as a `long` so that it does not overflow when
+// `num_vertices_` is the largest `Vertex`.
+template <typename Augmentation, template <typename> class ElementPool,
+    template <typename, typename> class EdgeMap, typename Vertex,
+    typename Storage>
+void EulerTourTree<
+    Augmentation, ElementPool, EdgeMap, Vertex, Storage>::SortByVertex(
+    std::pair<Vertex, Vertex>* pairs, Vertex len) const {
+  intSort::iSort(pairs, len, static_cast<long>(num_vertices_) + 1,
+      firstF<Vertex, Vertex>());
+}
+
+template <typename Augmentation, template <typename> class ElementPool,
+    template <typename, typename> class EdgeMap, typename Vertex,
+    typename Storage>
+template <typename T, typename F>
+void EulerTourTree<
+    Augmentation, ElementPool, EdgeMap, Vertex, Storage>::BatchVertexQuery(
+    const Vertex* vertices, Vertex len, F query, T* out) const {
+  if (len <= 75) {
+    parallel_for (Vertex i = 0; i < len; i++) {
+      out[i] = query(vertices[i]);
+    }
+    return;
+  }
+
+  // A batch of queries often mentions the same vertex many times. Semisort the
+  // vertices so that copies of the same vertex are adjacent, answer the query
+  // once at the first copy, and then broadcast the answer to the rest of the
+  // copies.
+  std::pair<Vertex, Vertex>* sorted_vertices{
+      pbbs::new_array_no_init<std::pair<Vertex, Vertex>>(len)};
+  parallel_for (Vertex i = 0; i < len; i++) {
+    sorted_vertices[i] = std::make_pair(vertices[i], i);
+  }
+  SortByVertex(sorted_vertices, len);
+  BatchVertexQuerySorted(sorted_vertices, len, query, out);
+  pbbs::delete_array(sorted_vertices, len);
+}
+
+template <typename Augmentation, template <typename> class ElementPool,
+    template <typename, typename> class EdgeMap, typename Vertex,
+    typename Storage>
+template <typename T, typename F>
+void EulerTourTree<
+    Augmentation, ElementPool, EdgeMap, Vertex,
+    Storage>::BatchVertexQuerySorted(
+    const std::pair<Vertex, Vertex>* sorted_vertices, Vertex len, F query,
+    T* out) const {
+  // `run_starts[i]` is the index in `sorted_vertices` of the first copy of
+  // `sorted_vertices[i].first`.
+  Vertex* run_starts{pbbs::new_array_no_init<Vertex>(len)};
+  parallel_for (Vertex i = 0; i < len; i++) {
+    run_starts[i] =
+      i == 0 || sorted_vertices[i].first != sorted_vertices[i - 1].first
+      ? i
+      : 0;
+  }
+  utils::sequence::scanI(
+      run_starts, run_starts, len, maxF<Vertex>(), Vertex{0});
+
+  parallel_for (Vertex i = 0; i < len; i++) {
+    if (run_starts[i] == i) {
+      out[sorted_vertices[i].second] = query(sorted_vertices[i].first);
+    }
+  }
+  parallel_for (Vertex i = 0; i < len; i++) {
+    if (run_starts[i] != i) {
+      out[sorted_vertices[i].second] =
+        out[sorted_vertices[run_starts[i]].second];
+    }
+  }
+
+  pbbs::delete_array(run_starts, len);
+}
+
+template <typename Augmentation, template <typename> class ElementPool,
+    template <typename, typename> class EdgeMap, typename Vertex,
+    typename Storage>
+void EulerTourTree<
+    Augmentation, ElementPool, EdgeMap, Vertex, Storage>::BatchConnected(
+    std::pair<Vertex, Vertex>* queries, Vertex len, bool* out) const {
+  // `endpoints[2 * i]` and `endpoints[2 * i + 1]` are the endpoints of
+  // `queries[i]`.
+  Vertex* endpoints{pbbs::new_array_no_init<Vertex>(2 * len)};
+  parallel_for (Vertex i = 0; i < len; i++) {
+    endpoints[2 * i] = queries[i].first;
+    endpoints[2 * i + 1] = queries[i].second;
+  }
+  Element** representatives{pbbs::new_array_no_init<Element*>(2 * len)};
+  BatchVertexQuery(endpoints, 2 * len,
+      [&](Vertex v) { return vertices_[v].FindRepresentative(); },
+      representatives);
+  parallel_for (Vertex i = 0; i < len; i++) {
+    out[i] = representatives[2 * i] == representatives[2 * i + 1];
+  }
+  pbbs::delete_array(representatives, 2 * len);
+  pbbs::delete_array(endpoints, 2 * len);
+}
+
+template <typename Augmentation, template <typename> class ElementPool,
+    template <typename, typename> class EdgeMap, typename Vertex,
+    typename Storage>
+void EulerTourTree<
+    Augmentation, ElementPool, EdgeMap, Vertex, Storage>::ApplyBatch(
+    std::pair<Vertex, Vertex>* cuts, Vertex num_cuts,
+    std::pair<Vertex, Vertex>* links, Vertex num_links,
+    std::pair<Vertex, Vertex>* queries, Vertex num_queries, bool* out) {
+  if (num_cuts + num_links + num_queries <= 75) {
+    for (Vertex i = 0; i < num_cuts; i++) {
+      Cut(cuts[i].first, cuts[i].second);
+    }
+    BatchLinkSequential(links, num_links, nullptr);
+    for (Vertex i = 0; i < num_queries; i++) {
+      out[i] = IsConnected(queries[i].first, queries[i].second);
+    }
+    return;
+  }
+
+  // The edge map holds each cut edge at this point, whereas it may not hold a
+  // cut edge that is re-added by a link once the links are inserted.
+  Element** cut_elements{pbbs::new_array_no_init<Element*>(num_cuts)};
+  parallel_for (Vertex i = 0; i < num_cuts; i++) {
+    cut_elements[i] = edges_->Find(cuts[i].first, cuts[i].second);
+  }
+
+  // Semisort the endpoints of the links and queries together. An entry (x, j)
+  // with j < `num_link_entries` stands for the element `new_elements[j]` out of
+  // x as in `BatchLink`. Otherwise it stands for query endpoint
+  // `j - num_link_entries`, where `queries[i]` has endpoints 2 * i and 2 * i +
+  // 1.
+  const Vertex num_link_entries{2 * num_links};
+  const Vertex num_query_entries{2 * num_queries};
+  const Vertex num_entries{num_link_entries + num_query_entries};
+  std::pair<Vertex, Vertex>* entries{
+      pbbs::new_array_no_init<std::pair<Vertex, Vertex>>(num_entries)};
+  parallel_for (Vertex i = 0; i < num_links; i++) {
+    entries[2 * i] = std::make_pair(links[i].first, i);
+    entries[2 * i + 1] = std::make_pair(links[i].second, num_links + i);
+  }
+  parallel_for (Vertex i = 0; i < num_queries; i++) {
+    entries[num_link_entries + 2 * i] =
+      std::make_pair(queries[i].first, num_link_entries + 2 * i);
+    entries[num_link_entries + 2 * i + 1] =
+      std::make_pair(queries[i].second, num_link_entries + 2 * i + 1);
+  }
+  SortByVertex(entries, num_entries);
+
+  // `flags` is scratch space shared by splitting the entries and by the cuts.
+  bool* flags{pbbs::new_array_no_init<bool>(std::max(num_entries, num_cuts))};
+  // `pbbs::pack` cannot take an empty input, which a batch of only cuts has.
+  seq::sequence<std::pair<Vertex, Vertex>> link_entries_seq{nullptr, nullptr};
+  seq::sequence<std::pair<Vertex, Vertex>> query_entries_seq{nullptr, nullptr};
+  if (num_entries > 0) {
+    parallel_for (Vertex i = 0; i < num_entries; i++) {
+      flags[i] = entries[i].second < num_link_entries;
+    }
+    link_entries_seq = pbbs::pack(
+        seq::sequence<std::pair<Vertex, Vertex>>(entries, num_entries),
+        seq::sequence<bool>(flags, num_entries));
+    parallel_for (Vertex i = 0; i < num_entries; i++) {
+      flags[i] = !flags[i];
+    }
+    query_entries_seq = pbbs::pack(
+        seq::sequence<std::pair<Vertex, Vertex>>(entries, num_entries),
+        seq::sequence<bool>(flags, num_entries));
+  }
+  std::pair<Vertex, Vertex>* query_entries{query_entries_seq.as_array()};
+  parallel_for (Vertex i = 0; i < num_query_entries; i++) {
+    query_entries[i].second -= num_link_entries;
+  }
+  pbbs::delete_array(entries, num_entries);
+
+  if (num_cuts > 0) {
+    std::pair<Element*, Element*>* join_targets{
+      pbbs::new_array_no_init<std::pair<Element*, Element*>>(2 * num_cuts)};
+    BatchCutRecurse(cuts, cut_elements, num_cuts, flags, join_targets);
+    pbbs::delete_array(join_targets, 2 * num_cuts);
+  }
+
+  // Allocate the link elements only after the cuts have freed theirs so that an
+  // `ElementArena` does not run out of elements.
+  if (num_links > 0) {
+    Element** new_elements{
+      pbbs::new_array_no_init<Element*>(num_link_entries)};
+    AllocateEdgeElements(links, num_links, new_elements);
+    BatchLinkSorted(
+        link_entries_seq.as_array(), num_link_entries, new_elements);
+    pbbs::delete_array(new_elements, num_link_entries);
+  }
+
+  if (num_queries > 0) {
+    Element** representatives{
+      pbbs::new_array_no_init<Element*>(num_query_entries)};
+    BatchVertexQuerySorted(query_entries, num_query_entries,
+        [&](Vertex v) { return vertices_[v].FindRepresentative(); },
+        representatives);
+    parallel_for (Vertex i = 0; i < num_queries; i++) {
+      out[i] = representatives[2 * i] == representatives[2 * i + 1];
+    }
+    pbbs::delete_array(representatives, num_query_entries);
+  }
+
+  pbbs::delete_array(query_entries, num_query_entries);
+  pbbs::delete_array(link_entries_seq.as_array(), num_link_entries);
+  pbbs::delete_array(flags, std::max(num_entries, num_cuts));
+  pbbs::delete_array(cut_elements, num_cuts);
+}
+
+template <typename Augmentation, template <typename> class ElementPool,
+    template <typename, typename> class EdgeMap, typename Vertex,
+    typename Storage>
+void EulerTourTree<
+    Augmentation, ElementPool, EdgeMap, Vertex, Storage>::BatchComponentSize(
+    Vertex* vertices, Vertex len, Vertex* out) const {
+  BatchVertexQuery(vertices, len,
+      [&](Vertex v) { return vertices_[v].GetSum().size; }, out);
+}
+
+// Climb the skip lists of all tours at once, one level at a time. The frontier
+// at level i holds distinct elements that reach level i, starting with the
+// vertex elements at level 0. Each element in the frontier moves up to its
+// left parent at level i + 1. Elements that share a left parent race to claim
+// it with a CAS on its label, and only the winner puts it into the next
+// frontier. Finding a left parent takes O(1) expected steps, and the frontier
+// shrinks geometrically from level to level, so the climb takes O(n) expected
+// work. An element with no left parent is on the top level of its tour, and
+// the tour's representative becomes a root. Finally, number the roots and pass
+// the numbers back down the levels.
+template <typename Augmentation, template <typename> class ElementPool,
+    template <typename, typename> class EdgeMap, typename Vertex,
+    typename Storage>
+Vertex EulerTourTree<
+    Augmentation, ElementPool, EdgeMap, Vertex,
+    Storage>::ComputeComponentLabels(
+    Vertex* out) {
+  constexpr Vertex kUnlabeled{_internal::kUnlabeled};
+  constexpr Vertex kInFrontier{_internal::kInFrontier};
+  constexpr Vertex kRoot{_internal::kRoot};
+
+  // `frontiers[i]` is the frontier at level i, and `parents[i][j]` is the
+  // element that `frontiers[i][j]` takes its label from. `roots[i]` holds the
+  // roots found at level i.
+  std::vector<Element**> frontiers;
+  std::vector<Element**> parents;
+  std::vector<Vertex> frontier_sizes;
+  std::vector<Element**> roots;
+  std::vector<Vertex> root_counts;
+
+  Element** frontier{pbbs::new_array_no_init<Element*>(num_vertices_)};
+  parallel_for (Vertex v = 0; v < num_vertices_; v++) {
+    frontier[v] = &vertices_[v];
+    vertices_[v].label_ = kInFrontier;
+  }
+  Vertex frontier_size{num_vertices_};
+  for (int level = 0; frontier_size > 0; level++) {
+    Element** frontier_parents{
+      pbbs::new_array_no_init<Element*>(frontier_size)};
+    bool* advances{pbbs::new_array_no_init<bool>(frontier_size)};
+    bool* is_root{pbbs::new_array_no_init<bool>(frontier_size)};
+    parallel_for (Vertex i = 0; i < frontier_size; i++) {
+      Element* element{frontier[i]};
+      Element* parent{element->FindLeftParent(level)};
+      advances[i] = is_root[i] = false;
+      if (parent == element) {
+        advances[i] = true;
+      } else if (parent != nullptr) {
+        advances[i] = CAS(&parent->label_, kUnlabeled, kInFrontier);
+      } else {
+        // The representative may itself be in the frontier, and exactly one of
+        // these CASes succeeds over all elements in the tour.
+        parent = element->FindRepresentative();
+        is_root[i] =
+          CAS(&parent->label_, kUnlabeled, kRoot) ||
+          CAS(&parent->label_, kInFrontier, kRoot);
+      }
+      frontier_parents[i] = parent;
+    }
+    seq::sequence<Element*> next_frontier{
+      pbbs::pack(seq::sequence<Element*>(frontier_parents, frontier_size),
+          seq::sequence<bool>(advances, frontier_size))};
+    seq::sequence<Element*> level_roots{
+      pbbs::pack(seq::sequence<Element*>(frontier_parents, frontier_size),
+          seq::sequence<bool>(is_root, frontier_size))};
+    pbbs::delete_array(is_root, frontier_size);
+    pbbs::delete_array(advances, frontier_size);
+    frontiers.push_back(frontier);
+    parents.push_back(frontier_parents);
+    frontier_sizes.push_back(frontier_size);
+    roots.push_back(level_roots.as_array());
+    root_counts.push_back(level_roots.size());
+    frontier = next_frontier.as_array();
+    frontier_size = next_frontier.size();
+  }
+  pbbs::delete_array(frontier, frontier_size);
+
+  const int num_levels{static_cast<int>(frontiers.size())};
+  Vertex num_components{0};
+  for (int i = 0; i < num_levels; i++) {
+    const Vertex offset{num_components};
+    Element** level_roots{roots[i]};
+    parallel_for (Vertex j = 0; j < root_counts[i]; j++) {
+      level_roots[j]->label_ = offset + j;
+    }
+    num_components += root_counts[i];
+  }
+  for (int i = num_levels - 1; i >= 0; i--) {
+    Element** level_frontier{frontiers[i]};
+    Element** level_parents{parents[i]};
+    parallel_for (Vertex j = 0; j < frontier_sizes[i]; j++) {
+      if (level_parents[j] != level_frontier[j]) {
+        level_frontier[j]->label_ = level_parents[j]->label_;
+      }
+    }
+  }
+  parallel_for (Vertex v = 0; v < num_vertices_; v++) {
+    out[v] = vertices_[v].label_;
+  }
+
+  for (int i = 0; i < num_levels; i++) {
+    Element** level_frontier{frontiers[i]};
+    Element** level_roots{roots[i]};
+    parallel_for (Vertex j = 0; j < frontier_sizes[i]; j++) {
+      level_frontier[j]->label_ = kUnlabeled;
+    }
+    parallel_for (Vertex j = 0; j < root_counts[i]; j++) {
+      level_roots[j]->label_ = kUnlabeled;
+    }
+    pbbs::delete_array(level_roots, root_counts[i]);
+    pbbs::delete_array(parents[i], frontier_sizes[i]);
+    pbbs::delete_array(level_frontier, frontier_sizes[i]);
+  }
+  return num_components;
+}
+
+template <typename Augmentation, template <typename> class ElementPool,
+    template <typename, typename> class EdgeMap, typename Vertex,
+    typename Storage>
+void EulerTourTree<
+    Augmentation, ElementPool, EdgeMap, Vertex,
+    Storage>::BatchUpdateVertexValues(
+    Vertex* vertices, const VertexValue* values, Vertex len) {
+  Element** elements{pbbs::new_array_no_init<Element*>(len)};
+  TourValue* tour_values{pbbs::new_array_no_init<TourValue>(len)};
+  parallel_for (Vertex i = 0; i < len; i++) {
+    elements[i] = &vertices_[vertices[i]];
+    tour_values[i] = TourValue::Vertex(values[i]);
+  }
+  Element::BatchUpdate(elements, tour_values, len);
+  pbbs::delete_array(tour_values, len);
+  pbbs::delete_array(elements, len);
+}
+
+template <typename Augmentation, template <typename> class ElementPool,
+    template <typename, typename> class EdgeMap, typename Vertex,
+    typename Storage>
+typename EulerTourTree<
+    Augmentation, ElementPool, EdgeMap, Vertex, Storage>::VertexValue
+EulerTourTree<
+    Augmentation, ElementPool, EdgeMap, Vertex, Storage>::ComponentAggregate(
+    Vertex v) const {
+  return vertices_[v].GetSum().value;
+}
+
+template <typename Augmentation, template <typename> class ElementPool,
+    template <typename, typename> class EdgeMap, typename Vertex,
+    typename Storage>
+void EulerTourTree<
+    Augmentation, ElementPool, EdgeMap, Vertex,
+    Storage>::BatchComponentAggregate(
+    Vertex* vertices, Vertex len, VertexValue* out) const {
+  BatchVertexQuery(vertices, len,
+      [&](Vertex v) { return vertices_[v].GetSum().value; }, out);
+}
+
+// A run of the tour holds a vertex exactly when its combined size is positive,
+// so checking the size keeps edge elements, whose values are the identity, out
+// of the search.
+template <typename Augmentation, template <typename> class ElementPool,
+    template <typename, typename> class EdgeMap, typename Vertex,
+    typename Storage>
+template <typename P, typename F>
+void EulerTourTree<
+    Augmentation, ElementPool, EdgeMap, Vertex, Storage>::ForEachMatchingVertex(
+    Vertex v, P pred, F f) const {
+  const Element* first_vertex{&vertices_[0]};
+  vertices_[v].ForEachMatchingElement(
+      [&](const TourValue& value) {
+        return value.size > 0 && pred(value.value);
+      },
+      [&](Element* element) {
+        f(static_cast<Vertex>(element - first_vertex));
+      });
+}
+
+// In an Euler tour, the tour of `v`'s subtree lies directly between the
+// elements for edges (`parent`, `v`) and (`v`, `parent`).
+template <typename Augmentation, template <typename> class ElementPool,
+    template <typename, typename> class EdgeMap, typename Vertex,
+    typename Storage>
+typename EulerTourTree<
+    Augmentation, ElementPool, EdgeMap, Vertex, Storage>::TourValue
+EulerTourTree<
+    Augmentation, ElementPool, EdgeMap, Vertex, Storage>::GetSubtreeValue(
+    Vertex v, Vertex parent) const {
+  const Element* parent_v{edges_->Find(parent, v)};
+  return Element::GetSubsequenceSum(parent_v, parent_v->twin_);
+}
+
+template <typename Augmentation, template <typename> class ElementPool,
+    template <typename, typename> class EdgeMap, typename Vertex,
+    typename Storage>
+typename EulerTourTree<
+    Augmentation, ElementPool, EdgeMap, Vertex, Storage>::VertexValue
+EulerTourTree<
+    Augmentation, ElementPool, EdgeMap, Vertex, Storage>::SubtreeAggregate(
+    Vertex v, Vertex parent) const {
+  return GetSubtreeValue(v, parent).value;
+}
+
+template <typename Augmentation, template <typename> class ElementPool,
+    template <typename, typename> class EdgeMap, typename Vertex,
+    typename Storage>
+Vertex EulerTourTree<
+    Augmentation, ElementPool, EdgeMap, Vertex, Storage>::SubtreeSize(
+    Vertex v, Vertex parent) const {
+  return GetSubtreeValue(v, parent).size;
+}
+
+template <typename Augmentation, template <typename> class ElementPool,
+    template <typename, typename> class EdgeMap, typename Vertex,
+    typename Storage>
+void EulerTourTree<
+    Augmentation, ElementPool, EdgeMap, Vertex, Storage>::BatchSubtreeAggregate(
+    std::pair<Vertex, Vertex>* queries, Vertex len, VertexValue* out) const {
+  parallel_for (Vertex i = 0; i < len; i++) {
+    out[i] = SubtreeAggregate(queries[i].first, queries[i].second);
+  }
+}
+
+template <typename Augmentation, template <typename> class ElementPool,
+    template <typename, typename> class EdgeMap, typename Vertex,
+    typename Storage>
+void EulerTourTree<
+    Augmentation, ElementPool, EdgeMap, Vertex, Storage>::BatchSubtreeSize(
+    std::pair<Vertex, Vertex>* queries, Vertex len, Vertex* out) const {
+  parallel_for (Vertex i = 0; i < len; i++) {
+    out[i] = SubtreeSize(queries[i].first, queries[i].second);
+  }
+}
+
+// The tour of `v`'s side lies between (`u`, `v`) and (`v`, `u`), and the rest
+// of the tour is `u`'s side.
+template <typename Augmentation, template <typename> class ElementPool,
+    template <typename, typename> class EdgeMap, typename Vertex,
+    typename Storage>
+std::pair<Vertex, Vertex>
+EulerTourTree<
+    Augmentation, ElementPool, EdgeMap, Vertex, Storage>::CutSideSizes(
+    Vertex u, Vertex v) const {
+  const Element* uv{edges_->Find(u, v)};
+  const Vertex v_side{Element::GetSubsequenceSum(uv, uv->twin_).size};
+  return std::make_pair(uv->GetSum().size - v_side, v_side);
+}
+
+template <typename Augmentation, template <typename> class ElementPool,
+    template <typename, typename> class EdgeMap, typename Vertex,
+    typename Storage>
+void EulerTourTree<
+    Augmentation, ElementPool, EdgeMap, Vertex, Storage>::BatchCutSideSizes(
+    std::pair<Vertex, Vertex>* edges, Vertex len,
+    std::pair<Vertex, Vertex>* out) const {
+  parallel_for (Vertex i = 0; i < len; i++) {
+    out[i] = CutSideSizes(edges[i].first, edges[i].second);
+  }
+}
+
+// Read the tour starting from (`root`, `root`). The parent edge {p, `u`} is
+// entered through (p, `u`) before it is left through (`u`, p), whereas every
+// other edge {`u`, w} is left through (`u`, w) first. The subtree of `u` is the
+// part of the tour between (p, `u`) and (`u`, p).
+//
+// The tour around (`u`, `u`) alternates between elements out of `u` and
+// elements into `u`, with the subtree of one neighbor in between each pair, so
+// the elements into `u` can be visited one neighbor at a time in either
+// direction. Walking in both directions at once stops as soon as either
+// direction reaches the parent edge.
+template <typename Augmentation, template <typename> class ElementPool,
+    template <typename, typename> class EdgeMap, typename Vertex,
+    typename Storage>
+const typename EulerTourTree<
+    Augmentation, ElementPool, EdgeMap, Vertex, Storage>::Element*
+EulerTourTree<
+    Augmentation, ElementPool, EdgeMap, Vertex, Storage>::FindParentEntry(
+    Vertex root, Vertex u) const {
+  if (u == root || !IsConnected(root, u)) {
+    return nullptr;
+  }
+  const Element* root_element{&vertices_[root]};
+  // Returns the number of vertices in the tour from `root` through `e`.
+  const auto rank{[root_element](const Element* e) {
+    return Element::GetSubsequenceSum(root_element, e).size;
+  }};
+  const Element* uu{&vertices_[u]};
+  const Element* backward{uu->GetPreviousElement()};
+  const Element* forward{uu->GetNextElement()->twin_};
+  while (true) {
+    if (rank(backward) < rank(backward->twin_)) {
+      return backward;
+    }
+    if (rank(forward) < rank(forward->twin_)) {
+      return forward;
+    }
+    backward = backward->twin_->GetPreviousElement();
+    forward = forward->GetNextElement()->twin_;
+  }
+}
+
+template <typename Augmentation, template <typename> class ElementPool,
+    template <typename, typename> class EdgeMap, typename Vertex,
+    typename Storage>
+bool EulerTourTree<
+    Augmentation, ElementPool, EdgeMap, Vertex, Storage>::IsAncestorFromEntry(
+    Vertex root, Vertex u, Vertex v, const Element* entry) const {
+  if (!IsConnected(root, v)) {
+    return false;
+  }
+  if (entry == nullptr) {
+    return u == root;
+  }
+  if (u == v) {
+    return true;
+  }
+  const Element* root_element{&vertices_[root]};
+  const Vertex v_rank{
+    Element::GetSubsequenceSum(root_element, &vertices_[v]).size};
+  return Element::GetSubsequenceSum(root_element, entry).size < v_rank &&
+    v_rank <= Element::GetSubsequenceSum(root_element, entry->twin_).size;
+}
+
+template <typename Augmentation, template <typename> class ElementPool,
+    template <typename, typename> class EdgeMap, typename Vertex,
+    typename Storage>
+bool EulerTourTree<
+    Augmentation, ElementPool, EdgeMap, Vertex, Storage>::IsAncestor(
+    Vertex root, Vertex u, Vertex v) const {
+  return IsAncestorFromEntry(root, u, v, FindParentEntry(root, u));
+}
+
+template <typename Augmentation, template <typename> class ElementPool,
+    template <typename, typename> class EdgeMap, typename Vertex,
+    typename Storage>
+Vertex EulerTourTree<
+    Augmentation, ElementPool, EdgeMap, Vertex, Storage>::TourRank(
+    Vertex root, Vertex v) const {
+  if (!IsConnected(root, v)) {
+    return 0;
+  }
+  return Element::GetSubsequenceSum(&vertices_[root], &vertices_[v]).size;
+}
+
+// Sort the queries by `u` and then by root, find the parent entry once at the
+// first query of each run with the same root and `u`, and hand it to the rest
+// of the run.
+template <typename Augmentation, template <typename> class ElementPool,
+    template <typename, typename> class EdgeMap, typename Vertex,
+    typename Storage>
+void EulerTourTree<
+    Augmentation, ElementPool, EdgeMap, Vertex, Storage>::BatchIsAncestor(
+    const Vertex* roots, std::pair<Vertex, Vertex>* queries, Vertex len,
+    bool* out) const {
+  if (len == 0) {
+    return;
+  }
+  // `order[j].second` is the index of the `j`-th query in sorted order.
+  std::pair<Vertex, Vertex>* order{
+    pbbs::new_array_no_init<std::pair<Vertex, Vertex>>(len)};
+  parallel_for (Vertex i = 0; i < len; i++) {
+    order[i] = std::make_pair(roots[i], i);
+  }
+  SortByVertex(order, len);
+  parallel_for (Vertex j = 0; j < len; j++) {
+    order[j].first = queries[order[j].second].first;
+  }
+  SortByVertex(order, len);
+
+  // `run_starts[j]` becomes the position of the first query in the run
+  // containing the `j`-th query.
+  Vertex* run_starts{pbbs::new_array_no_init<Vertex>(len)};
+  parallel_for (Vertex j = 0; j < len; j++) {
+    run_starts[j] = j == 0 || order[j - 1].first != order[j].first ||
+        roots[order[j - 1].second] != roots[order[j].second]
+      ? j
+      : 0;
+  }
+  utils::sequence::scanI(
+      run_starts, run_starts, len, maxF<Vertex>(), static_cast<Vertex>(0));
+  const Element** entries{pbbs::new_array_no_init<const Element*>(len)};
+  parallel_for (Vertex j = 0; j < len; j++) {
+    if (run_starts[j] == j) {
+      const Vertex i{order[j].second};
+      entries[j] = FindParentEntry(roots[i], queries[i].first);
+    }
+  }
+  parallel_for (Vertex j = 0; j < len; j++) {
+    const Vertex i{order[j].second};
+    out[i] = IsAncestorFromEntry(roots[i], queries[i].first,
+        queries[i].second, entries[run_starts[j]]);
+  }
+  pbbs::delete_array(entries, len);
+  pbbs::delete_array(run_starts, len);
+  pbbs::delete_array(order, len);
+}
+
 }  // namespace parallel_euler_tour_tree
@@ -0,0 +1,244 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include <dynamic_trees/parallel_euler_tour_tree/include/euler_tour_tree.hpp>
+#include <utilities/include/hash_pair.hpp>
+
+namespace parallel_euler_tour_tree {
+
+// Accepts single-edge links and cuts from any number of threads and applies
+// them to a forest in batches through `ApplyBatch`, which is only efficient
+// when batches are large.
+//
+// A background thread collects submitted updates into a batch until the batch
+// holds `max_batch_size` updates or its first update has waited `max_delay`,
+// whichever comes first, and then applies it. Each submission returns a future
+// that becomes ready once its update has been applied. All updates of a batch
+// share the batch's future, so waiting costs no allocation per update.
+//
+// Updates take effect in the order they were submitted. Within a batch, cuts
+// are applied before links, which is equivalent as long as no edge is linked
+// and then cut in the same batch, so a cut of an edge that is waiting to be
+// linked starts a new batch. As with `EulerTourTree::Link` and
+// `EulerTourTree::Cut`, each link must not create a cycle and each cut must
+// remove an edge of the forest, given all updates submitted before it.
+//
+// While the queue exists, only the queue may modify the forest, and queries
+// on the forest may run only when no batch is being applied, such as right
+// after `Flush` returns with no other thread submitting.
+template <typename Forest = EulerTourTree<>, typename Vertex = int>
+class UpdateQueue {
+ public:
+  UpdateQueue() = delete;
+  // Starts applying updates to `forest`, which must outlive the queue.
+  UpdateQueue(Forest* forest, size_t max_batch_size,
+      std::chrono::microseconds max_delay);
+  // Applies all submitted updates and stops the background thread.
+  ~UpdateQueue();
+  UpdateQueue(const UpdateQueue&) = delete;
+  UpdateQueue(UpdateQueue&&) = delete;
+  UpdateQueue& operator=(const UpdateQueue&) = delete;
+  UpdateQueue& operator=(UpdateQueue&&) = delete;
+
+  // Submits adding edge {`u`, `v`} to the forest. Returns a future that is
+  // ready once the edge has been added.
+  //
+  // May run concurrently with other `Link`, `Cut`, and `Flush` calls.
+  std::shared_future<void> Link(Vertex u, Vertex v);
+  // Submits removing edge {`u`, `v`} from the forest. Returns a future that is
+  // ready once the edge has been removed.
+  //
+  // May run concurrently with other `Link`, `Cut`, and `Flush` calls.
+  std::shared_future<void> Cut(Vertex u, Vertex v);
+  // Applies all updates submitted before the call without waiting for their
+  // batches to fill up, and returns once they have been applied.
+  void Flush();
+
+  // Returns the number of batches applied so far.
+  size_t NumBatchesApplied() const;
+
+ private:
+  struct Batch {
+    Batch();
+
+    std::vector<std::pair<Vertex, Vertex>> cuts;
+    std::vector<std::pair<Vertex, Vertex>> links;
+    // Links of the batch with their smaller endpoint first.
+    std::unordered_set<std::pair<Vertex, Vertex>, HashIntPairStruct>
+      link_set;
+    std::chrono::steady_clock::time_point first_arrival;
+    std::promise<void> applied;
+    std::shared_future<void> applied_future;
+  };
+
+  // Adds an update to the last open batch and returns the batch's future. Must
+  // hold `mutex_`.
+  std::shared_future<void> Submit(Vertex u, Vertex v, bool is_link);
+  // Body of the background thread.
+  void ApplyBatches();
+
+  Forest* forest_;
+  const size_t max_batch_size_;
+  const std::chrono::microseconds max_delay_;
+
+  mutable std::mutex mutex_;
+  // Signals the background thread that there are updates or that the queue is
+  // shutting down.
+  std::condition_variable has_updates_;
+  // Batches waiting to be applied. Every batch but the last is closed.
+  std::deque<Batch> batches_;
+  // Number of batches at the front of `batches_` that `Flush` asked to have
+  // applied without waiting for them to fill up.
+  size_t num_flushed_batches_;
+  // Future of the most recently opened batch, which is applied after every
+  // other batch. It may already have left `batches_`.
+  std::shared_future<void> newest_batch_applied_;
+  size_t num_batches_applied_;
+  bool is_shutting_down_;
+  std::thread worker_;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+//                           Implementation below.                           //
+///////////////////////////////////////////////////////////////////////////////
+
+template <typename Forest, typename Vertex>
+UpdateQueue<Forest, Vertex>::Batch::Batch()
+    : applied_future{applied.get_future().share()} {}
+
+template <typename Forest, typename Vertex>
+UpdateQueue<Forest, Vertex>::UpdateQueue(Forest* forest,
+    size_t max_batch_size, std::chrono::microseconds max_delay)
+    : forest_{forest}
+    , max_batch_size_{std::max<size_t>(max_batch_size, 1)}
+    , max_delay_{max_delay}
+    , num_flushed_batches_{0}
+    , num_batches_applied_{0}
+    , is_shutting_down_{false}
+    , worker_{&UpdateQueue::ApplyBatches, this} {}
+
+template <typename Forest, typename Vertex>
+UpdateQueue<Forest, Vertex>::~UpdateQueue() {
+  {
+    std::lock_guard<std::mutex> lock{mutex_};
+    is_shutting_down_ = true;
+  }
+  has_updates_.notify_one();
+  worker_.join();
+}
+
+template <typename Forest, typename Vertex>
+std::shared_future<void> UpdateQueue<Forest, Vertex>::Link(
+    Vertex u, Vertex v) {
+  std::shared_future<void> applied;
+  {
+    std::lock_guard<std::mutex> lock{mutex_};
+    applied = Submit(u, v, true);
+  }
+  has_updates_.notify_one();
+  return applied;
+}
+
+template <typename Forest, typename Vertex>
+std::shared_future<void> UpdateQueue<Forest, Vertex>::Cut(
+    Vertex u, Vertex v) {
+  std::shared_future<void> applied;
+  {
+    std::lock_guard<std::mutex> lock{mutex_};
+    applied = Submit(u, v, false);
+  }
+  has_updates_.notify_one();
+  return applied;
+}
+
+template <typename Forest, typename Vertex>
+void UpdateQueue<Forest, Vertex>::Flush() {
+  std::shared_future<void> applied;
+  {
+    std::lock_guard<std::mutex> lock{mutex_};
+    num_flushed_batches_ = batches_.size();
+    applied = newest_batch_applied_;
+  }
+  if (applied.valid()) {
+    has_updates_.notify_one();
+    applied.wait();
+  }
+}
+
+template <typename Forest, typename Vertex>
+size_t UpdateQueue<Forest, Vertex>::NumBatchesApplied() const {
+  std::lock_guard<std::mutex> lock{mutex_};
+  return num_batches_applied_;
+}
+
+template <typename Forest, typename Vertex>
+std::shared_future<void> UpdateQueue<Forest, Vertex>::Submit(
+    Vertex u, Vertex v, bool is_link) {
+  const std::pair<Vertex, Vertex> edge{
+    u < v ? std::make_pair(u, v) : std::make_pair(v, u)};
+  if (batches_.empty() ||
+      batches_.back().cuts.size() + batches_.back().links.size() >=
+        max_batch_size_ ||
+      (!is_link && batches_.back().link_set.count(edge) > 0)) {
+    batches_.emplace_back();
+    batches_.back().first_arrival = std::chrono::steady_clock::now();
+    newest_batch_applied_ = batches_.back().applied_future;
+  }
+  Batch& batch{batches_.back()};
+  if (is_link) {
+    batch.links.emplace_back(u, v);
+    batch.link_set.insert(edge);
+  } else {
+    batch.cuts.emplace_back(u, v);
+  }
+  return batch.applied_future;
+}
+
+// The front batch is applied once it is full, once it is closed because later
+// updates went to another batch, once it has waited `max_delay_`, or once a
+// flush or the destructor asks for it.
+template <typename Forest, typename Vertex>
+void UpdateQueue<Forest, Vertex>::ApplyBatches() {
+  std::unique_lock<std::mutex> lock{mutex_};
+  while (true) {
+    has_updates_.wait(lock,
+        [&] { return is_shutting_down_ || !batches_.empty(); });
+    if (batches_.empty()) {
+      return;
+    }
+    const auto is_ready{[&] {
+      const Batch& front{batches_.front()};
+      return is_shutting_down_ || batches_.size() > 1 ||
+        num_flushed_batches_ > 0 ||
+        front.cuts.size() + front.links.size() >= max_batch_size_;
+    }};
+    has_updates_.wait_until(
+        lock, batches_.front().first_arrival + max_delay_, is_ready);
+
+    Batch batch{std::move(batches_.front())};
+    batches_.pop_front();
+    if (num_flushed_batches_ > 0) {
+      num_flushed_batches_--;
+    }
+    lock.unlock();
+    forest_->ApplyBatch(
+        batch.cuts.data(), batch.cuts.size(),
+        batch.links.data(), batch.links.size(),
+        nullptr, 0, nullptr);
+    lock.lock();
+    num_batches_applied_++;
+    batch.applied.set_value();
+  }
+}
+
+}  // namespace parallel_euler_tour_tree
@@ -1,27 +1,91 @@
 #pragma once
 
-#include <sequence/parallel_skip_list/include/skip_list_base.hpp>
+#include <sequence/parallel_skip_list/include/augmented_skip_list.hpp>
 
 namespace parallel_euler_tour_tree {
 
 namespace _internal {
 
-class Element : public parallel_skip_list::ElementBase<Element> {
+// Augmented value of a sequence element of an Euler tour. `size` is 1 if the
+// element represents a vertex and is 0 if the element represents an edge, so
+// the sum of `size` over a tour is the number of vertices in the tree. `value`
+// is the user-assigned value of a vertex and is `Augmentation::Identity()` for
+// edges. `Size` is the integer type used to count vertices.
+template <typename Augmentation, typename Size>
+struct TourValue {
+  static TourValue Vertex(const typename Augmentation::ValueType& value) {
+    return TourValue{1, value};
+  }
+  static TourValue Edge() { return TourValue{0, Augmentation::Identity()}; }
+
+  Size size;
+  typename Augmentation::ValueType value;
+};
+
+// Combines tour values by summing sizes and applying the user's augmentation
+// `Augmentation` to vertex values.
+template <typename Augmentation, typename Size>
+struct TourAugmentation {
+  using ValueType = TourValue<Augmentation, Size>;
+  static ValueType Identity() {
+    return ValueType{0, Augmentation::Identity()};
+  }
+  static ValueType Combine(const ValueType& a, const ValueType& b) {
+    return ValueType{a.size + b.size, Augmentation::Combine(a.value, b.value)};
+  }
+};
+
+// States of `Element::label_`. Outside of the `EulerTourTree` functions that
+// use it as scratch space, every element is unlabeled. During
+// `ComputeComponentLabels`, an element may also be in the frontier of the climb
+// up the skip list, be claimed as the root of its tour, or hold a nonnegative
+// label. During `BatchInsertSpanningEdges`, `BatchCutIfPresent` and the
+// rebuilding functions, an element may hold the nonnegative index of the batch
+// entry that claimed it.
+constexpr int kUnlabeled{-1};
+constexpr int kInFrontier{-2};
+constexpr int kRoot{-3};
+
+// Sequence element of an Euler tour. `Storage` is a storage policy as described
+// in "skip_list_base.hpp".
+template <typename Augmentation, typename Size, typename Storage>
+class Element
+  : public parallel_skip_list::AugmentedElementBase<
+      Element<Augmentation, Size, Storage>,
+      TourAugmentation<Augmentation, Size>, Storage> {
  public:
-  Element() : parallel_skip_list::ElementBase<Element>{} {}
-  explicit Element(size_t random_int)
-    : parallel_skip_list::ElementBase<Element>{random_int} {}
+  using Base = parallel_skip_list::AugmentedElementBase<
+    Element<Augmentation, Size, Storage>,
+    TourAugmentation<Augmentation, Size>, Storage>;
+  using ValueType = typename Base::ValueType;
+
+  Element() : Base{} {}
+  explicit Element(size_t random_int) : Base{random_int} {}
+  Element(size_t random_int, const ValueType& value)
+    : Base{random_int, value} {}
+  Element(size_t random_int, typename Base::Neighbors* neighbors,
+      ValueType* values)
+    : Base{random_int, neighbors, values} {}
+  Element(size_t random_int, const ValueType& value,
+      typename Base::Neighbors* neighbors, ValueType* values)
+    : Base{random_int, value, neighbors, values} {}
+
+  // Resets the element to the state of a newly constructed edge element with
+  // the same height. See `AugmentedElementBase::Reset`.
+  void Reset() {
+    Base::Reset(ValueType::Edge());
+    twin_ = nullptr;
+    split_mark_ = false;
+    label_ = kUnlabeled;
+  }
 
   // If this element represents edge (u, v), `twin` should point towards (v, u).
-  Element* twin_{nullptr};
+  typename Base::template Pointer<Element> twin_{nullptr};
   // When batch splitting, we mark this as `true` for an edge that we will
   // splice out in the current round of recursion.
   bool split_mark_{false};
-
- private:
-  friend class parallel_skip_list::ElementBase<Element>;
-  static void DerivedInitialize() {}
-  static void DerivedFinish() {}
+  // Scratch space for `EulerTourTree` functions.
+  Size label_{kUnlabeled};
 };
 
 }  // namespace _internal
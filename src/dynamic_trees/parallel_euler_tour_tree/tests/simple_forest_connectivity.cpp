@@ -4,6 +4,8 @@
 #include <cassert>
 #include <limits>
 #include <stack>
+#include <tuple>
+#include <utility>
 
 SimpleForestConnectivity::SimpleForestConnectivity(int num_vertices)
     : num_vertices_{num_vertices} {
@@ -75,3 +77,46 @@ void SimpleForestConnectivity::Cut(int u, int v) {
 bool SimpleForestConnectivity::IsConnected(int u, int v) const {
   return component_ids_[u] == component_ids_[v];
 }
+
+int SimpleForestConnectivity::ComponentSize(int v) const {
+  return std::count(
+      component_ids_.begin(), component_ids_.end(), component_ids_[v]);
+}
+
+std::vector<int> SimpleForestConnectivity::SubtreeVertices(
+    int v, int parent) const {
+  assert(adjacency_list_[v].find(parent) != adjacency_list_[v].end());
+  std::vector<int> subtree{};
+  std::stack<std::pair<int, int>> s{};
+  s.emplace(v, parent);
+  while (!s.empty()) {
+    int curr, curr_parent;
+    std::tie(curr, curr_parent) = s.top();
+    s.pop();
+    subtree.push_back(curr);
+    for (auto u : adjacency_list_[curr]) {
+      if (u != curr_parent) {
+        s.emplace(u, curr);
+      }
+    }
+  }
+  return subtree;
+}
+
+std::vector<int> SimpleForestConnectivity::Parents(int root) const {
+  std::vector<int> parents(num_vertices_, -1);
+  std::stack<std::pair<int, int>> s{};
+  s.emplace(root, -1);
+  while (!s.empty()) {
+    int curr, curr_parent;
+    std::tie(curr, curr_parent) = s.top();
+    s.pop();
+    parents[curr] = curr_parent;
+    for (auto u : adjacency_list_[curr]) {
+      if (u != curr_parent) {
+        s.emplace(u, curr);
+      }
+    }
+  }
+  return parents;
+}
@@ -12,6 +12,12 @@ class SimpleForestConnectivity {
   void Link(int u, int v);
   void Cut(int u, int v);
   bool IsConnected(int u, int v) const;
+  int ComponentSize(int v) const;
+  // Returns the vertices on `v`'s side of edge {`v`, `parent`}.
+  std::vector<int> SubtreeVertices(int v, int parent) const;
+  // Returns the parent of each vertex in `root`'s tree when the tree is rooted
+  // at `root`. The entries for `root` and vertices outside its tree are -1.
+  std::vector<int> Parents(int root) const;
 
  private:
   int MinimumVertexInComponent(int v);
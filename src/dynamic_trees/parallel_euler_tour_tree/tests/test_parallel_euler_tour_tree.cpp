@@ -1,15 +1,30 @@
+#include <dynamic_trees/parallel_euler_tour_tree/include/edge_map.hpp>
 #include <dynamic_trees/parallel_euler_tour_tree/include/euler_tour_tree.hpp>
+#include <dynamic_trees/parallel_euler_tour_tree/include/update_queue.hpp>
 #include <dynamic_trees/parallel_euler_tour_tree/tests/simple_forest_connectivity.hpp>
+#include <sequence/parallel_skip_list/include/file_arena.hpp>
 
+#include <algorithm>
 #include <boost/functional/hash.hpp>
 #include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <limits>
 #include <random>
+#include <string>
+#include <thread>
 #include <utility>
+#include <vector>
+
+#include <unistd.h>
 
 #include <utilities/include/debug.hpp>
 #include <utilities/include/hash_pair.hpp>
 
-using EulerTourTree = parallel_euler_tour_tree::EulerTourTree;
+using EulerTourTree = parallel_euler_tour_tree::EulerTourTree<>;
 
 constexpr int num_vertices{500};
 constexpr int link_attempts_per_round{400};
@@ -24,6 +39,1332 @@ void CheckAllPairsConnectivity(
       assert(reference_solution.IsConnected(u, v) == ett.IsConnected(u, v));
     }
   }
+
+  // Ask all the queries again as a single batch.
+  constexpr int num_queries{num_vertices * num_vertices};
+  std::pair<int, int>* queries{
+      pbbs::new_array_no_init<pair<int, int>>(num_queries)};
+  bool* answers{pbbs::new_array_no_init<bool>(num_queries)};
+  for (int u = 0; u < num_vertices; u++) {
+    for (int v = 0; v < num_vertices; v++) {
+      queries[u * num_vertices + v] = std::make_pair(u, v);
+    }
+  }
+  ett.BatchConnected(queries, num_queries, answers);
+  for (int i = 0; i < num_queries; i++) {
+    assert(reference_solution.IsConnected(queries[i].first, queries[i].second)
+        == answers[i]);
+  }
+  pbbs::delete_array(answers, num_queries);
+  pbbs::delete_array(queries, num_queries);
+}
+
+void CheckComponentSizes(
+    const SimpleForestConnectivity& reference_solution,
+    const EulerTourTree& ett) {
+  int* vertices{pbbs::new_array_no_init<int>(num_vertices)};
+  int* sizes{pbbs::new_array_no_init<int>(num_vertices)};
+  for (int v = 0; v < num_vertices; v++) {
+    assert(reference_solution.ComponentSize(v) == ett.ComponentSize(v));
+    vertices[v] = v;
+  }
+  ett.BatchComponentSize(vertices, num_vertices, sizes);
+  for (int v = 0; v < num_vertices; v++) {
+    assert(reference_solution.ComponentSize(v) == sizes[v]);
+  }
+  pbbs::delete_array(sizes, num_vertices);
+  pbbs::delete_array(vertices, num_vertices);
+}
+
+void CheckComponentLabels(
+    const SimpleForestConnectivity& reference_solution, EulerTourTree* ett) {
+  int labels[num_vertices];
+  const int num_components{ett->ComputeComponentLabels(labels)};
+  std::vector<bool> label_used(num_components, false);
+  int true_num_components{0};
+  for (int v = 0; v < num_vertices; v++) {
+    assert(0 <= labels[v] && labels[v] < num_components);
+    label_used[labels[v]] = true;
+    bool is_first_in_component{true};
+    for (int u = 0; u < num_vertices; u++) {
+      assert(reference_solution.IsConnected(u, v) == (labels[u] == labels[v]));
+      if (u < v && reference_solution.IsConnected(u, v)) {
+        is_first_in_component = false;
+      }
+    }
+    if (is_first_in_component) {
+      true_num_components++;
+    }
+  }
+  assert(num_components == true_num_components);
+  for (int i = 0; i < num_components; i++) {
+    assert(label_used[i]);
+  }
+}
+
+void CheckComponentAggregates(
+    const SimpleForestConnectivity& reference_solution,
+    const EulerTourTree& ett,
+    const int* vertex_values) {
+  int* vertices{pbbs::new_array_no_init<int>(num_vertices)};
+  int* true_aggregates{pbbs::new_array_no_init<int>(num_vertices)};
+  int* aggregates{pbbs::new_array_no_init<int>(num_vertices)};
+  for (int v = 0; v < num_vertices; v++) {
+    true_aggregates[v] = 0;
+    for (int u = 0; u < num_vertices; u++) {
+      if (reference_solution.IsConnected(u, v)) {
+        true_aggregates[v] += vertex_values[u];
+      }
+    }
+    assert(true_aggregates[v] == ett.ComponentAggregate(v));
+    vertices[v] = v;
+
+    // Values are nonnegative, so a sum of values is positive exactly when one
+    // of the values is.
+    std::vector<bool> found(num_vertices, false);
+    ett.ForEachMatchingVertex(v,
+        [](int value) { return value > 0; },
+        [&](int u) {
+          assert(!found[u]);
+          found[u] = true;
+        });
+    for (int u = 0; u < num_vertices; u++) {
+      assert(found[u] ==
+          (reference_solution.IsConnected(u, v) && vertex_values[u] > 0));
+    }
+  }
+  ett.BatchComponentAggregate(vertices, num_vertices, aggregates);
+  for (int v = 0; v < num_vertices; v++) {
+    assert(true_aggregates[v] == aggregates[v]);
+  }
+  pbbs::delete_array(aggregates, num_vertices);
+  pbbs::delete_array(true_aggregates, num_vertices);
+  pbbs::delete_array(vertices, num_vertices);
+}
+
+void CheckSubtrees(
+    const SimpleForestConnectivity& reference_solution,
+    const EulerTourTree& ett,
+    const std::unordered_set<std::pair<int, int>, HashIntPairStruct>& edges,
+    const int* vertex_values) {
+  // Query each edge from both sides.
+  const int num_queries{2 * static_cast<int>(edges.size())};
+  std::pair<int, int>* queries{
+      pbbs::new_array_no_init<pair<int, int>>(num_queries)};
+  int* sizes{pbbs::new_array_no_init<int>(num_queries)};
+  int* aggregates{pbbs::new_array_no_init<int>(num_queries)};
+  int i{0};
+  for (auto e : edges) {
+    queries[i++] = e;
+    queries[i++] = std::make_pair(e.second, e.first);
+  }
+  std::pair<int, int>* side_sizes{
+      pbbs::new_array_no_init<pair<int, int>>(num_queries)};
+  ett.BatchSubtreeSize(queries, num_queries, sizes);
+  ett.BatchSubtreeAggregate(queries, num_queries, aggregates);
+  ett.BatchCutSideSizes(queries, num_queries, side_sizes);
+  for (i = 0; i < num_queries; i++) {
+    const int v{queries[i].first};
+    const int parent{queries[i].second};
+    const std::vector<int> subtree{
+      reference_solution.SubtreeVertices(v, parent)};
+    int true_aggregate{0};
+    for (int u : subtree) {
+      true_aggregate += vertex_values[u];
+    }
+    assert(static_cast<int>(subtree.size()) == ett.SubtreeSize(v, parent));
+    assert(static_cast<int>(subtree.size()) == sizes[i]);
+    assert(true_aggregate == ett.SubtreeAggregate(v, parent));
+    assert(true_aggregate == aggregates[i]);
+
+    // Cutting {`parent`, `v`} leaves `v`'s subtree on `v`'s side.
+    const int subtree_size{static_cast<int>(subtree.size())};
+    const std::pair<int, int> true_side_sizes{
+      reference_solution.ComponentSize(v) - subtree_size, subtree_size};
+    assert(true_side_sizes == ett.CutSideSizes(parent, v));
+    assert(true_side_sizes == side_sizes[i ^ 1]);
+  }
+  pbbs::delete_array(side_sizes, num_queries);
+  pbbs::delete_array(aggregates, num_queries);
+  pbbs::delete_array(sizes, num_queries);
+  pbbs::delete_array(queries, num_queries);
+}
+
+void CheckAncestors(
+    const SimpleForestConnectivity& reference_solution,
+    const EulerTourTree& ett) {
+  // Root the forest at a few vertices and ask about every pair of vertices
+  // with one of the roots.
+  constexpr int kNumRoots{5};
+  const int num_queries{kNumRoots * num_vertices * num_vertices};
+  int* roots{pbbs::new_array_no_init<int>(num_queries)};
+  std::pair<int, int>* queries{
+      pbbs::new_array_no_init<pair<int, int>>(num_queries)};
+  bool* is_ancestor{pbbs::new_array_no_init<bool>(num_queries)};
+  for (int i = 0; i < num_queries; i++) {
+    roots[i] = (i / (num_vertices * num_vertices)) * num_vertices / kNumRoots;
+    queries[i] = std::make_pair(i / num_vertices % num_vertices,
+        i % num_vertices);
+  }
+  ett.BatchIsAncestor(roots, queries, num_queries, is_ancestor);
+  for (int r = 0; r < kNumRoots; r++) {
+    const int root{roots[r * num_vertices * num_vertices]};
+    const std::vector<int> parents{reference_solution.Parents(root)};
+    for (int v = 0; v < num_vertices; v++) {
+      std::vector<bool> true_ancestors(num_vertices, false);
+      if (reference_solution.IsConnected(root, v)) {
+        for (int u = v; u != -1; u = parents[u]) {
+          true_ancestors[u] = true;
+        }
+      }
+      for (int u = 0; u < num_vertices; u++) {
+        const int i{(r * num_vertices + u) * num_vertices + v};
+        assert(true_ancestors[u] == is_ancestor[i]);
+      }
+      assert(ett.IsAncestor(root, v, v) ==
+          reference_solution.IsConnected(root, v));
+      assert(ett.IsAncestor(root, root, v) ==
+          reference_solution.IsConnected(root, v));
+    }
+
+    // The ranks number the tree of `root` from 1, and the ranks of the
+    // descendants of each vertex form an interval.
+    std::vector<int> ranks(num_vertices);
+    std::vector<int> min_ranks(num_vertices, num_vertices + 1);
+    std::vector<int> max_ranks(num_vertices, 0);
+    std::vector<int> num_descendants(num_vertices, 0);
+    std::vector<bool> is_rank_used(num_vertices + 1, false);
+    for (int v = 0; v < num_vertices; v++) {
+      ranks[v] = ett.TourRank(root, v);
+      if (!reference_solution.IsConnected(root, v)) {
+        assert(ranks[v] == 0);
+        continue;
+      }
+      assert(1 <= ranks[v] && ranks[v] <= num_vertices);
+      assert(!is_rank_used[ranks[v]]);
+      is_rank_used[ranks[v]] = true;
+    }
+    assert(ranks[root] == 1);
+    for (int v = 0; v < num_vertices; v++) {
+      if (ranks[v] > 0) {
+        for (int u = v; u != -1; u = parents[u]) {
+          min_ranks[u] = std::min(min_ranks[u], ranks[v]);
+          max_ranks[u] = std::max(max_ranks[u], ranks[v]);
+          num_descendants[u]++;
+        }
+      }
+    }
+    for (int u = 0; u < num_vertices; u++) {
+      if (ranks[u] > 0) {
+        assert(max_ranks[u] - min_ranks[u] + 1 == num_descendants[u]);
+      }
+    }
+  }
+  pbbs::delete_array(is_ancestor, num_queries);
+  pbbs::delete_array(queries, num_queries);
+  pbbs::delete_array(roots, num_queries);
+}
+
+// Asks about the center of a large star many times. Walking the center's edges
+// once per query would take time quadratic in the number of leaves.
+void CheckHubAncestors() {
+  constexpr int kNumStarVertices{20000};
+  // The last vertex stays outside the star.
+  EulerTourTree star{kNumStarVertices + 1};
+  std::vector<std::pair<int, int>> links;
+  for (int v = 1; v < kNumStarVertices; v++) {
+    links.emplace_back(0, v);
+  }
+  star.BatchLink(links.data(), links.size());
+
+  const int star_roots[]{0, 1, kNumStarVertices - 1};
+  std::vector<int> roots;
+  std::vector<std::pair<int, int>> queries;
+  for (int root : star_roots) {
+    for (int v = 0; v <= kNumStarVertices; v++) {
+      roots.push_back(root);
+      queries.emplace_back(0, v);
+      roots.push_back(root);
+      queries.emplace_back(v, v == 0 ? 1 : 0);
+    }
+  }
+  bool* is_ancestor{pbbs::new_array_no_init<bool>(queries.size())};
+  star.BatchIsAncestor(
+      roots.data(), queries.data(), queries.size(), is_ancestor);
+  for (size_t i = 0; i < queries.size(); i++) {
+    const int root{roots[i]};
+    const int u{queries[i].first};
+    const int v{queries[i].second};
+    bool expected;
+    if (u == kNumStarVertices || v == kNumStarVertices) {
+      expected = false;
+    } else if (u == root || u == v) {
+      expected = true;
+    } else {
+      // Otherwise `u` is an ancestor of `v` exactly when `u` is the center
+      // and `v` is not the root.
+      expected = u == 0 && v != root;
+    }
+    assert(is_ancestor[i] == expected);
+  }
+  pbbs::delete_array(is_ancestor, queries.size());
+  assert(star.IsAncestor(1, 0, kNumStarVertices - 1));
+  assert(!star.IsAncestor(0, 1, kNumStarVertices - 1));
+  assert(!star.IsAncestor(1, 0, kNumStarVertices));
+}
+
+// Saves `ett` to a file, loads it into a new forest, and checks that the new
+// forest matches the reference solution, including after cutting every edge.
+void CheckSnapshot(
+    const SimpleForestConnectivity& reference_solution,
+    EulerTourTree* ett,
+    const std::unordered_set<std::pair<int, int>, HashIntPairStruct>& edges,
+    const int* vertex_values) {
+  char path[]{"/tmp/ett_snapshot_XXXXXX"};
+  close(mkstemp(path));
+  const bool saved{ett->Save(path)};
+  assert(saved);
+
+  EulerTourTree restored{num_vertices};
+  const bool loaded{restored.Load(path)};
+  assert(loaded);
+  CheckAllPairsConnectivity(reference_solution, restored);
+  CheckComponentSizes(reference_solution, restored);
+  CheckComponentAggregates(reference_solution, restored, vertex_values);
+  CheckSubtrees(reference_solution, restored, edges, vertex_values);
+  CheckAncestors(reference_solution, restored);
+
+  std::vector<std::pair<int, int>> cuts(edges.begin(), edges.end());
+  restored.BatchCut(cuts.data(), cuts.size());
+  for (int v = 0; v < num_vertices; v++) {
+    assert(restored.ComponentSize(v) == 1);
+  }
+
+  // Snapshots only load into forests with the same number of vertices.
+  EulerTourTree too_small{num_vertices - 1};
+  const bool loaded_too_small{too_small.Load(path)};
+  assert(!loaded_too_small);
+  const bool loaded_missing{restored.Load("/nonexistent/ett_snapshot")};
+  assert(!loaded_missing);
+
+  // A truncated snapshot is rejected, and the full snapshot also loads from
+  // memory.
+  std::vector<char> contents;
+  {
+    std::ifstream file{path, std::ios::binary};
+    contents.assign(std::istreambuf_iterator<char>{file},
+        std::istreambuf_iterator<char>{});
+  }
+  char* aligned{pbbs::new_array_no_init<char>(contents.size())};
+  std::copy(contents.begin(), contents.end(), aligned);
+  const bool loaded_truncated{restored.Load(aligned, contents.size() - 1)};
+  assert(!loaded_truncated);
+  const bool loaded_from_memory{restored.Load(aligned, contents.size())};
+  assert(loaded_from_memory);
+  CheckAllPairsConnectivity(reference_solution, restored);
+  CheckComponentAggregates(reference_solution, restored, vertex_values);
+  pbbs::delete_array(aligned, contents.size());
+  std::remove(path);
+}
+
+// Checks saving and loading forests that have no edges, including a forest on
+// a single vertex.
+void CheckEdgelessSnapshots() {
+  for (int n : {10, 1}) {
+    EulerTourTree ett{n};
+    std::vector<int> vertices(n);
+    std::vector<int> values(n);
+    for (int v = 0; v < n; v++) {
+      vertices[v] = v;
+      values[v] = v + 1;
+    }
+    ett.BatchUpdateVertexValues(vertices.data(), values.data(), n);
+    char path[]{"/tmp/ett_snapshot_XXXXXX"};
+    close(mkstemp(path));
+    const bool saved{ett.Save(path)};
+    assert(saved);
+
+    EulerTourTree restored{n};
+    const bool loaded{restored.Load(path)};
+    assert(loaded);
+    for (int v = 0; v < n; v++) {
+      assert(restored.ComponentSize(v) == 1);
+      assert(restored.ComponentAggregate(v) == v + 1);
+    }
+    if (n > 1) {
+      assert(!restored.IsConnected(0, n - 1));
+      restored.Link(0, n - 1);
+      assert(restored.IsConnected(0, n - 1));
+      assert(restored.ComponentAggregate(0) == n + 1);
+    }
+    std::remove(path);
+  }
+}
+
+// Checks that snapshots whose edges pair up into twins but do not form a forest
+// are rejected without touching the forest. The snapshots are rewritten from
+// one of a path on four vertices, which has as many edge elements.
+void CheckCyclicSnapshots() {
+  constexpr int n{4};
+  EulerTourTree path_forest{n};
+  std::pair<int, int> path_edges[]{{0, 1}, {1, 2}, {2, 3}};
+  path_forest.BatchLink(path_edges, n - 1);
+  char path[]{"/tmp/ett_snapshot_XXXXXX"};
+  close(mkstemp(path));
+  const bool saved{path_forest.Save(path)};
+  assert(saved);
+  std::vector<char> contents;
+  {
+    std::ifstream file{path, std::ios::binary};
+    contents.assign(std::istreambuf_iterator<char>{file},
+        std::istreambuf_iterator<char>{});
+  }
+  std::remove(path);
+
+  constexpr int num_edge_elements{2 * (n - 1)};
+  const parallel_euler_tour_tree::_internal::SnapshotLayout layout{
+    parallel_euler_tour_tree::_internal::GetSnapshotLayout<int, int>(
+        n, num_edge_elements)};
+  char* data{pbbs::new_array_no_init<char>(contents.size())};
+  std::copy(contents.begin(), contents.end(), data);
+  uint64_t* offsets{reinterpret_cast<uint64_t*>(data + layout.offsets)};
+  int* heads{reinterpret_cast<int*>(data + layout.heads)};
+  int* twin_positions{reinterpret_cast<int*>(data + layout.twin_positions)};
+  const auto rewrite{[&](std::vector<uint64_t> new_offsets,
+      std::vector<int> new_heads, std::vector<int> new_twin_positions) {
+    std::copy(new_offsets.begin(), new_offsets.end(), offsets);
+    std::copy(new_heads.begin(), new_heads.end(), heads);
+    std::copy(new_twin_positions.begin(), new_twin_positions.end(),
+        twin_positions);
+  }};
+
+  EulerTourTree ett{n};
+  // A triangle on 0, 1 and 2.
+  rewrite({0, 2, 4, 6, 6}, {1, 2, 2, 0, 0, 1}, {1, 0, 1, 0, 1, 0});
+  const bool loaded_triangle{ett.Load(data, contents.size())};
+  assert(!loaded_triangle);
+  // Edge {0, 1} twice, and edge {2, 3}.
+  rewrite({0, 2, 4, 5, 6}, {1, 1, 0, 0, 3, 2}, {0, 1, 0, 1, 0, 0});
+  const bool loaded_repeated{ett.Load(data, contents.size())};
+  assert(!loaded_repeated);
+  for (int v = 0; v < n; v++) {
+    assert(ett.ComponentSize(v) == 1);
+  }
+
+  // The path itself still loads.
+  rewrite({0, 1, 3, 5, 6}, {1, 0, 2, 1, 3, 2}, {0, 0, 0, 1, 0, 1});
+  const bool loaded_path{ett.Load(data, contents.size())};
+  assert(loaded_path);
+  assert(ett.ComponentSize(0) == n);
+  assert(ett.SubtreeSize(1, 0) == n - 1);
+  pbbs::delete_array(data, contents.size());
+}
+
+// Checks that forests do not share state: they may be modified concurrently,
+// and destroying one forest does not affect the others.
+void CheckIndependentForests() {
+  constexpr int num_forests{8};
+  constexpr int n{200};
+  std::pair<int, int> path[n - 1];
+  for (int i = 0; i < n - 1; i++) {
+    path[i] = std::make_pair(i, i + 1);
+  }
+  EulerTourTree* forests[num_forests];
+  parallel_for (int i = 0; i < num_forests; i++) {
+    forests[i] = new EulerTourTree{n};
+    forests[i]->BatchLink(path, n - 1 - i);
+  }
+  for (int i = 0; i < num_forests; i += 2) {
+    delete forests[i];
+  }
+  parallel_for (int i = 1; i < num_forests; i += 2) {
+    forests[i]->BatchCut(path + i, n - 1 - 2 * i);
+  }
+  for (int i = 1; i < num_forests; i += 2) {
+    // Forest `i` now holds exactly the edges of the path from 0 to `i`.
+    assert(forests[i]->ComponentSize(0) == i + 1);
+    assert(forests[i]->IsConnected(0, i));
+    assert(!forests[i]->IsConnected(0, i + 1));
+    assert(forests[i]->ComponentSize(n - 1) == 1);
+    delete forests[i];
+  }
+
+  // A forest on one vertex has no room for edge elements.
+  EulerTourTree singleton{1};
+  assert(singleton.ComponentSize(0) == 1);
+  assert(singleton.IsConnected(0, 0));
+}
+
+// Checks `ApplyBatch` on windows of mixed cuts, links, and queries, where some
+// windows re-add edges that they cut and some windows leave out a kind of
+// operation or hold only cuts.
+void CheckApplyBatch() {
+  std::mt19937 rng{};
+  rng.seed(1);
+  std::uniform_int_distribution<std::mt19937::result_type>
+    vert_dist{0, num_vertices - 1};
+  std::uniform_int_distribution<std::mt19937::result_type>
+    coin{0, 1};
+
+  SimpleForestConnectivity reference_solution{num_vertices};
+  EulerTourTree ett{num_vertices};
+  std::unordered_set<std::pair<int, int>, HashIntPairStruct> edges{};
+  std::pair<int, int>* cuts{
+      pbbs::new_array_no_init<pair<int, int>>(num_vertices)};
+  std::pair<int, int>* links{
+      pbbs::new_array_no_init<pair<int, int>>(num_vertices)};
+  constexpr int num_queries{1000};
+  std::pair<int, int> queries[num_queries];
+  bool answers[num_queries];
+  for (int i = 0; i < num_rounds; i++) {
+    int num_cuts{0};
+    int num_links{0};
+    if (i % 4 != 1) {
+      int cnt{0};
+      for (auto e : edges) {
+        if (++cnt % cut_ratio == 0) {
+          cuts[num_cuts++] = e;
+        }
+      }
+      for (int j = 0; j < num_cuts; j++) {
+        edges.erase(cuts[j]);
+        reference_solution.Cut(cuts[j].first, cuts[j].second);
+        // Re-add some of the cut edges in the same window.
+        if (i % 4 != 2 && coin(rng) == 1) {
+          reference_solution.Link(cuts[j].first, cuts[j].second);
+          edges.emplace(cuts[j]);
+          links[num_links++] = std::make_pair(cuts[j].second, cuts[j].first);
+        }
+      }
+    }
+    if (i % 4 != 2) {
+      for (int j = 0; j < link_attempts_per_round; j++) {
+        const unsigned long u{vert_dist(rng)}, v{vert_dist(rng)};
+        if (!reference_solution.IsConnected(u, v)) {
+          reference_solution.Link(u, v);
+          edges.emplace(u, v);
+          links[num_links++] = std::make_pair(u, v);
+        }
+      }
+    }
+    const int window_queries{i % 4 >= 2 ? 0 : num_queries};
+    for (int j = 0; j < window_queries; j++) {
+      queries[j] = std::make_pair(vert_dist(rng), vert_dist(rng));
+    }
+
+    ett.ApplyBatch(
+        cuts, num_cuts, links, num_links, queries, window_queries, answers);
+    for (int j = 0; j < window_queries; j++) {
+      assert(reference_solution.IsConnected(queries[j].first, queries[j].second)
+          == answers[j]);
+    }
+    CheckAllPairsConnectivity(reference_solution, ett);
+    CheckComponentSizes(reference_solution, ett);
+  }
+  pbbs::delete_array(links, num_vertices);
+  pbbs::delete_array(cuts, num_vertices);
+}
+
+// Checks that `Build` loads a forest that later links, cuts, and queries treat
+// like one loaded by `BatchLink`, including on an empty batch.
+void CheckBuild() {
+  std::mt19937 rng{};
+  rng.seed(5);
+  std::uniform_int_distribution<std::mt19937::result_type>
+    vert_dist{0, num_vertices - 1};
+
+  for (int attempts : {0, link_attempts_per_round, 4 * num_vertices}) {
+    SimpleForestConnectivity reference_solution{num_vertices};
+    EulerTourTree ett{num_vertices};
+    std::unordered_set<std::pair<int, int>, HashIntPairStruct> edges{};
+    std::pair<int, int>* links{
+        pbbs::new_array_no_init<pair<int, int>>(num_vertices)};
+    int num_links{0};
+    for (int j = 0; j < attempts; j++) {
+      const unsigned long u{vert_dist(rng)}, v{vert_dist(rng)};
+      if (!reference_solution.IsConnected(u, v)) {
+        reference_solution.Link(u, v);
+        edges.emplace(u, v);
+        links[num_links++] = std::make_pair(u, v);
+      }
+    }
+    int vertex_values[num_vertices];
+    int vertices[num_vertices];
+    for (int v = 0; v < num_vertices; v++) {
+      vertices[v] = v;
+      vertex_values[v] = vert_dist(rng);
+    }
+    ett.BatchUpdateVertexValues(vertices, vertex_values, num_vertices);
+    ett.Build(links, num_links);
+    CheckAllPairsConnectivity(reference_solution, ett);
+    CheckComponentSizes(reference_solution, ett);
+    CheckComponentAggregates(reference_solution, ett, vertex_values);
+    CheckSubtrees(reference_solution, ett, edges, vertex_values);
+
+    // Cut every other edge, then link the forest back up.
+    const int num_cuts{num_links / 2};
+    for (int j = 0; j < num_cuts; j++) {
+      edges.erase(links[2 * j]);
+      reference_solution.Cut(links[2 * j].first, links[2 * j].second);
+      links[j] = links[2 * j];
+    }
+    ett.BatchCut(links, num_cuts);
+    CheckAllPairsConnectivity(reference_solution, ett);
+    CheckSubtrees(reference_solution, ett, edges, vertex_values);
+    for (int j = 0; j < num_cuts; j++) {
+      reference_solution.Link(links[j].first, links[j].second);
+      edges.emplace(links[j]);
+    }
+    ett.BatchLink(links, num_cuts);
+    CheckAllPairsConnectivity(reference_solution, ett);
+    CheckComponentSizes(reference_solution, ett);
+    CheckSubtrees(reference_solution, ett, edges, vertex_values);
+    pbbs::delete_array(links, num_vertices);
+  }
+}
+
+// Checks that `BatchInsertSpanningEdges` links a spanning forest of batches
+// that hold cycles, repeated edges, self-loops, and edges between vertices that
+// are already connected, on batches both above and below the size at which
+// `BatchLink` runs sequentially.
+void CheckSpanningEdges() {
+  std::mt19937 rng{};
+  rng.seed(3);
+  std::uniform_int_distribution<std::mt19937::result_type>
+    vert_dist{0, num_vertices - 1};
+
+  SimpleForestConnectivity reference_solution{num_vertices};
+  EulerTourTree ett{num_vertices};
+  std::unordered_set<std::pair<int, int>, HashIntPairStruct> edges{};
+  std::vector<std::pair<int, int>> batch;
+  for (int i = 0; i < num_rounds; i++) {
+    const int batch_size{i % 2 == 0 ? 2 * link_attempts_per_round : 50};
+    batch.clear();
+    for (int j = 0; j < batch_size; j++) {
+      const int u{static_cast<int>(vert_dist(rng))};
+      switch (j % 8) {
+        case 0:
+          batch.emplace_back(u, u);
+          break;
+        case 1:
+          if (!batch.empty()) {
+            batch.push_back(batch[vert_dist(rng) % batch.size()]);
+          }
+          break;
+        default:
+          batch.emplace_back(u, vert_dist(rng));
+      }
+    }
+    bool* accepted{pbbs::new_array_no_init<bool>(batch.size())};
+    ett.BatchInsertSpanningEdges(batch.data(), batch.size(), accepted);
+
+    // The accepted edges must form a forest together with the existing edges,
+    // and they must connect the endpoints of every rejected edge.
+    for (size_t j = 0; j < batch.size(); j++) {
+      const int u{batch[j].first}, v{batch[j].second};
+      if (accepted[j]) {
+        assert(!reference_solution.IsConnected(u, v));
+        reference_solution.Link(u, v);
+        edges.insert(batch[j]);
+      }
+    }
+    for (size_t j = 0; j < batch.size(); j++) {
+      assert(reference_solution.IsConnected(batch[j].first, batch[j].second));
+    }
+    pbbs::delete_array(accepted, batch.size());
+    CheckAllPairsConnectivity(reference_solution, ett);
+    CheckComponentSizes(reference_solution, ett);
+    CheckComponentLabels(reference_solution, &ett);
+
+    // Cut some edges so that the next batch has trees to join.
+    batch.clear();
+    int cnt{0};
+    for (auto e : edges) {
+      if (++cnt % cut_ratio == 0) {
+        batch.push_back(e);
+      }
+    }
+    for (const auto& e : batch) {
+      edges.erase(e);
+      reference_solution.Cut(e.first, e.second);
+    }
+    ett.BatchCut(batch.data(), batch.size());
+  }
+
+  // An empty batch accepts nothing and leaves the forest alone.
+  ett.BatchInsertSpanningEdges(nullptr, 0, nullptr);
+  CheckAllPairsConnectivity(reference_solution, ett);
+}
+
+// Checks that `BatchCutIfPresent` removes each present edge once when the cuts
+// hold repeated edges, both directions of an edge, and absent edges.
+void CheckCutIfPresent() {
+  std::mt19937 rng{};
+  rng.seed(4);
+  std::uniform_int_distribution<std::mt19937::result_type>
+    vert_dist{0, num_vertices - 1};
+
+  SimpleForestConnectivity reference_solution{num_vertices};
+  EulerTourTree ett{num_vertices};
+  std::unordered_set<std::pair<int, int>, HashIntPairStruct> edges{};
+  std::vector<std::pair<int, int>> batch;
+  for (int i = 0; i < num_rounds; i++) {
+    batch.clear();
+    for (int j = 0; j < link_attempts_per_round; j++) {
+      const int u{static_cast<int>(vert_dist(rng))};
+      const int v{static_cast<int>(vert_dist(rng))};
+      if (!reference_solution.IsConnected(u, v)) {
+        reference_solution.Link(u, v);
+        edges.emplace(u, v);
+        batch.emplace_back(u, v);
+      }
+    }
+    ett.BatchLink(batch.data(), batch.size());
+
+    // Odd rounds cut few enough edges that the cuts run sequentially.
+    const int cut_modulus{i % 2 == 0 ? cut_ratio : 8 * cut_ratio};
+    batch.clear();
+    int cnt{0};
+    for (auto e : edges) {
+      if (++cnt % cut_modulus == 0) {
+        batch.push_back(e);
+        batch.emplace_back(e.second, e.first);
+        if (cnt % 2 == 0) {
+          batch.push_back(e);
+        }
+      }
+    }
+    const size_t num_present{batch.size()};
+    for (size_t j = 0; j < num_present / 2; j++) {
+      const int u{static_cast<int>(vert_dist(rng))};
+      const int v{static_cast<int>(vert_dist(rng))};
+      if (edges.count(std::make_pair(u, v)) == 0 &&
+          edges.count(std::make_pair(v, u)) == 0) {
+        batch.emplace_back(u, v);
+      }
+    }
+    std::shuffle(batch.begin(), batch.end(), rng);
+    bool* applied{pbbs::new_array_no_init<bool>(batch.size())};
+    ett.BatchCutIfPresent(batch.data(), batch.size(), applied);
+
+    std::unordered_set<std::pair<int, int>, HashIntPairStruct> cut_edges{};
+    for (size_t j = 0; j < batch.size(); j++) {
+      std::pair<int, int> e{batch[j]};
+      if (edges.count(e) == 0) {
+        e = std::make_pair(e.second, e.first);
+      }
+      if (edges.count(e) == 0) {
+        assert(!applied[j]);
+      } else if (applied[j]) {
+        assert(cut_edges.count(e) == 0);
+        cut_edges.insert(e);
+      }
+    }
+    for (const auto& e : cut_edges) {
+      edges.erase(e);
+      reference_solution.Cut(e.first, e.second);
+    }
+    for (size_t j = 0; j < batch.size(); j++) {
+      assert(edges.count(batch[j]) == 0);
+    }
+    pbbs::delete_array(applied, batch.size());
+    CheckAllPairsConnectivity(reference_solution, ett);
+    CheckComponentSizes(reference_solution, ett);
+  }
+
+  // An empty batch cuts nothing.
+  ett.BatchCutIfPresent(nullptr, 0, nullptr);
+  CheckAllPairsConnectivity(reference_solution, ett);
+}
+
+// Checks that batches give the same forest when every batch rebuilds the tours
+// as when none does.
+void CheckRebuild() {
+  std::mt19937 rng{};
+  rng.seed(5);
+  std::uniform_int_distribution<std::mt19937::result_type>
+    vert_dist{0, num_vertices - 1};
+
+  SimpleForestConnectivity reference_solution{num_vertices};
+  EulerTourTree rebuilt{num_vertices};
+  rebuilt.SetRebuildRatio(0.0);
+  EulerTourTree incremental{num_vertices};
+  incremental.SetRebuildRatio(std::numeric_limits<double>::infinity());
+  std::unordered_set<std::pair<int, int>, HashIntPairStruct> edges{};
+  std::vector<std::pair<int, int>> batch;
+  for (int i = 0; i < num_rounds; i++) {
+    batch.clear();
+    for (int j = 0; j < link_attempts_per_round; j++) {
+      const int u{static_cast<int>(vert_dist(rng))};
+      const int v{static_cast<int>(vert_dist(rng))};
+      if (!reference_solution.IsConnected(u, v)) {
+        reference_solution.Link(u, v);
+        edges.emplace(u, v);
+        batch.emplace_back(u, v);
+      }
+    }
+    rebuilt.BatchLink(batch.data(), batch.size());
+    incremental.BatchLink(batch.data(), batch.size());
+    CheckAllPairsConnectivity(reference_solution, rebuilt);
+    CheckAncestors(reference_solution, rebuilt);
+
+    batch.clear();
+    int cnt{0};
+    for (auto e : edges) {
+      if (++cnt % cut_ratio == 0) {
+        batch.push_back(e);
+      }
+    }
+    for (const auto& e : batch) {
+      edges.erase(e);
+      reference_solution.Cut(e.first, e.second);
+    }
+    rebuilt.BatchCut(batch.data(), batch.size());
+    incremental.BatchCut(batch.data(), batch.size());
+    CheckAllPairsConnectivity(reference_solution, rebuilt);
+    CheckComponentSizes(reference_solution, rebuilt);
+    CheckAncestors(reference_solution, rebuilt);
+    for (int v = 0; v < num_vertices; v++) {
+      assert(rebuilt.ComponentSize(v) == incremental.ComponentSize(v));
+    }
+  }
+
+  // Calibration runs once, and forests that differ only in storage share it.
+  using ArenaForest = parallel_euler_tour_tree::EulerTourTree<
+    parallel_skip_list::SumAugmentation<int>,
+    parallel_euler_tour_tree::ElementArena,
+    parallel_euler_tour_tree::HashEdgeMap,
+    int,
+    file_arena::FileArenaStorage>;
+  const double ratio{EulerTourTree::CalibratedRebuildRatio()};
+  assert(ratio >= 1.0 / 64);
+  assert(ratio == EulerTourTree::CalibratedRebuildRatio());
+  assert(ratio == ArenaForest::CalibratedRebuildRatio());
+}
+
+// Rebuilds only lay out the tours that a batch touches, so check that batches
+// confined to one tree leave the other trees intact.
+void CheckRebuildTouchedTours() {
+  constexpr int num_trees{10};
+  std::mt19937 rng{};
+  rng.seed(6);
+
+  SimpleForestConnectivity reference_solution{num_vertices};
+  EulerTourTree ett{num_vertices};
+  ett.SetRebuildRatio(0.0);
+  // Vertex v belongs to tree v % `num_trees`, in which its parent is a random
+  // earlier vertex.
+  std::vector<std::vector<std::pair<int, int>>> tree_edges(num_trees);
+  std::unordered_set<std::pair<int, int>, HashIntPairStruct> edges{};
+  for (int v = num_trees; v < num_vertices; v++) {
+    const int parent{static_cast<int>(rng() % (v / num_trees)) * num_trees +
+      v % num_trees};
+    tree_edges[v % num_trees].emplace_back(parent, v);
+    edges.emplace(parent, v);
+    reference_solution.Link(parent, v);
+  }
+  for (const auto& tree : tree_edges) {
+    std::vector<std::pair<int, int>> batch{tree};
+    ett.BatchLink(batch.data(), batch.size());
+  }
+  const std::vector<int> vertex_values(num_vertices, 0);
+  CheckAllPairsConnectivity(reference_solution, ett);
+  CheckSubtrees(reference_solution, ett, edges, vertex_values.data());
+
+  for (int i = 0; i < num_rounds; i++) {
+    std::vector<std::pair<int, int>> batch;
+    for (const auto& e : tree_edges[i % num_trees]) {
+      if (rng() % cut_ratio == 0) {
+        batch.push_back(e);
+      }
+    }
+    for (const auto& e : batch) {
+      reference_solution.Cut(e.first, e.second);
+    }
+    ett.BatchCut(batch.data(), batch.size());
+    CheckAllPairsConnectivity(reference_solution, ett);
+    CheckComponentSizes(reference_solution, ett);
+
+    for (const auto& e : batch) {
+      reference_solution.Link(e.first, e.second);
+    }
+    ett.BatchLink(batch.data(), batch.size());
+    CheckAllPairsConnectivity(reference_solution, ett);
+    CheckSubtrees(reference_solution, ett, edges, vertex_values.data());
+    CheckAncestors(reference_solution, ett);
+  }
+}
+
+// Rebuilding around a vertex of high degree ranks long lists of edge elements,
+// so link a large star by rebuilding, save and load it, and then cut its edges
+// in two batches, the first of which leaves the center with every other leaf.
+void CheckRebuildStar() {
+  constexpr int kNumStarVertices{20000};
+  EulerTourTree star{kNumStarVertices};
+  star.SetRebuildRatio(0.0);
+  std::vector<std::pair<int, int>> links;
+  for (int v = 1; v < kNumStarVertices; v++) {
+    links.emplace_back(0, v);
+  }
+  star.BatchLink(links.data(), links.size());
+  assert(star.ComponentSize(kNumStarVertices - 1) == kNumStarVertices);
+  assert(star.SubtreeSize(0, 1) == kNumStarVertices - 1);
+  assert(star.SubtreeSize(1, 0) == 1);
+
+  char path[]{"/tmp/ett_star_XXXXXX"};
+  close(mkstemp(path));
+  const bool saved{star.Save(path)};
+  assert(saved);
+  EulerTourTree restored{kNumStarVertices};
+  restored.SetRebuildRatio(0.0);
+  const bool loaded{restored.Load(path)};
+  assert(loaded);
+  std::remove(path);
+
+  for (EulerTourTree* forest : {&star, &restored}) {
+    assert(forest->ComponentSize(1) == kNumStarVertices);
+    std::vector<std::pair<int, int>> cuts;
+    for (int v = 1; v < kNumStarVertices; v += 2) {
+      cuts.emplace_back(0, v);
+    }
+    forest->BatchCut(cuts.data(), cuts.size());
+    for (int v = 0; v < kNumStarVertices; v++) {
+      assert(forest->ComponentSize(v) ==
+          (v % 2 == 1 ? 1 : kNumStarVertices / 2));
+    }
+    assert(forest->SubtreeSize(0, 2) == kNumStarVertices / 2 - 1);
+
+    cuts.clear();
+    for (int v = 2; v < kNumStarVertices; v += 2) {
+      cuts.emplace_back(v, 0);
+    }
+    forest->BatchCut(cuts.data(), cuts.size());
+    for (int v = 0; v < kNumStarVertices; v++) {
+      assert(forest->ComponentSize(v) == 1);
+    }
+  }
+}
+
+// Has several threads submit links and cuts to an `UpdateQueue` at once and
+// checks that the forest ends up with exactly the edges they left in it.
+void CheckUpdateQueue(
+    size_t max_batch_size, std::chrono::microseconds max_delay) {
+  constexpr int kNumThreads{4};
+  constexpr int kUpdatesPerThread{2000};
+  constexpr int kVerticesPerThread{num_vertices / kNumThreads};
+
+  EulerTourTree ett{num_vertices};
+  // Each thread toggles the edges of its own random tree on its own range of
+  // vertices, so every set of present edges is a forest.
+  std::vector<std::vector<bool>> is_present(kNumThreads);
+  {
+    parallel_euler_tour_tree::UpdateQueue<EulerTourTree> queue{
+      &ett, max_batch_size, max_delay};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kNumThreads; t++) {
+      threads.emplace_back([&, t] {
+        std::mt19937 rng{static_cast<std::mt19937::result_type>(t)};
+        const int offset{t * kVerticesPerThread};
+        std::vector<int> parents(kVerticesPerThread);
+        for (int v = 1; v < kVerticesPerThread; v++) {
+          parents[v] = rng() % v;
+        }
+        std::vector<bool>& present{is_present[t]};
+        present.assign(kVerticesPerThread, false);
+        for (int i = 0; i < kUpdatesPerThread; i++) {
+          const int v{1 + static_cast<int>(rng() % (kVerticesPerThread - 1))};
+          const int u{offset + parents[v]};
+          std::shared_future<void> applied;
+          if (present[v]) {
+            applied = queue.Cut(offset + v, u);
+          } else {
+            applied = queue.Link(u, offset + v);
+            // Sometimes cut the edge right after linking it, which must not
+            // land in the same batch as the link.
+            if (i % 7 == 0) {
+              queue.Cut(u, offset + v);
+              applied = queue.Link(offset + v, u);
+            }
+          }
+          present[v] = !present[v];
+          if (i % 100 == 0) {
+            applied.wait();
+          }
+        }
+      });
+    }
+    for (std::thread& thread : threads) {
+      thread.join();
+    }
+    queue.Flush();
+    assert(queue.NumBatchesApplied() > 0);
+  }
+
+  SimpleForestConnectivity reference_solution{num_vertices};
+  std::vector<std::pair<int, int>> edges;
+  for (int t = 0; t < kNumThreads; t++) {
+    std::mt19937 rng{static_cast<std::mt19937::result_type>(t)};
+    const int offset{t * kVerticesPerThread};
+    for (int v = 1; v < kVerticesPerThread; v++) {
+      const int parent{static_cast<int>(rng() % v)};
+      if (is_present[t][v]) {
+        reference_solution.Link(offset + parent, offset + v);
+        edges.emplace_back(offset + parent, offset + v);
+      }
+    }
+  }
+  CheckAllPairsConnectivity(reference_solution, ett);
+  CheckComponentSizes(reference_solution, ett);
+  // Every present edge is in the forest's edge map.
+  ett.BatchCut(edges.data(), edges.size());
+  for (int v = 0; v < num_vertices; v++) {
+    assert(ett.ComponentSize(v) == 1);
+  }
+}
+
+// Checks cutting edges through the handles that `BatchLink` returns, both with
+// and without an edge map.
+void CheckEdgeHandles(EulerTourTree::EdgeLookup edge_lookup) {
+  std::mt19937 rng{};
+  rng.seed(2);
+  std::uniform_int_distribution<std::mt19937::result_type>
+    vert_dist{0, num_vertices - 1};
+
+  SimpleForestConnectivity reference_solution{num_vertices};
+  EulerTourTree ett{num_vertices, edge_lookup};
+  std::pair<int, int>* links{
+      pbbs::new_array_no_init<pair<int, int>>(num_vertices)};
+  EulerTourTree::EdgeHandle* handles{
+      pbbs::new_array_no_init<EulerTourTree::EdgeHandle>(num_vertices)};
+  int num_edges{0};
+  for (int i = 0; i < num_rounds; i++) {
+    // Alternate between batches small enough to run sequentially and larger
+    // batches.
+    const int link_attempts{i % 2 == 0 ? 50 : link_attempts_per_round};
+    int num_links{0};
+    for (int j = 0; j < link_attempts; j++) {
+      const unsigned long u{vert_dist(rng)}, v{vert_dist(rng)};
+      if (!reference_solution.IsConnected(u, v)) {
+        reference_solution.Link(u, v);
+        links[num_edges + num_links++] = std::make_pair(u, v);
+      }
+    }
+    ett.BatchLink(links + num_edges, num_links, handles + num_edges);
+    num_edges += num_links;
+    CheckAllPairsConnectivity(reference_solution, ett);
+
+    // Cut every `cut_ratio`-th edge, moving the remaining edges and handles to
+    // the front of the arrays.
+    EulerTourTree::EdgeHandle* cut_handles{
+        pbbs::new_array_no_init<EulerTourTree::EdgeHandle>(num_edges)};
+    int num_cuts{0};
+    int num_kept{0};
+    for (int j = 0; j < num_edges; j++) {
+      if (j % cut_ratio == 0) {
+        reference_solution.Cut(links[j].first, links[j].second);
+        cut_handles[num_cuts++] = handles[j];
+      } else {
+        links[num_kept] = links[j];
+        handles[num_kept] = handles[j];
+        num_kept++;
+      }
+    }
+    num_edges = num_kept;
+    ett.BatchCutByHandle(cut_handles, num_cuts);
+    pbbs::delete_array(cut_handles, num_cuts);
+    CheckAllPairsConnectivity(reference_solution, ett);
+    CheckComponentSizes(reference_solution, ett);
+  }
+
+  if (edge_lookup == EulerTourTree::EdgeLookup::kEdgeMap) {
+    // Cutting by handle should have kept the edge map up to date.
+    ett.BatchCut(links, num_edges);
+    for (int v = 0; v < num_vertices; v++) {
+      assert(ett.ComponentSize(v) == 1);
+    }
+  }
+  pbbs::delete_array(handles, num_vertices);
+  pbbs::delete_array(links, num_vertices);
+}
+
+// Checks that `HashEdgeMap` handles finds that run concurrently with deletes and
+// that it does not grow without bound under long-running churn.
+void CheckEdgeMapChurn() {
+  struct Edge {
+    Edge* twin_;
+  };
+  constexpr int num_edges{5000};
+  constexpr int churn_rounds{200};
+  Edge* edges{pbbs::new_array_no_init<Edge>(2 * num_edges)};
+  for (int i = 0; i < num_edges; i++) {
+    edges[2 * i].twin_ = &edges[2 * i + 1];
+    edges[2 * i + 1].twin_ = &edges[2 * i];
+  }
+  parallel_euler_tour_tree::HashEdgeMap<Edge> edge_map{num_edges + 1};
+
+  // Edge `i` is {i, i + 1}, inserted in alternating directions.
+  edge_map.Reserve(num_edges);
+  parallel_for (int i = 0; i < num_edges; i++) {
+    if (i % 2 == 0) {
+      const bool inserted{edge_map.Insert(i, i + 1, &edges[2 * i])};
+      assert(inserted);
+    } else {
+      const bool inserted{edge_map.Insert(i + 1, i, &edges[2 * i + 1])};
+      assert(inserted);
+    }
+  }
+  const size_t full_capacity{edge_map.Capacity()};
+
+  // Delete the even edges while looking up the odd ones.
+  parallel_for (int i = 0; i < num_edges; i++) {
+    if (i % 2 == 0) {
+      const bool deleted{edge_map.Delete(i + 1, i)};
+      assert(deleted);
+    } else {
+      assert(edge_map.Find(i, i + 1) == &edges[2 * i]);
+      assert(edge_map.Find(i + 1, i) == &edges[2 * i + 1]);
+    }
+  }
+  for (int i = 0; i < num_edges; i++) {
+    assert((edge_map.Find(i, i + 1) == nullptr) == (i % 2 == 0));
+  }
+
+  // Repeatedly re-insert and delete the even edges. The tombstones this leaves
+  // behind should be cleared out rather than grow the table.
+  for (int j = 0; j < churn_rounds; j++) {
+    edge_map.Reserve(num_edges / 2);
+    parallel_for (int i = 0; i < num_edges; i += 2) {
+      const bool inserted{edge_map.Insert(i, i + 1, &edges[2 * i])};
+      assert(inserted);
+    }
+    parallel_for (int i = 0; i < num_edges; i += 2) {
+      assert(edge_map.Find(i + 1, i) == &edges[2 * i + 1]);
+      const bool deleted{edge_map.Delete(i, i + 1)};
+      assert(deleted);
+    }
+  }
+  assert(edge_map.Capacity() <= full_capacity);
+  for (int i = 0; i < num_edges; i++) {
+    assert((edge_map.Find(i, i + 1) == nullptr) == (i % 2 == 0));
+  }
+  pbbs::delete_array(edges, 2 * num_edges);
+}
+
+// Checks that `HashEdgeMap` with 64-bit vertex ids keeps apart edges whose
+// endpoints only differ above the low 32 bits.
+void CheckWideEdgeKeys() {
+  struct Edge {
+    Edge* twin_;
+  };
+  constexpr int num_edges{1000};
+  constexpr int64_t high_bit{static_cast<int64_t>(1) << 40};
+  Edge* edges{pbbs::new_array_no_init<Edge>(4 * num_edges)};
+  for (int i = 0; i < 2 * num_edges; i++) {
+    edges[2 * i].twin_ = &edges[2 * i + 1];
+    edges[2 * i + 1].twin_ = &edges[2 * i];
+  }
+  parallel_euler_tour_tree::HashEdgeMap<Edge, int64_t> edge_map{0};
+
+  // Edge `i` is {i, high_bit + i} and edge `num_edges + i` is
+  // {high_bit + i, high_bit + i + 1}.
+  edge_map.Reserve(2 * num_edges);
+  parallel_for (int i = 0; i < num_edges; i++) {
+    const bool inserted_low{
+      edge_map.Insert(i, high_bit + i, &edges[2 * i])};
+    assert(inserted_low);
+    const bool inserted_high{edge_map.Insert(
+        high_bit + i + 1, high_bit + i, &edges[2 * (num_edges + i) + 1])};
+    assert(inserted_high);
+  }
+  for (int i = 0; i < num_edges; i++) {
+    assert(edge_map.Find(high_bit + i, i) == &edges[2 * i + 1]);
+    assert(edge_map.Find(high_bit + i, high_bit + i + 1) ==
+        &edges[2 * (num_edges + i)]);
+    assert(edge_map.Find(i, i + 1) == nullptr);
+    assert(edge_map.Find(0, high_bit + num_edges + i) == nullptr);
+  }
+  for (int i = 0; i < num_edges; i++) {
+    const bool deleted{edge_map.Delete(high_bit + i, i)};
+    assert(deleted);
+  }
+  for (int i = 0; i < num_edges; i++) {
+    assert(edge_map.Find(i, high_bit + i) == nullptr);
+    assert(edge_map.Find(high_bit + i + 1, high_bit + i) ==
+        &edges[2 * (num_edges + i) + 1]);
+  }
+  pbbs::delete_array(edges, 4 * num_edges);
+}
+
+// Checks a forest that uses edge map `EdgeMap` and vertex ids of type `Vertex`
+// on a tree with a few hubs of high degree, so that some edges join two
+// vertices that both have many neighbors.
+template <template <typename, typename> class EdgeMap, typename Vertex = int>
+void CheckEdgeMap() {
+  using Forest = parallel_euler_tour_tree::EulerTourTree<
+    parallel_skip_list::SumAugmentation<int>,
+    parallel_euler_tour_tree::ElementArena,
+    EdgeMap,
+    Vertex>;
+  constexpr Vertex n{1000};
+  constexpr Vertex num_hubs{10};
+  // Each non-hub vertex `v` is a leaf attached to hub `v % num_hubs`, and the
+  // hubs form a path.
+  std::pair<Vertex, Vertex> leaf_edges[n - num_hubs];
+  std::pair<Vertex, Vertex> hub_edges[num_hubs - 1];
+  for (Vertex v = num_hubs; v < n; v++) {
+    leaf_edges[v - num_hubs] = v % 2 == 0
+      ? std::make_pair(v % num_hubs, v)
+      : std::make_pair(v, v % num_hubs);
+  }
+  for (Vertex i = 0; i < num_hubs - 1; i++) {
+    hub_edges[i] = std::make_pair(i, i + 1);
+  }
+
+  Forest forest{n};
+  forest.BatchLink(leaf_edges, n - num_hubs);
+  forest.BatchLink(hub_edges, num_hubs - 1);
+  assert(forest.ComponentSize(0) == n);
+  for (Vertex v = num_hubs; v < n; v++) {
+    assert(forest.SubtreeSize(v, v % num_hubs) == 1);
+    assert(forest.SubtreeSize(v % num_hubs, v) == n - 1);
+  }
+  for (Vertex i = 0; i < num_hubs - 1; i++) {
+    assert(forest.SubtreeSize(i + 1, i) == (num_hubs - 1 - i) * n / num_hubs);
+  }
+
+  forest.BatchCut(hub_edges, num_hubs - 1);
+  for (Vertex i = 0; i < num_hubs; i++) {
+    assert(forest.ComponentSize(i) == n / num_hubs);
+  }
+  forest.BatchCut(leaf_edges, n - num_hubs);
+  for (Vertex v = 0; v < n; v++) {
+    assert(forest.ComponentSize(v) == 1);
+  }
+
+  // Re-add the edges so that the freed slots are reused.
+  forest.BatchLink(hub_edges, num_hubs - 1);
+  forest.BatchLink(leaf_edges, n - num_hubs);
+  assert(forest.ComponentSize(n - 1) == n);
+  forest.BatchCut(leaf_edges, n - num_hubs);
+  assert(forest.ComponentSize(0) == num_hubs);
+}
+
+// Builds a forest using edge map `EdgeMap` in a file arena, opens the file
+// again, which maps it at another address, and checks that the forest found
+// there matches the reference solution and can still be modified.
+template <template <typename, typename> class EdgeMap>
+void CheckFileArena() {
+  using Forest = parallel_euler_tour_tree::EulerTourTree<
+    parallel_skip_list::SumAugmentation<int>,
+    parallel_euler_tour_tree::ElementArena,
+    EdgeMap,
+    int,
+    file_arena::FileArenaStorage>;
+  constexpr int n{300};
+  std::mt19937 rng{};
+  rng.seed(2);
+  std::uniform_int_distribution<int> vert_dist{0, n - 1};
+  SimpleForestConnectivity reference_solution{n};
+  std::unordered_set<std::pair<int, int>, HashIntPairStruct> edges{};
+  std::vector<int> vertex_values(n);
+
+  // Adds random edges that keep the graph a forest, cuts every third edge,
+  // and assigns new values to some vertices.
+  const auto update_forest{[&](Forest* forest) {
+    std::vector<std::pair<int, int>> links;
+    for (int i = 0; i < n; i++) {
+      const int u{vert_dist(rng)};
+      const int v{vert_dist(rng)};
+      if (!reference_solution.IsConnected(u, v)) {
+        reference_solution.Link(u, v);
+        edges.emplace(u, v);
+        links.emplace_back(u, v);
+      }
+    }
+    forest->BatchLink(links.data(), links.size());
+    std::vector<std::pair<int, int>> cuts;
+    int cnt{0};
+    for (auto e : edges) {
+      if (++cnt % 3 == 0) {
+        cuts.push_back(e);
+      }
+    }
+    for (auto e : cuts) {
+      edges.erase(e);
+      reference_solution.Cut(e.first, e.second);
+    }
+    forest->BatchCut(cuts.data(), cuts.size());
+    std::vector<int> vertices;
+    std::vector<int> values;
+    for (int v = 0; v < n; v += 7) {
+      vertex_values[v] = vert_dist(rng);
+      vertices.push_back(v);
+      values.push_back(vertex_values[v]);
+    }
+    forest->BatchUpdateVertexValues(
+        vertices.data(), values.data(), vertices.size());
+  }};
+  const auto check_forest{[&](const Forest& forest) {
+    for (int u = 0; u < n; u++) {
+      for (int v = 0; v < n; v++) {
+        assert(reference_solution.IsConnected(u, v) ==
+            forest.IsConnected(u, v));
+      }
+      assert(reference_solution.ComponentSize(u) == forest.ComponentSize(u));
+    }
+    for (auto e : edges) {
+      const std::vector<int> subtree{
+        reference_solution.SubtreeVertices(e.first, e.second)};
+      int true_aggregate{0};
+      for (int u : subtree) {
+        true_aggregate += vertex_values[u];
+      }
+      assert(static_cast<int>(subtree.size()) ==
+          forest.SubtreeSize(e.first, e.second));
+      assert(true_aggregate == forest.SubtreeAggregate(e.first, e.second));
+    }
+  }};
+
+  char path[]{"/tmp/ett_arena_XXXXXX"};
+  close(mkstemp(path));
+  file_arena::FileArena arena;
+  const bool created{arena.Create(path, 1 << 24)};
+  assert(created);
+  Forest* forest{arena.New<Forest>(n)};
+  arena.SetRoot(forest);
+  for (int i = 0; i < 3; i++) {
+    update_forest(forest);
+  }
+  check_forest(*forest);
+  const bool synced{arena.Sync()};
+  assert(synced);
+
+  // Open the file while it is still mapped so that it lands at a different
+  // address.
+  file_arena::FileArena reopened;
+  const bool opened{reopened.Open(path)};
+  assert(opened);
+  arena.Close();
+  Forest* restored{reopened.GetRoot<Forest>()};
+  assert(restored != nullptr && restored != forest);
+  check_forest(*restored);
+  for (int i = 0; i < 3; i++) {
+    update_forest(restored);
+  }
+  check_forest(*restored);
+  reopened.Delete(restored);
+  reopened.Close();
+
+  // Files that are missing or are not arenas do not open.
+  const bool opened_missing{reopened.Open("/nonexistent/ett_arena")};
+  assert(!opened_missing);
+  {
+    std::ofstream file{path, std::ios::binary | std::ios::trunc};
+    file << std::string(4096, 'x');
+  }
+  const bool opened_garbage{reopened.Open(path)};
+  assert(!opened_garbage);
+  std::remove(path);
 }
 
 int main() {
@@ -39,7 +1380,23 @@ int main() {
   std::unordered_set<std::pair<int, int>, HashIntPairStruct> edges{};
   std::pair<int, int>* ett_input{
       pbbs::new_array_no_init<pair<int, int>>(num_vertices)};
+  int vertex_values[num_vertices]{};
+  int updated_vertices[num_vertices];
+  int updated_values[num_vertices];
   for (int i = 0; i < num_rounds; i++) {
+    // Assign new values to a random subset of the vertices.
+    int num_updates{0};
+    for (int v = 0; v < num_vertices; v++) {
+      if (coin(rng) == 1) {
+        vertex_values[v] = vert_dist(rng);
+        updated_vertices[num_updates] = v;
+        updated_values[num_updates] = vertex_values[v];
+        num_updates++;
+      }
+    }
+    ett.BatchUpdateVertexValues(updated_vertices, updated_values, num_updates);
+    CheckComponentAggregates(reference_solution, ett, vertex_values);
+
     // Generate `link_attempts_per_round` edges randomly, keeping each one that
     // doesn't add a cycle into the forest. Then call `BatchLink` on all of
     // them.
@@ -54,6 +1411,11 @@ int main() {
     }
     ett.BatchLink(ett_input, input_len);
     CheckAllPairsConnectivity(reference_solution, ett);
+    CheckComponentSizes(reference_solution, ett);
+    CheckComponentLabels(reference_solution, &ett);
+    CheckComponentAggregates(reference_solution, ett, vertex_values);
+    CheckSubtrees(reference_solution, ett, edges, vertex_values);
+    CheckAncestors(reference_solution, ett);
 
     // Call `BatchCut` over each `cut_ratio`-th edge.
     input_len = 0;
@@ -73,8 +1435,41 @@ int main() {
     }
     ett.BatchCut(ett_input, input_len);
     CheckAllPairsConnectivity(reference_solution, ett);
+    CheckComponentSizes(reference_solution, ett);
+    CheckComponentLabels(reference_solution, &ett);
+    CheckComponentAggregates(reference_solution, ett, vertex_values);
+    CheckSubtrees(reference_solution, ett, edges, vertex_values);
+    CheckAncestors(reference_solution, ett);
+    CheckSnapshot(reference_solution, &ett, edges, vertex_values);
   }
   pbbs::delete_array(ett_input, num_vertices);
 
+  CheckHubAncestors();
+  CheckEdgelessSnapshots();
+  CheckCyclicSnapshots();
+  CheckIndependentForests();
+  CheckEdgeMapChurn();
+  CheckEdgeMap<parallel_euler_tour_tree::HashEdgeMap>();
+  CheckEdgeMap<parallel_euler_tour_tree::ConcurrentHTEdgeMap>();
+  CheckEdgeMap<parallel_euler_tour_tree::AdjacencyEdgeMap>();
+  CheckWideEdgeKeys();
+  CheckEdgeMap<parallel_euler_tour_tree::HashEdgeMap, int64_t>();
+  CheckEdgeMap<parallel_euler_tour_tree::ConcurrentHTEdgeMap, int64_t>();
+  CheckEdgeMap<parallel_euler_tour_tree::AdjacencyEdgeMap, int64_t>();
+  CheckApplyBatch();
+  CheckBuild();
+  CheckSpanningEdges();
+  CheckCutIfPresent();
+  CheckRebuild();
+  CheckRebuildTouchedTours();
+  CheckRebuildStar();
+  CheckUpdateQueue(64, std::chrono::microseconds{100});
+  CheckUpdateQueue(1, std::chrono::microseconds{0});
+  CheckUpdateQueue(1 << 20, std::chrono::microseconds{20000});
+  CheckEdgeHandles(EulerTourTree::EdgeLookup::kEdgeMap);
+  CheckEdgeHandles(EulerTourTree::EdgeLookup::kHandlesOnly);
+  CheckFileArena<parallel_euler_tour_tree::HashEdgeMap>();
+  CheckFileArena<parallel_euler_tour_tree::AdjacencyEdgeMap>();
+
   std::cout << "Test complete." << std::endl;
 }
@@ -0,0 +1,242 @@
+// Measures what it would cost to store skip list links as byte offsets from the
+// base of an arena, as elements living in a memory-mapped file would need to,
+// instead of as raw pointers.
+//
+// Lays out one cyclic skip list on `-n` elements in an arena whose element
+// order is shuffled, with heights drawn like `parallel_skip_list::ElementBase`
+// draws them. The list is laid out once with raw pointers, once with 64-bit
+// offsets, and once with 32-bit offsets, and for `-iters` iterations each
+// layout times
+//   - relinking every level of the list from scratch, which encodes links,
+//   - `-k` climbs from random elements to the representative of the list in
+//     the manner of `ElementBase::FindRepresentative`, which decode links in a
+//     random access pattern, and
+//   - a walk along the whole bottom level, which decodes links one after
+//     another.
+// Reports the median nanoseconds per link encoded, per climb, and per step of
+// the walk. The arena must stay under 4 GiB for 32-bit offsets, which holds
+// for `-n` up to about 10^8.
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <sequence/parallel_skip_list/include/skip_list.hpp>
+#include <utilities/include/gettime.h>
+#include <utilities/include/parse_command_line.h>
+#include <utilities/include/random.h>
+#include <utilities/include/utils.h>
+
+namespace {
+
+// Base of the arena that offsets are relative to. Like the base address of a
+// mapped file, it is only known at run time.
+char* arena_base{nullptr};
+// Keeps the compiler from discarding the results of the timed loops.
+volatile int64_t checksum_sink;
+
+template <typename T>
+class RawLink {
+ public:
+  T* Get() const { return pointer_; }
+  void Set(T* pointer) { pointer_ = pointer; }
+
+ private:
+  T* pointer_;
+};
+
+template <typename T, typename Offset>
+class OffsetLink {
+ public:
+  T* Get() const { return reinterpret_cast<T*>(arena_base + offset_); }
+  void Set(T* pointer) {
+    offset_ =
+      static_cast<Offset>(reinterpret_cast<char*>(pointer) - arena_base);
+  }
+
+ private:
+  Offset offset_;
+};
+
+struct RawLinks {
+  template <typename T> using Link = RawLink<T>;
+  static constexpr const char* kName{"raw"};
+};
+
+template <typename Offset, const char* Name>
+struct OffsetLinks {
+  template <typename T> using Link = OffsetLink<T, Offset>;
+  static constexpr const char* kName{Name};
+};
+
+constexpr char kOffset64Name[]{"offset64"};
+constexpr char kOffset32Name[]{"offset32"};
+
+template <typename Links>
+struct Node {
+  struct Neighbors {
+    typename Links::template Link<Node> prev;
+    typename Links::template Link<Node> next;
+  };
+
+  typename Links::template Link<Neighbors> neighbors;
+  int height;
+};
+
+// Lays out `heights.size()` nodes followed by all of their neighbor arrays in
+// `arena`, so that node `i` of the list sits at slot `slots[i]`, and returns
+// the nodes.
+template <typename Links>
+Node<Links>* LayOutNodes(char* arena, const std::vector<int>& heights,
+    const std::vector<int>& slots) {
+  using NodeType = Node<Links>;
+  using Neighbors = typename NodeType::Neighbors;
+  const size_t n{heights.size()};
+  NodeType* nodes{reinterpret_cast<NodeType*>(arena)};
+  Neighbors* neighbors{reinterpret_cast<Neighbors*>(nodes + n)};
+  size_t offset{0};
+  for (size_t i = 0; i < n; i++) {
+    NodeType* node{&nodes[slots[i]]};
+    node->height = heights[i];
+    node->neighbors.Set(&neighbors[offset]);
+    offset += heights[i];
+  }
+  return nodes;
+}
+
+// Links every level of the list, in which node `i` sits at slot `slots[i]`,
+// into a cycle.
+template <typename Links>
+void LinkLevels(Node<Links>* nodes, const std::vector<int>& slots,
+    int max_height) {
+  const size_t n{slots.size()};
+  parallel_for (int level = 0; level < max_height; level++) {
+    Node<Links>* first{nullptr};
+    Node<Links>* prev{nullptr};
+    for (size_t i = 0; i < n; i++) {
+      Node<Links>* node{&nodes[slots[i]]};
+      if (node->height > level) {
+        if (prev == nullptr) {
+          first = node;
+        } else {
+          prev->neighbors.Get()[level].next.Set(node);
+          node->neighbors.Get()[level].prev.Set(prev);
+        }
+        prev = node;
+      }
+    }
+    prev->neighbors.Get()[level].next.Set(first);
+    first->neighbors.Get()[level].prev.Set(prev);
+  }
+}
+
+// Same as `ElementBase::FindRepresentative` on a cyclic list.
+template <typename Links>
+const Node<Links>* FindRepresentative(const Node<Links>* node) {
+  const Node<Links>* current{node};
+  int level{current->height - 1};
+  const Node<Links>* level_start{current};
+  const Node<Links>* min_node{current};
+  while (true) {
+    const Node<Links>* next{current->neighbors.Get()[level].next.Get()};
+    if (next == level_start) {
+      return min_node;
+    }
+    current = next;
+    if (level < current->height - 1) {
+      level = current->height - 1;
+      level_start = min_node = current;
+    } else if (current < min_node) {
+      min_node = current;
+    }
+  }
+}
+
+template <typename Links>
+void RunBenchmark(const std::vector<int>& heights,
+    const std::vector<int>& slots, const std::vector<int>& starts,
+    int num_iters) {
+  const size_t n{heights.size()};
+  const int max_height{*std::max_element(heights.begin(), heights.end())};
+  size_t num_links{0};
+  for (int height : heights) {
+    num_links += 2 * height;
+  }
+  const size_t arena_size{n * sizeof(Node<Links>) +
+    num_links / 2 * sizeof(typename Node<Links>::Neighbors)};
+  char* arena{pbbs::new_array_no_init<char>(arena_size)};
+  arena_base = arena;
+  Node<Links>* nodes{LayOutNodes<Links>(arena, heights, slots)};
+
+  const size_t num_climbs{starts.size()};
+  const Node<Links>** representatives{
+    pbbs::new_array_no_init<const Node<Links>*>(num_climbs)};
+  std::vector<double> link_times(num_iters);
+  std::vector<double> climb_times(num_iters);
+  std::vector<double> walk_times(num_iters);
+  int64_t checksum{0};
+  for (int j = 0; j < num_iters; j++) {
+    timer link_t; link_t.start();
+    LinkLevels<Links>(nodes, slots, max_height);
+    link_times[j] = link_t.stop() / num_links;
+
+    timer climb_t; climb_t.start();
+    parallel_for (size_t i = 0; i < num_climbs; i++) {
+      representatives[i] = FindRepresentative<Links>(&nodes[starts[i]]);
+    }
+    climb_times[j] = climb_t.stop() / num_climbs;
+    checksum += representatives[0] - nodes;
+
+    timer walk_t; walk_t.start();
+    const Node<Links>* current{&nodes[slots[0]]};
+    for (size_t i = 0; i < n; i++) {
+      checksum += current->height;
+      current = current->neighbors.Get()[0].next.Get();
+    }
+    walk_times[j] = walk_t.stop() / n;
+  }
+
+  std::cout << Links::kName << ": ";
+  timer::report_time_no_newline("link-ns", 1e9 * median(link_times));
+  timer::report_time_no_newline("climb-ns", 1e9 * median(climb_times));
+  timer::report_time("walk-ns", 1e9 * median(walk_times));
+  checksum_sink = checksum;
+  pbbs::delete_array(representatives, num_climbs);
+  pbbs::delete_array(arena, arena_size);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  commandLine P{argc, argv, "[-n (num elements)] [-k (num climbs)] [-iters]"};
+  const int n{P.getOptionIntValue("-n", 1000000)};
+  const int num_climbs{P.getOptionIntValue("-k", n)};
+  const int num_iters{P.getOptionIntValue("-iters", 5)};
+  std::cout << "Running with " << nworkers() << " workers" << std::endl;
+
+  pbbs::random randomness{};
+  std::vector<int> heights(n);
+  for (int i = 0; i < n; i++) {
+    heights[i] = parallel_skip_list::Element::GetHeight(randomness.ith_rand(i));
+  }
+  std::vector<int> slots(n);
+  for (int i = 0; i < n; i++) {
+    slots[i] = i;
+  }
+  std::mt19937 generator{0};
+  std::shuffle(slots.begin(), slots.end(), generator);
+  std::uniform_int_distribution<int> slot_dist{0, n - 1};
+  std::vector<int> starts(num_climbs);
+  for (int i = 0; i < num_climbs; i++) {
+    starts[i] = slot_dist(generator);
+  }
+
+  RunBenchmark<RawLinks>(heights, slots, starts, num_iters);
+  RunBenchmark<OffsetLinks<uint64_t, kOffset64Name>>(
+      heights, slots, starts, num_iters);
+  RunBenchmark<OffsetLinks<uint32_t, kOffset32Name>>(
+      heights, slots, starts, num_iters);
+  return 0;
+}
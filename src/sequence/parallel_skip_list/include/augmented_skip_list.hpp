@@ -1,29 +1,93 @@
 #pragma once
 
+#include <limits>
+#include <new>
+#include <type_traits>
 #include <utility>
 
+#include <sequence/parallel_skip_list/include/concurrent_array_allocator.hpp>
 #include <sequence/parallel_skip_list/include/skip_list_base.hpp>
+#include <utilities/include/seq.h>
+#include <utilities/include/sequence_ops.h>
+#include <utilities/include/utils.h>
 
 namespace parallel_skip_list {
 
-// Batch-parallel augmented skip list. Currently, the augmentation is
-// hardcoded to the sum function with the value 1 assigned to each element. As
-// such, `GetSum()` returns the size of the list.
+// Augmentation functions for `AugmentedElementBase`. An augmentation is a
+// struct providing
 //
-// TODO(tomtseng): Allow user to pass in their own arbitrary associative
-// augmentation functions. The contract for `GetSum` on a cyclic list should be
-// that the function will be applied starting from `this`, because where we
-// begin applying the function matters for non-commutative functions.
-class AugmentedElement : private ElementBase<AugmentedElement> {
-  friend class ElementBase<AugmentedElement>;
+//   using ValueType = ...;
+//   static ValueType Identity();
+//   static ValueType Combine(const ValueType& a, const ValueType& b);
+//
+// where `Combine` is associative and `Identity()` is an identity for
+// `Combine`. `Combine` need not be commutative. `ValueType` must be trivially
+// copyable since values are stored in arrays whose constructors and destructors
+// are never called.
+template <typename T>
+struct SumAugmentation {
+  using ValueType = T;
+  static T Identity() { return T{0}; }
+  static T Combine(const T& a, const T& b) { return a + b; }
+};
+
+template <typename T>
+struct MinAugmentation {
+  using ValueType = T;
+  static T Identity() { return std::numeric_limits<T>::max(); }
+  static T Combine(const T& a, const T& b) { return b < a ? b : a; }
+};
+
+template <typename T>
+struct MaxAugmentation {
+  using ValueType = T;
+  static T Identity() { return std::numeric_limits<T>::lowest(); }
+  static T Combine(const T& a, const T& b) { return a < b ? b : a; }
+};
+
+// Batch-parallel augmented skip list. Each element is assigned a value on
+// construction, and values may be reassigned with `BatchUpdate()`. The
+// augmentation `Augmentation` (see above) determines how values are combined.
+// A count of elements is given by `SumAugmentation<int>` with every value set
+// to 1.
+//
+// Like `ElementBase<Derived>`, this uses the curiously recurring template
+// pattern so that derived classes may add their own data members to each
+// element. A minimal instantiation is `AugmentedElement` below.
+template <typename Derived, typename Augmentation = SumAugmentation<int>,
+    typename Storage = HeapStorage>
+class AugmentedElementBase : private ElementBase<Derived, Storage> {
+  friend class ElementBase<Derived, Storage>;
  public:
-  using ElementBase<AugmentedElement>::Initialize;
-  using ElementBase<AugmentedElement>::Finish;
+  using ValueType = typename Augmentation::ValueType;
+  using StorageType = Storage;
+  template <typename T>
+  using Pointer = typename Storage::template Pointer<T>;
+  static_assert(std::is_trivially_copyable<ValueType>::value,
+      "augmented values must be trivially copyable");
 
-  // See comments on `ElementBase<>`.
-  AugmentedElement();
-  explicit AugmentedElement(size_t random_int);
-  ~AugmentedElement();
+  using typename ElementBase<Derived, Storage>::Neighbors;
+  using ElementBase<Derived, Storage>::Initialize;
+  using ElementBase<Derived, Storage>::Finish;
+  using ElementBase<Derived, Storage>::GetHeight;
+
+  // See comments on `ElementBase<>`. The element is assigned value
+  // `Augmentation::Identity()`.
+  AugmentedElementBase();
+  explicit AugmentedElementBase(size_t random_int);
+  // Uses random_int as a seed to generate a random height for the element and
+  // assigns value `value` to the element.
+  AugmentedElementBase(size_t random_int, const ValueType& value);
+  // Like the constructors above, but stores the element's links and values in
+  // `neighbors` and `values`, which must each have room for
+  // `GetHeight(random_int)` entries and must outlive the element. See
+  // `ElementBase(size_t, Neighbors*)`. `AugmentedElementBlock` below manages
+  // such storage.
+  AugmentedElementBase(
+      size_t random_int, Neighbors* neighbors, ValueType* values);
+  AugmentedElementBase(size_t random_int, const ValueType& value,
+      Neighbors* neighbors, ValueType* values);
+  ~AugmentedElementBase();
 
   // For each `{left, right}` in the `len`-length array `joins`, concatenate the
   // list that `left` lives in to the list that `right` lives in.
@@ -31,17 +95,28 @@ class AugmentedElement : private ElementBase<AugmentedElement> {
   // `left` must be the last node in its list, and `right` must be the first
   // node of in its list. Each `left` must be unique, and each `right` must be
   // unique.
-  static void BatchJoin(
-      std::pair<AugmentedElement*, AugmentedElement*>* joins, int len);
+  static void BatchJoin(std::pair<Derived*, Derived*>* joins, size_t len);
 
   // For each `v` in the `len`-length array `splits`, split `v`'s list right
   // after `v`.
-  static void BatchSplit(AugmentedElement** splits, int len);
+  static void BatchSplit(Derived** splits, size_t len);
+
+  // Builds lists out of the `len` elements in `elements` all at once by
+  // placing each `elements[i]` right before `successors[i]`, or at the end of
+  // its list if `successors[i]` is null. The successors may form cycles, which
+  // become cyclic lists. Every element in `elements` must be the successor of
+  // at most one element in `elements`, and no element may share a list with an
+  // element outside `elements`. Their old links are discarded.
+  //
+  // The lists are laid out bottom up, one level at a time, without the
+  // contention of joining elements one pair at a time, so this takes O(`len`)
+  // expected work where `BatchJoin` would take O(`len` log `len`).
+  static void BatchBuild(Derived** elements, Derived** successors, size_t len);
 
   // For each `i`=0,1,...,`len`-1, assign value `new_values[i]` to element
   // `elements[i]`.
   static void BatchUpdate(
-      AugmentedElement** elements, int* new_values, int len);
+      Derived** elements, const ValueType* new_values, size_t len);
 
   // Get the result of applying the augmentation function over the subsequence
   // between `left` and `right` inclusive.
@@ -49,18 +124,48 @@ class AugmentedElement : private ElementBase<AugmentedElement> {
   // `left` and `right` must live in the same list, and `left` must precede
   // `right` in the list.
   //
+  // `left` and `right` may live in a cyclic list, in which case the
+  // subsequence is the one that starts at `left` and walks forward to `right`.
+  //
   // This function does not modify the data structure, so it may run
   // concurrently with other `GetSubsequenceSum` calls and const function calls.
-  static int GetSubsequenceSum(
-      const AugmentedElement* left, const AugmentedElement* right);
+  static ValueType GetSubsequenceSum(const Derived* left, const Derived* right);
+
+  // Returns the value assigned to this element.
+  const ValueType& GetValue() const;
 
   // Get result of applying the augmentation function over the whole list that
-  // the element lives in.
-  int GetSum() const;
+  // the element lives in. If the list is cyclic, the function is applied
+  // starting from this element.
+  ValueType GetSum() const;
+
+  // Calls `f(e)` on each element `e` in the list that this element lives in
+  // whose value satisfies `pred`. The list must be cyclic.
+  //
+  // `pred` is also applied to the combined values of runs of elements so that
+  // runs holding no matching element are skipped. `pred` must therefore hold on
+  // `Augmentation::Combine(a, b)` whenever it holds on `a` or on `b`. With
+  // that, visiting k matching elements takes O(k log n) expected work.
+  //
+  // Like `GetSubsequenceSum`, this does not modify the data structure.
+  template <typename P, typename F>
+  void ForEachMatchingElement(P pred, F f) const;
+  // Same as `ForEachMatchingElement`, except that runs of elements are visited
+  // in parallel, so `pred` and `f` may be called concurrently and in no
+  // particular order.
+  template <typename P, typename F>
+  void ParallelForEachMatchingElement(P pred, F f) const;
+
+  // Resets the element to a singleton list with value `value`, as if it were
+  // newly constructed with the same height. This allows elements to be
+  // recycled without reallocating them. The element must not share a list
+  // with any other element.
+  void Reset(const ValueType& value);
 
-  using ElementBase<AugmentedElement>::FindRepresentative;
-  using ElementBase<AugmentedElement>::GetPreviousElement;
-  using ElementBase<AugmentedElement>::GetNextElement;
+  using ElementBase<Derived, Storage>::FindRepresentative;
+  using ElementBase<Derived, Storage>::FindLeftParent;
+  using ElementBase<Derived, Storage>::GetPreviousElement;
+  using ElementBase<Derived, Storage>::GetNextElement;
 
  private:
   static void DerivedInitialize();
@@ -70,10 +175,617 @@ class AugmentedElement : private ElementBase<AugmentedElement> {
   void UpdateTopDown(int level);
   void UpdateTopDownSequential(int level);
 
-  int* values_;
+  // Calls `f` on the elements satisfying `pred` among the run of elements
+  // whose combined value is `values_[level]`.
+  template <typename P, typename F>
+  void VisitMatchingElements(int level, P& pred, F& f) const;
+  // Same as `VisitMatchingElements`, but visits the runs one level down in
+  // parallel.
+  template <typename P, typename F>
+  void VisitMatchingElementsParallel(int level, P& pred, F& f) const;
+
+  static concurrent_array_allocator::Allocator<ValueType>* value_allocator_;
+
+  Pointer<ValueType> values_;
   // When updating augmented values, this marks the lowest index at which the
   // `values_` needs to be updated.
   int update_level_;
 };
 
+// Augmented skip list in which every element has value 1, so `GetSum()`
+// returns the size of the list. See interface of `AugmentedElementBase<T>`.
+class AugmentedElement : public AugmentedElementBase<AugmentedElement> {
+ public:
+  explicit AugmentedElement(size_t random_int)
+    : AugmentedElementBase<AugmentedElement>{random_int, 1} {}
+};
+
+// Fixed-size array of elements whose links and values are carved out of two
+// contiguous blocks owned by the array. The elements do not use the allocators
+// shared by all elements of type `Elem`, so they need no `Initialize()` or
+// `Finish()` call, and separate blocks may be created, modified, and destroyed
+// concurrently.
+//
+// `Elem` must derive from `AugmentedElementBase` and have constructors
+// `Elem(size_t, Neighbors*, ValueType*)` and
+// `Elem(size_t, const ValueType&, Neighbors*, ValueType*)` that forward to the
+// corresponding `AugmentedElementBase` constructors.
+//
+// The blocks come from the storage policy `Elem::StorageType` on behalf of the
+// array, so with `file_arena::FileArenaStorage`, the array must itself live in
+// a `file_arena::FileArena`.
+template <typename Elem>
+class AugmentedElementBlock {
+ public:
+  using ValueType = typename Elem::ValueType;
+
+  AugmentedElementBlock() = delete;
+  // Constructs `size` elements. Element `i` uses seed `randomness.ith_rand(i)`
+  // and is assigned value `Augmentation::Identity()`.
+  AugmentedElementBlock(size_t size, pbbs::random randomness);
+  // Like above, but assigns value `value` to every element.
+  AugmentedElementBlock(
+      size_t size, pbbs::random randomness, const ValueType& value);
+  ~AugmentedElementBlock();
+  AugmentedElementBlock(const AugmentedElementBlock&) = delete;
+  AugmentedElementBlock(AugmentedElementBlock&&) = delete;
+  AugmentedElementBlock& operator=(const AugmentedElementBlock&) = delete;
+  AugmentedElementBlock& operator=(AugmentedElementBlock&&) = delete;
+
+  Elem& operator[](size_t i) const { return elements_[i]; }
+
+ private:
+  // Allocates storage and then calls `construct(i, random_int, neighbors,
+  // values)` for each `i` to construct element `i` in place.
+  template <typename F>
+  void ConstructElements(pbbs::random randomness, F construct);
+
+  using Storage = typename Elem::StorageType;
+  template <typename T>
+  using Pointer = typename Elem::template Pointer<T>;
+
+  size_t size_;
+  size_t total_height_;
+  Pointer<Elem> elements_;
+  Pointer<typename Elem::Neighbors> neighbors_;
+  Pointer<ValueType> values_;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+//                           Implementation below.                           //
+///////////////////////////////////////////////////////////////////////////////
+
+namespace _internal {
+
+constexpr int kNoUpdateLevel{-1};
+
+}  // namespace _internal
+
+template <typename Derived, typename Augmentation, typename Storage>
+concurrent_array_allocator::Allocator<
+  typename AugmentedElementBase<Derived, Augmentation, Storage>::ValueType>*
+    AugmentedElementBase<
+      Derived, Augmentation, Storage>::value_allocator_{nullptr};
+
+template <typename Derived, typename Augmentation, typename Storage>
+void AugmentedElementBase<Derived, Augmentation, Storage>::DerivedInitialize() {
+  if (value_allocator_ == nullptr) {
+    value_allocator_ = new concurrent_array_allocator::Allocator<ValueType>;
+  }
+}
+
+template <typename Derived, typename Augmentation, typename Storage>
+void AugmentedElementBase<Derived, Augmentation, Storage>::DerivedFinish() {
+  if (value_allocator_ != nullptr) {
+    delete value_allocator_;
+    value_allocator_ = nullptr;
+  }
+}
+
+template <typename Derived, typename Augmentation, typename Storage>
+AugmentedElementBase<Derived, Augmentation, Storage>::AugmentedElementBase()
+  : ElementBase<Derived, Storage>{}, update_level_{_internal::kNoUpdateLevel} {
+  values_ = value_allocator_->Allocate(this->height_);
+  const ValueType identity{Augmentation::Identity()};
+  for (int i = 0; i < this->height_; i++) {
+    values_[i] = identity;
+  }
+}
+
+template <typename Derived, typename Augmentation, typename Storage>
+AugmentedElementBase<Derived, Augmentation, Storage>::AugmentedElementBase(
+    size_t random_int)
+  : AugmentedElementBase{random_int, Augmentation::Identity()} {}
+
+template <typename Derived, typename Augmentation, typename Storage>
+AugmentedElementBase<Derived, Augmentation, Storage>::AugmentedElementBase(
+    size_t random_int, const ValueType& value)
+  : ElementBase<Derived, Storage>{random_int}
+  , update_level_{_internal::kNoUpdateLevel} {
+  values_ = value_allocator_->Allocate(this->height_);
+  for (int i = 0; i < this->height_; i++) {
+    values_[i] = value;
+  }
+}
+
+template <typename Derived, typename Augmentation, typename Storage>
+AugmentedElementBase<Derived, Augmentation, Storage>::AugmentedElementBase(
+    size_t random_int, Neighbors* neighbors, ValueType* values)
+  : AugmentedElementBase{
+      random_int, Augmentation::Identity(), neighbors, values} {}
+
+template <typename Derived, typename Augmentation, typename Storage>
+AugmentedElementBase<Derived, Augmentation, Storage>::AugmentedElementBase(
+    size_t random_int, const ValueType& value,
+    Neighbors* neighbors, ValueType* values)
+  : ElementBase<Derived, Storage>{random_int, neighbors}
+  , values_{values}
+  , update_level_{_internal::kNoUpdateLevel} {
+  for (int i = 0; i < this->height_; i++) {
+    values_[i] = value;
+  }
+}
+
+template <typename Derived, typename Augmentation, typename Storage>
+AugmentedElementBase<Derived, Augmentation, Storage>::~AugmentedElementBase() {
+  if (this->owns_storage_) {
+    value_allocator_->Free(values_, this->height_);
+  }
+}
+
+template <typename Derived, typename Augmentation, typename Storage>
+void AugmentedElementBase<Derived, Augmentation, Storage>::Reset(
+    const ValueType& value) {
+  for (int i = 0; i < this->height_; i++) {
+    this->neighbors_[i].prev = this->neighbors_[i].next = nullptr;
+    values_[i] = value;
+  }
+  update_level_ = _internal::kNoUpdateLevel;
+}
+
+template <typename Derived, typename Augmentation, typename Storage>
+void AugmentedElementBase<
+    Derived, Augmentation, Storage>::UpdateTopDownSequential(int level) {
+  constexpr int NA{_internal::kNoUpdateLevel};
+  if (level == 0) {
+    if (this->height_ == 1) {
+      update_level_ = NA;
+    }
+    return;
+  }
+
+  if (update_level_ < level) {
+    UpdateTopDownSequential(level - 1);
+  }
+  ValueType sum{values_[level - 1]};
+  Derived* curr{this->neighbors_[level - 1].next};
+  while (curr != nullptr && curr->height_ < level + 1) {
+    if (curr->update_level_ != NA && curr->update_level_ < level) {
+      curr->UpdateTopDownSequential(level - 1);
+    }
+    sum = Augmentation::Combine(sum, curr->values_[level - 1]);
+    curr = curr->neighbors_[level - 1].next;
+  }
+  values_[level] = sum;
+
+  if (this->height_ == level + 1) {
+    update_level_ = NA;
+  }
+}
+
+// `v.UpdateTopDown(level)` updates the augmented values of descendants of `v`'s
+// `level`-th node. `update_level_` is used to determine what nodes need
+// updating. `update_level_` is reset to `NA` for all traversed nodes at end of
+// this function.
+template <typename Derived, typename Augmentation, typename Storage>
+void AugmentedElementBase<
+    Derived, Augmentation, Storage>::UpdateTopDown(int level) {
+  constexpr int NA{_internal::kNoUpdateLevel};
+  if (level <= 6) {
+    UpdateTopDownSequential(level);
+    return;
+  }
+
+  // Recursively update augmented values of children.
+  Derived* curr{static_cast<Derived*>(this)};
+  do {
+    if (curr->update_level_ != NA && curr->update_level_ < level) {
+      cilk_spawn curr->UpdateTopDown(level - 1);
+    }
+    curr = curr->neighbors_[level - 1].next;
+  } while (curr != nullptr && curr->height_ < level + 1);
+  cilk_sync;
+
+  // Now that children have correct augmented valeus, update self's augmented
+  // value.
+  ValueType sum{values_[level - 1]};
+  curr = this->neighbors_[level - 1].next;
+  while (curr != nullptr && curr->height_ < level + 1) {
+    sum = Augmentation::Combine(sum, curr->values_[level - 1]);
+    curr = curr->neighbors_[level - 1].next;
+  }
+  values_[level] = sum;
+
+  if (this->height_ == level + 1) {
+    update_level_ = NA;
+  }
+}
+
+// If `new_values` is non-null, for each `i`=0,1,...,`len`-1, assign value
+// `new_vals[i]` to element `elements[i]`.
+//
+// If `new_values` is null, update the augmented values of the ancestors of
+// `elements`, where the "ancestors" of element `v` refer to `v`,
+// `v->FindLeftParent(0)`, `v->FindLeftParent(0)->FindLeftParent(1)`,
+// `v->FindLeftParent(0)->FindLeftParent(2)`, and so on. This functionality is
+// used privately to keep the augmented values correct when the list has
+// structurally changed.
+template <typename Derived, typename Augmentation, typename Storage>
+void AugmentedElementBase<Derived, Augmentation, Storage>::BatchUpdate(
+    Derived** elements, const ValueType* new_values, size_t len) {
+  constexpr int NA{_internal::kNoUpdateLevel};
+  if (new_values != nullptr) {
+    parallel_for (size_t i = 0; i < len; i++) {
+      elements[i]->values_[0] = new_values[i];
+    }
+  }
+
+  // The nodes whose augmented values need updating are the ancestors of
+  // `elements`. Some nodes may share ancestors. `top_nodes` will contain,
+  // without duplicates, the set of all ancestors of `elements` with no left
+  // parents. From there we can walk down from those ancestors to update all
+  // required augmented values.
+  Derived** top_nodes{pbbs::new_array_no_init<Derived*>(len)};
+
+  parallel_for (size_t i = 0; i < len; i++) {
+    int level{0};
+    Derived* curr{elements[i]};
+    while (true) {
+      int curr_update_level{curr->update_level_};
+      if (curr_update_level == NA && CAS(&curr->update_level_, NA, level)) {
+        level = curr->height_ - 1;
+        Derived* parent{curr->FindLeftParent(level)};
+        if (parent == nullptr) {
+          top_nodes[i] = curr;
+          break;
+        } else {
+          curr = parent;
+          level++;
+        }
+      } else {
+        // Someone other execution is shares this ancestor and has already
+        // claimed it, so there's no need to walk further up.
+        if (curr_update_level > level) {
+          writeMin(&curr->update_level_, level);
+        }
+        top_nodes[i] = nullptr;
+        break;
+      }
+    }
+  }
+
+  parallel_for (size_t i = 0; i < len; i++) {
+    if (top_nodes[i] != nullptr) {
+      top_nodes[i]->UpdateTopDown(top_nodes[i]->height_ - 1);
+    }
+  }
+
+  pbbs::delete_array(top_nodes, len);
+}
+
+template <typename Derived, typename Augmentation, typename Storage>
+void AugmentedElementBase<Derived, Augmentation, Storage>::BatchJoin(
+    std::pair<Derived*, Derived*>* joins, size_t len) {
+  Derived** join_lefts{pbbs::new_array_no_init<Derived*>(len)};
+  parallel_for (size_t i = 0; i < len; i++) {
+    ElementBase<Derived, Storage>::Join(joins[i].first, joins[i].second);
+    join_lefts[i] = joins[i].first;
+  }
+  BatchUpdate(join_lefts, nullptr, len);
+  pbbs::delete_array(join_lefts, len);
+}
+
+template <typename Derived, typename Augmentation, typename Storage>
+void AugmentedElementBase<Derived, Augmentation, Storage>::BatchSplit(
+    Derived** splits, size_t len) {
+  constexpr int NA{_internal::kNoUpdateLevel};
+  parallel_for (size_t i = 0; i < len; i++) {
+    splits[i]->Split();
+  }
+  parallel_for (size_t i = 0; i < len; i++) {
+    Derived* curr{splits[i]};
+    // `can_proceed` breaks ties when there are duplicate splits. When two
+    // splits occur at the same place, only one of them should walk up and
+    // update.
+    bool can_proceed{
+        curr->update_level_ == NA && CAS(&curr->update_level_, NA, 0)};
+    if (can_proceed) {
+      // Update values of `curr`'s ancestors. We walk leftwards, so values are
+      // combined on the left of the running sum.
+      ValueType sum{curr->values_[0]};
+      int level{0};
+      while (true) {
+        if (level < curr->height_ - 1) {
+          level++;
+          curr->values_[level] = sum;
+        } else {
+          curr = curr->neighbors_[level].prev;
+          if (curr == nullptr) {
+            break;
+          } else {
+            sum = Augmentation::Combine(curr->values_[level], sum);
+          }
+        }
+      }
+    }
+  }
+  parallel_for (size_t i = 0; i < len; i++) {
+    splits[i]->update_level_ = NA;
+  }
+}
+
+// Each level is built from the one below it: an element that reaches level
+// `level` walks forward on level `level - 1` to the next element that reaches
+// level `level`, combining values along the way. Every link and value has a
+// single writer, and each walk takes O(1) expected steps.
+template <typename Derived, typename Augmentation, typename Storage>
+void AugmentedElementBase<Derived, Augmentation, Storage>::BatchBuild(
+    Derived** elements, Derived** successors, size_t len) {
+  parallel_for (size_t i = 0; i < len; i++) {
+    elements[i]->neighbors_[0].prev = nullptr;
+    elements[i]->update_level_ = _internal::kNoUpdateLevel;
+  }
+  parallel_for (size_t i = 0; i < len; i++) {
+    elements[i]->neighbors_[0].next = successors[i];
+    if (successors[i] != nullptr) {
+      successors[i]->neighbors_[0].prev = elements[i];
+    }
+  }
+
+  // `level_elements` holds the elements that reach level `level - 1`.
+  Derived** level_elements{elements};
+  size_t level_len{len};
+  for (int level = 1; level_len > 0; level++) {
+    bool* reaches_level{pbbs::new_array_no_init<bool>(level_len)};
+    parallel_for (size_t i = 0; i < level_len; i++) {
+      reaches_level[i] = level_elements[i]->height_ > level;
+    }
+    seq::sequence<Derived*> next_level_seq{
+      pbbs::pack(seq::sequence<Derived*>(level_elements, level_len),
+          seq::sequence<bool>(reaches_level, level_len))};
+    pbbs::delete_array(reaches_level, level_len);
+    if (level_elements != elements) {
+      pbbs::delete_array(level_elements, level_len);
+    }
+    level_elements = next_level_seq.as_array();
+    level_len = next_level_seq.size();
+
+    parallel_for (size_t i = 0; i < level_len; i++) {
+      level_elements[i]->neighbors_[level].prev = nullptr;
+    }
+    parallel_for (size_t i = 0; i < level_len; i++) {
+      Derived* element{level_elements[i]};
+      ValueType sum{element->values_[level - 1]};
+      Derived* curr{element->neighbors_[level - 1].next};
+      while (curr != nullptr && curr->height_ <= level) {
+        sum = Augmentation::Combine(sum, curr->values_[level - 1]);
+        curr = curr->neighbors_[level - 1].next;
+      }
+      element->values_[level] = sum;
+      element->neighbors_[level].next = curr;
+      if (curr != nullptr) {
+        curr->neighbors_[level].prev = element;
+      }
+    }
+  }
+  if (level_elements != elements) {
+    pbbs::delete_array(level_elements, level_len);
+  }
+}
+
+template <typename Derived, typename Augmentation, typename Storage>
+typename AugmentedElementBase<Derived, Augmentation, Storage>::ValueType
+AugmentedElementBase<Derived, Augmentation, Storage>::GetSubsequenceSum(
+    const Derived* left, const Derived* right) {
+  // `left_sum` covers the elements walked over from the original `left` up to
+  // but excluding `left`, and `right_sum` covers the elements from `right` to
+  // the original `right` inclusive. Keeping them separate preserves order for
+  // non-commutative augmentations.
+  ValueType left_sum{Augmentation::Identity()};
+  ValueType right_sum{right->values_[0]};
+  while (left != right) {
+    const int level{min(left->height_, right->height_) - 1};
+    if (level == left->height_ - 1) {
+      left_sum = Augmentation::Combine(left_sum, left->values_[level]);
+      left = left->neighbors_[level].next;
+    } else {
+      right = right->neighbors_[level].prev;
+      right_sum = Augmentation::Combine(right->values_[level], right_sum);
+    }
+  }
+  return Augmentation::Combine(left_sum, right_sum);
+}
+
+template <typename Derived, typename Augmentation, typename Storage>
+const typename AugmentedElementBase<Derived, Augmentation, Storage>::ValueType&
+AugmentedElementBase<Derived, Augmentation, Storage>::GetValue() const {
+  return values_[0];
+}
+
+template <typename Derived, typename Augmentation, typename Storage>
+typename AugmentedElementBase<Derived, Augmentation, Storage>::ValueType
+AugmentedElementBase<Derived, Augmentation, Storage>::GetSum() const {
+  // Here we use knowledge of the implementation of `FindRepresentative()`.
+  // `FindRepresentative()` gives some element that reaches the top level of the
+  // list. For acyclic lists, the element is the leftmost one.
+  Derived* root{FindRepresentative()};
+  int level{root->height_ - 1};
+  if (root->neighbors_[level].prev != nullptr) {
+    // The list is cyclic. Apply the function starting from `this`.
+    const Derived* self{static_cast<const Derived*>(this)};
+    return GetSubsequenceSum(self, self->neighbors_[0].prev);
+  }
+
+  // Sum the values across the top level of the list.
+  ValueType sum{root->values_[level]};
+  Derived* curr{root->neighbors_[level].next};
+  while (curr != nullptr) {
+    sum = Augmentation::Combine(sum, curr->values_[level]);
+    curr = curr->neighbors_[level].next;
+  }
+  // Traverse backwards to beginning of list and sum values to the left of
+  // `root`.
+  curr = root;
+  while (true) {
+    while (level >= 0 && curr->neighbors_[level].prev == nullptr) {
+      level--;
+    }
+    if (level < 0) {
+      break;
+    }
+    while (curr->neighbors_[level].prev != nullptr) {
+      curr = curr->neighbors_[level].prev;
+      sum = Augmentation::Combine(curr->values_[level], sum);
+    }
+  }
+  return sum;
+}
+
+// `values_[level]` of an element combines the values of the elements from it
+// up to but excluding its successor at `level`, so the successors at `level -
+// 1` within that range partition it into runs one level down.
+template <typename Derived, typename Augmentation, typename Storage>
+template <typename P, typename F>
+void AugmentedElementBase<
+    Derived, Augmentation, Storage>::VisitMatchingElements(
+    int level, P& pred, F& f) const {
+  const Derived* self{static_cast<const Derived*>(this)};
+  if (level == 0) {
+    f(const_cast<Derived*>(self));
+    return;
+  }
+  const Derived* end{self->neighbors_[level].next};
+  const Derived* curr{self};
+  do {
+    if (pred(curr->values_[level - 1])) {
+      curr->VisitMatchingElements(level - 1, pred, f);
+    }
+    curr = curr->neighbors_[level - 1].next;
+  } while (curr != end);
+}
+
+template <typename Derived, typename Augmentation, typename Storage>
+template <typename P, typename F>
+void AugmentedElementBase<
+    Derived, Augmentation, Storage>::ForEachMatchingElement(
+    P pred, F f) const {
+  // In a cyclic list, every level is a cycle, and the top level of the list
+  // holds `FindRepresentative()`.
+  const Derived* root{FindRepresentative()};
+  const int level{root->height_ - 1};
+  const Derived* curr{root};
+  do {
+    if (pred(curr->values_[level])) {
+      curr->VisitMatchingElements(level, pred, f);
+    }
+    curr = curr->neighbors_[level].next;
+  } while (curr != root);
+}
+
+// Like `UpdateTopDown`, this falls back to the sequential walk near the bottom
+// of the list, where runs are too short to be worth spawning.
+template <typename Derived, typename Augmentation, typename Storage>
+template <typename P, typename F>
+void AugmentedElementBase<
+    Derived, Augmentation, Storage>::VisitMatchingElementsParallel(
+    int level, P& pred, F& f) const {
+  if (level <= 6) {
+    VisitMatchingElements(level, pred, f);
+    return;
+  }
+  const Derived* end{this->neighbors_[level].next};
+  const Derived* curr{static_cast<const Derived*>(this)};
+  do {
+    if (pred(curr->values_[level - 1])) {
+      cilk_spawn curr->VisitMatchingElementsParallel(level - 1, pred, f);
+    }
+    curr = curr->neighbors_[level - 1].next;
+  } while (curr != end);
+  cilk_sync;
+}
+
+template <typename Derived, typename Augmentation, typename Storage>
+template <typename P, typename F>
+void AugmentedElementBase<
+    Derived, Augmentation, Storage>::ParallelForEachMatchingElement(
+    P pred, F f) const {
+  const Derived* root{FindRepresentative()};
+  const int level{root->height_ - 1};
+  const Derived* curr{root};
+  do {
+    if (pred(curr->values_[level])) {
+      cilk_spawn curr->VisitMatchingElementsParallel(level, pred, f);
+    }
+    curr = curr->neighbors_[level].next;
+  } while (curr != root);
+  cilk_sync;
+}
+
+template <typename Elem>
+AugmentedElementBlock<Elem>::AugmentedElementBlock(
+    size_t size, pbbs::random randomness)
+  : size_{size} {
+  ConstructElements(randomness, [&](size_t i, size_t random_int,
+        typename Elem::Neighbors* neighbors, ValueType* values) {
+    new (&elements_[i]) Elem{random_int, neighbors, values};
+  });
+}
+
+template <typename Elem>
+AugmentedElementBlock<Elem>::AugmentedElementBlock(
+    size_t size, pbbs::random randomness, const ValueType& value)
+  : size_{size} {
+  ConstructElements(randomness, [&](size_t i, size_t random_int,
+        typename Elem::Neighbors* neighbors, ValueType* values) {
+    new (&elements_[i]) Elem{random_int, value, neighbors, values};
+  });
+}
+
+template <typename Elem>
+template <typename F>
+void AugmentedElementBlock<Elem>::ConstructElements(
+    pbbs::random randomness, F construct) {
+  // `offsets[i]` is the position of element `i`'s links and values within
+  // `neighbors_` and `values_`.
+  size_t* offsets{pbbs::new_array_no_init<size_t>(size_)};
+  parallel_for (size_t i = 0; i < size_; i++) {
+    offsets[i] = Elem::GetHeight(randomness.ith_rand(i));
+  }
+  // `utils::sequence::scan` cannot take an empty input, which the edge element
+  // arena of a forest on one vertex has.
+  total_height_ = size_ == 0
+    ? 0
+    : utils::sequence::scan(
+        offsets, offsets, size_, addF<size_t>(), static_cast<size_t>(0));
+  elements_ = Storage::template NewArray<Elem>(this, size_);
+  typename Elem::Neighbors* neighbors{
+    Storage::template NewArray<typename Elem::Neighbors>(this, total_height_)};
+  ValueType* values{Storage::template NewArray<ValueType>(this, total_height_)};
+  neighbors_ = neighbors;
+  values_ = values;
+  parallel_for (size_t i = 0; i < size_; i++) {
+    construct(i, randomness.ith_rand(i),
+        neighbors + offsets[i], values + offsets[i]);
+  }
+  pbbs::delete_array(offsets, size_);
+}
+
+template <typename Elem>
+AugmentedElementBlock<Elem>::~AugmentedElementBlock() {
+  Storage::template DeleteArray<Elem>(this, elements_, size_);
+  Storage::template DeleteArray<ValueType>(this, values_, total_height_);
+  Storage::template DeleteArray<typename Elem::Neighbors>(
+      this, neighbors_, total_height_);
+}
+
 }  // namespace parallel_skip_list
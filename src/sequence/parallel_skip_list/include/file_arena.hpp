@@ -0,0 +1,441 @@
+// Memory-mapped file arenas whose contents link to each other through offsets,
+// so that data structures built in an arena can be used again by a later
+// process without being rebuilt.
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <utilities/include/utils.h>
+
+namespace file_arena {
+
+// Pointer to a `T` stored as the distance in bytes from the pointer to its
+// target. The pointer stays valid when the memory holding both it and its
+// target is mapped at another address, e.g., by a later process.
+//
+// An `OffsetPtr` never points at itself, so offset 0 stands for null. Copying
+// an `OffsetPtr` re-encodes its target relative to the copy.
+template <typename T>
+class OffsetPtr {
+ public:
+  OffsetPtr() : offset_{0} {}
+  explicit OffsetPtr(T* target) : offset_{Encode(target)} {}
+  OffsetPtr(const OffsetPtr& other) : offset_{Encode(other.Get())} {}
+  OffsetPtr& operator=(const OffsetPtr& other);
+  OffsetPtr& operator=(T* target);
+
+  T* Get() const;
+  operator T*() const { return Get(); }
+  T* operator->() const { return Get(); }
+  T& operator*() const { return *Get(); }
+  T& operator[](size_t i) const { return Get()[i]; }
+
+  // Atomically makes the pointer point to `new_target` if it points to
+  // `old_target`. Returns whether it did.
+  bool CompareAndSwap(T* old_target, T* new_target);
+
+ private:
+  intptr_t Encode(T* target) const;
+
+  intptr_t offset_;
+};
+
+// Arena of memory in a file that is mapped into the address space. Objects
+// built in the arena survive the process as long as every pointer in them
+// that leads into the arena is an `OffsetPtr`: a later process that `Open`s
+// the file can use them right away, wherever the file is mapped. Opening takes
+// O(1) time, since pages of the file are only read in as they are touched.
+//
+// Memory is handed out in multiples of `kAlignment` bytes. Freed blocks go on a
+// free list kept in the file and are reused first fit without being merged.
+// `Allocate` and `Free` may run concurrently with each other.
+//
+// The arena does not record the types of the objects in it, so a process must
+// open objects as the types they were built as. A file must not be open in two
+// arenas at once unless neither of them modifies it.
+class FileArena {
+ public:
+  static constexpr size_t kAlignment{64};
+
+  FileArena();
+  // Calls `Close()`.
+  ~FileArena();
+  FileArena(const FileArena&) = delete;
+  FileArena(FileArena&&) = delete;
+  FileArena& operator=(const FileArena&) = delete;
+  FileArena& operator=(FileArena&&) = delete;
+
+  // Replaces the file at `path` with an empty arena that can hand out nearly
+  // `capacity` bytes, and maps it. The file is sparse, so unused capacity takes
+  // no disk space. Returns false if the file could not be created or mapped.
+  bool Create(const std::string& path, size_t capacity);
+  // Maps the arena that `Create` made in the file at `path`. Returns false if
+  // the file could not be mapped or does not hold an arena.
+  bool Open(const std::string& path);
+  // Writes the arena out to its file. Changes reach the file eventually even
+  // without this, as long as the operating system keeps running. Returns false
+  // if the write failed.
+  bool Sync();
+  // Unmaps the arena, leaving its contents in the file. Does nothing if the
+  // arena is not open.
+  void Close();
+  bool IsOpen() const;
+
+  // Returns `bytes` bytes aligned to `kAlignment`, or null if the arena is out
+  // of space.
+  void* Allocate(size_t bytes);
+  // Frees the `bytes` bytes at `memory`, which `Allocate(bytes)` returned.
+  void Free(void* memory, size_t bytes);
+  // Constructs a `T` in the arena from `args`. Returns null if the arena is out
+  // of space.
+  template <typename T, typename... Args>
+  T* New(Args&&... args);
+  // Destroys `object`, which `New` returned, and frees its memory.
+  template <typename T>
+  void Delete(T* object);
+
+  // The root object is where a later process starts: it is the only object
+  // that the arena can find by itself. Initially there is none.
+  //
+  // Returns the root object, or null if none was set.
+  template <typename T>
+  T* GetRoot() const;
+  // Makes `object`, which must be in the arena, the root object.
+  template <typename T>
+  void SetRoot(T* object);
+
+  // Returns the open arena whose mapping holds `address`, or null if there is
+  // none.
+  static FileArena* Containing(const void* address);
+
+ private:
+  struct Header;
+
+  Header* GetHeader() const;
+  bool Map(int file, size_t size);
+
+  char* base_;
+  size_t size_;
+  std::mutex mutex_;
+};
+
+// Storage policy (see "skip_list_base.hpp") that links elements through
+// `OffsetPtr`s and takes arrays from the `FileArena` that holds the object
+// asking for them. Objects that use this policy must therefore be built in a
+// `FileArena`, e.g., through `FileArena::New`.
+struct FileArenaStorage {
+  template <typename T>
+  using Pointer = OffsetPtr<T>;
+
+  template <typename T>
+  static bool CompareAndSwap(
+      OffsetPtr<T>* link, T* old_value, T* new_value) {
+    return link->CompareAndSwap(old_value, new_value);
+  }
+  template <typename T>
+  static T* NewArray(const void* owner, size_t n);
+  template <typename T>
+  static void DeleteArray(const void* owner, T* array, size_t n);
+};
+
+///////////////////////////////////////////////////////////////////////////////
+//                           Implementation below.                           //
+///////////////////////////////////////////////////////////////////////////////
+
+template <typename T>
+OffsetPtr<T>& OffsetPtr<T>::operator=(const OffsetPtr& other) {
+  offset_ = Encode(other.Get());
+  return *this;
+}
+
+template <typename T>
+OffsetPtr<T>& OffsetPtr<T>::operator=(T* target) {
+  offset_ = Encode(target);
+  return *this;
+}
+
+template <typename T>
+intptr_t OffsetPtr<T>::Encode(T* target) const {
+  return target == nullptr
+    ? 0
+    : reinterpret_cast<intptr_t>(target) - reinterpret_cast<intptr_t>(this);
+}
+
+template <typename T>
+T* OffsetPtr<T>::Get() const {
+  return offset_ == 0
+    ? nullptr
+    : reinterpret_cast<T*>(reinterpret_cast<intptr_t>(this) + offset_);
+}
+
+template <typename T>
+bool OffsetPtr<T>::CompareAndSwap(T* old_target, T* new_target) {
+  return CAS(&offset_, Encode(old_target), Encode(new_target));
+}
+
+// A file made by `FileArena::Create` starts with a `Header`. Offsets are from
+// the start of the file, and offset 0 stands for none.
+struct FileArena::Header {
+  char magic[8];
+  // Size of the file.
+  uint64_t capacity;
+  // Offset of the first byte that has never been handed out.
+  uint64_t end;
+  // Offset of the first `FreeBlock` on the free list.
+  uint64_t free_list;
+  // Offset of the root object.
+  uint64_t root;
+};
+
+namespace _internal {
+
+// Header of a freed block of `size` bytes.
+struct FreeBlock {
+  uint64_t size;
+  // Offset of the next block on the free list.
+  uint64_t next;
+};
+
+constexpr char kArenaMagic[8]{'F', 'I', 'L', 'E', 'A', 'R', 'N', '1'};
+
+static_assert(sizeof(FreeBlock) <= FileArena::kAlignment,
+    "a free block must fit in the smallest block");
+
+inline size_t RoundToBlockSize(size_t bytes) {
+  return std::max<size_t>(
+      (bytes + FileArena::kAlignment - 1) / FileArena::kAlignment, 1) *
+    FileArena::kAlignment;
+}
+
+// Arenas that are open in this process, for `FileArena::Containing`.
+inline std::vector<FileArena*>& OpenArenas() {
+  static std::vector<FileArena*> arenas;
+  return arenas;
+}
+
+inline std::mutex& OpenArenasMutex() {
+  static std::mutex mutex;
+  return mutex;
+}
+
+}  // namespace _internal
+
+inline FileArena::FileArena() : base_{nullptr}, size_{0} {}
+
+inline FileArena::~FileArena() {
+  Close();
+}
+
+inline FileArena::Header* FileArena::GetHeader() const {
+  return reinterpret_cast<Header*>(base_);
+}
+
+// The file descriptor is not needed once the file is mapped.
+inline bool FileArena::Map(int file, size_t size) {
+  void* data{mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0)};
+  close(file);
+  if (data == MAP_FAILED) {
+    return false;
+  }
+  base_ = static_cast<char*>(data);
+  size_ = size;
+  std::lock_guard<std::mutex> lock{_internal::OpenArenasMutex()};
+  _internal::OpenArenas().push_back(this);
+  return true;
+}
+
+inline bool FileArena::Create(const std::string& path, size_t capacity) {
+  static_assert(sizeof(Header) <= kAlignment,
+      "the arena header must fit before the first block");
+  Close();
+  const size_t size{_internal::RoundToBlockSize(capacity) + kAlignment};
+  const int file{open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644)};
+  if (file == -1) {
+    return false;
+  }
+  if (ftruncate(file, size) != 0) {
+    close(file);
+    return false;
+  }
+  if (!Map(file, size)) {
+    return false;
+  }
+  Header* header{GetHeader()};
+  std::memcpy(header->magic, _internal::kArenaMagic, sizeof(header->magic));
+  header->capacity = size;
+  header->end = kAlignment;
+  header->free_list = 0;
+  header->root = 0;
+  return true;
+}
+
+inline bool FileArena::Open(const std::string& path) {
+  Close();
+  const int file{open(path.c_str(), O_RDWR)};
+  if (file == -1) {
+    return false;
+  }
+  struct stat file_status;
+  if (fstat(file, &file_status) != 0 ||
+      static_cast<size_t>(file_status.st_size) < kAlignment) {
+    close(file);
+    return false;
+  }
+  if (!Map(file, file_status.st_size)) {
+    return false;
+  }
+  const Header* header{GetHeader()};
+  if (std::memcmp(header->magic, _internal::kArenaMagic,
+        sizeof(header->magic)) != 0 ||
+      header->capacity != size_ ||
+      header->end > size_) {
+    Close();
+    return false;
+  }
+  return true;
+}
+
+inline bool FileArena::Sync() {
+  return base_ != nullptr && msync(base_, size_, MS_SYNC) == 0;
+}
+
+inline void FileArena::Close() {
+  if (base_ == nullptr) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock{_internal::OpenArenasMutex()};
+    std::vector<FileArena*>& arenas{_internal::OpenArenas()};
+    arenas.erase(std::find(arenas.begin(), arenas.end(), this));
+  }
+  munmap(base_, size_);
+  base_ = nullptr;
+  size_ = 0;
+}
+
+inline bool FileArena::IsOpen() const {
+  return base_ != nullptr;
+}
+
+// Take the first free block that is large enough, and put what is left of it
+// back on the free list. Otherwise, carve a new block out of the end of the
+// arena.
+inline void* FileArena::Allocate(size_t bytes) {
+  const size_t size{_internal::RoundToBlockSize(bytes)};
+  std::lock_guard<std::mutex> lock{mutex_};
+  Header* header{GetHeader()};
+  uint64_t* link{&header->free_list};
+  while (*link != 0) {
+    _internal::FreeBlock* block{
+      reinterpret_cast<_internal::FreeBlock*>(base_ + *link)};
+    if (block->size >= size) {
+      const uint64_t offset{*link};
+      if (block->size > size) {
+        _internal::FreeBlock* rest{
+          reinterpret_cast<_internal::FreeBlock*>(base_ + offset + size)};
+        rest->size = block->size - size;
+        rest->next = block->next;
+        *link = offset + size;
+      } else {
+        *link = block->next;
+      }
+      return base_ + offset;
+    }
+    link = &block->next;
+  }
+  if (size > header->capacity - header->end) {
+    return nullptr;
+  }
+  const uint64_t offset{header->end};
+  header->end += size;
+  return base_ + offset;
+}
+
+inline void FileArena::Free(void* memory, size_t bytes) {
+  std::lock_guard<std::mutex> lock{mutex_};
+  Header* header{GetHeader()};
+  _internal::FreeBlock* block{static_cast<_internal::FreeBlock*>(memory)};
+  block->size = _internal::RoundToBlockSize(bytes);
+  block->next = header->free_list;
+  header->free_list = static_cast<char*>(memory) - base_;
+}
+
+template <typename T, typename... Args>
+T* FileArena::New(Args&&... args) {
+  static_assert(alignof(T) <= kAlignment, "over-aligned type");
+  void* memory{Allocate(sizeof(T))};
+  return memory == nullptr
+    ? nullptr
+    : new (memory) T(std::forward<Args>(args)...);
+}
+
+template <typename T>
+void FileArena::Delete(T* object) {
+  object->~T();
+  Free(object, sizeof(T));
+}
+
+template <typename T>
+T* FileArena::GetRoot() const {
+  const uint64_t root{GetHeader()->root};
+  return root == 0 ? nullptr : reinterpret_cast<T*>(base_ + root);
+}
+
+template <typename T>
+void FileArena::SetRoot(T* object) {
+  GetHeader()->root = reinterpret_cast<char*>(object) - base_;
+}
+
+inline FileArena* FileArena::Containing(const void* address) {
+  const char* byte{static_cast<const char*>(address)};
+  std::lock_guard<std::mutex> lock{_internal::OpenArenasMutex()};
+  for (FileArena* arena : _internal::OpenArenas()) {
+    if (arena->base_ <= byte && byte < arena->base_ + arena->size_) {
+      return arena;
+    }
+  }
+  return nullptr;
+}
+
+template <typename T>
+T* FileArenaStorage::NewArray(const void* owner, size_t n) {
+  static_assert(alignof(T) <= FileArena::kAlignment, "over-aligned type");
+  FileArena* arena{FileArena::Containing(owner)};
+  if (arena == nullptr) {
+    fprintf(stderr, "Object using FileArenaStorage is not in a file arena\n");
+    exit(1);
+  }
+  T* array{static_cast<T*>(arena->Allocate(n * sizeof(T)))};
+  if (array == nullptr) {
+    fprintf(stderr, "Cannot allocate space in file arena\n");
+    exit(1);
+  }
+  return array;
+}
+
+template <typename T>
+void FileArenaStorage::DeleteArray(const void* owner, T* array, size_t n) {
+  if (!std::is_trivially_destructible<T>::value) {
+    parallel_for (size_t i = 0; i < n; i++) {
+      array[i].~T();
+    }
+  }
+  FileArena::Containing(owner)->Free(array, n * sizeof(T));
+}
+
+}  // namespace file_arena
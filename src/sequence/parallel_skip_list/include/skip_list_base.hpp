@@ -6,6 +6,45 @@
 
 namespace parallel_skip_list {
 
+// Storage policies decide how elements point to each other and where the arrays
+// behind elements and the containers holding them come from. A storage policy
+// provides
+//
+//   // Type of a stored pointer to a `T`. It converts to `T*` and can be
+//   // assigned a `T*`.
+//   template <typename T> using Pointer = ...;
+//   // Atomically replaces `*link` with `new_value` if it points to
+//   // `old_value`. Returns whether it did.
+//   template <typename T>
+//   static bool CompareAndSwap(Pointer<T>* link, T* old_value, T* new_value);
+//   // Returns an array of `n` uninitialized `T`s for the object at `owner`.
+//   template <typename T>
+//   static T* NewArray(const void* owner, size_t n);
+//   // Destroys and frees the `n`-length array `array` that `NewArray` returned
+//   // for the object at `owner`.
+//   template <typename T>
+//   static void DeleteArray(const void* owner, T* array, size_t n);
+//
+// `HeapStorage` uses raw pointers and the heap. `file_arena::FileArenaStorage`
+// in "file_arena.hpp" keeps everything in a memory-mapped file.
+struct HeapStorage {
+  template <typename T>
+  using Pointer = T*;
+
+  template <typename T>
+  static bool CompareAndSwap(T** link, T* old_value, T* new_value) {
+    return CAS(link, old_value, new_value);
+  }
+  template <typename T>
+  static T* NewArray(const void*, size_t n) {
+    return pbbs::new_array_no_init<T>(n);
+  }
+  template <typename T>
+  static void DeleteArray(const void*, T* array, size_t n) {
+    pbbs::delete_array(array, n);
+  }
+};
+
 // This is the base implementation of a phase-concurrent skip list supporting
 // splits and joins.
 //
@@ -23,22 +62,44 @@ namespace parallel_skip_list {
 // `Initialize()` should be called before creating any `ElementBase<Derived>`
 // elements. This means that elements must not be created as global or static
 // variables. `Finish()` can be called after we are done with all
-// `ElementBase<Derived>` elements.
-template <typename Derived>
+// `ElementBase<Derived>` elements. The exception is elements constructed with
+// caller-provided storage through `ElementBase(size_t, Neighbors*)`, which do
+// not depend on `Initialize()` or on any other static state.
+//
+// Elements store their links as `Storage::Pointer`s, where `Storage` is a
+// storage policy as described above. Elements have no virtual functions, so
+// with position-independent pointers, an element and its caller-provided links
+// may be moved to another address along with everything they link to.
+template <typename Derived, typename Storage = HeapStorage>
 class ElementBase {
  public:
+  template <typename T>
+  using Pointer = typename Storage::template Pointer<T>;
+
+  // Links of an element at a single level.
+  struct Neighbors { Pointer<Derived> prev; Pointer<Derived> next; };
+
   // Call this before creating any `ElementBase<Derived>` elements.
   static void Initialize();
   // Call this after being done with `ElementBase<Derived>`.
   static void Finish();
 
+  // Returns the height of an element constructed with seed `random_int`.
+  static int GetHeight(size_t random_int);
+
   // Running this concurrently may lead to poor randomness in the height
   // distribution of skip list elements.
   ElementBase();
   // Uses random_int as a seed to generate a random height for the element.
   explicit ElementBase(size_t random_int);
-
-  virtual ~ElementBase();
+  // Like `ElementBase(random_int)`, but stores the element's links in
+  // `neighbors` instead of allocating them from the allocator shared by all
+  // `ElementBase<Derived>` elements. `neighbors` must have room for
+  // `GetHeight(random_int)` entries and must outlive the element. The element
+  // does not free `neighbors`.
+  ElementBase(size_t random_int, Neighbors* neighbors);
+
+  ~ElementBase();
   ElementBase(const ElementBase&) = delete;
   ElementBase(ElementBase&&) = delete;
   ElementBase& operator=(const ElementBase&) = delete;
@@ -53,8 +114,16 @@ class ElementBase {
   //
   // A representative element is only valid until the next `Join` or `Split`
   // call.
+  //
+  // Takes O(log n) expected time on a list of n elements, whether or not the
+  // list is cyclic.
   Derived* FindRepresentative() const;
 
+  // When called on element `v`, searches left starting from and including `v`
+  // for the first element at the next level up. Returns null if there is no
+  // such element in the list.
+  Derived* FindLeftParent(int level) const;
+
   // Concatenates the list that `left` lives in to the list that `right` lives
   // in. `left` must be the last element in its list. `right` must be the first
   // element in its list. `left` and `right` are allowed to be in the same list,
@@ -74,13 +143,8 @@ class ElementBase {
   Derived* Split();
 
  protected:
-  struct Neighbors { Derived* prev; Derived* next; };
-
   bool CASNext(int level, Derived* old_next, Derived* new_next);
   bool CASPrev(int level, Derived* old_prev, Derived* new_prev);
-  // When called on element `v`, searches left starting from and including `v`
-  // for the first element at the next level up.
-  Derived* FindLeftParent(int level) const;
   // When called on element `v`, searches right starting from and including `v`
   // for the first element at the next level up.
   Derived* FindRightParent(int level) const;
@@ -94,8 +158,10 @@ class ElementBase {
 
   // neighbors_[i] holds neighbors at level i, where level 0 is the lowest level
   // and is the level at which the list contains all elements
-  Neighbors* neighbors_;
+  Pointer<Neighbors> neighbors_;
   int height_;
+  // Whether `neighbors_` came from `neighbor_allocator_`.
+  bool owns_storage_;
 };
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -108,14 +174,15 @@ int GenerateHeight(size_t random_int);
 
 }  // namespace _internal
 
-template <typename Derived>
-concurrent_array_allocator::Allocator<typename ElementBase<Derived>::Neighbors>*
-    ElementBase<Derived>::neighbor_allocator_{nullptr};
-template <typename Derived>
-pbbs::random ElementBase<Derived>::default_randomness_{};
+template <typename Derived, typename Storage>
+concurrent_array_allocator::Allocator<
+  typename ElementBase<Derived, Storage>::Neighbors>*
+    ElementBase<Derived, Storage>::neighbor_allocator_{nullptr};
+template <typename Derived, typename Storage>
+pbbs::random ElementBase<Derived, Storage>::default_randomness_{};
 
-template <typename Derived>
-void ElementBase<Derived>::Initialize() {
+template <typename Derived, typename Storage>
+void ElementBase<Derived, Storage>::Initialize() {
   if (neighbor_allocator_ == nullptr) {
     neighbor_allocator_ =
       new concurrent_array_allocator::Allocator<Neighbors>{};
@@ -123,16 +190,22 @@ void ElementBase<Derived>::Initialize() {
   Derived::DerivedInitialize();
 }
 
-template <typename Derived>
-void ElementBase<Derived>::Finish() {
+template <typename Derived, typename Storage>
+void ElementBase<Derived, Storage>::Finish() {
   if (neighbor_allocator_ != nullptr) {
     delete neighbor_allocator_;
+    neighbor_allocator_ = nullptr;
   }
   Derived::DerivedFinish();
 }
 
-template <typename Derived>
-ElementBase<Derived>::ElementBase() {
+template <typename Derived, typename Storage>
+int ElementBase<Derived, Storage>::GetHeight(size_t random_int) {
+  return _internal::GenerateHeight(random_int);
+}
+
+template <typename Derived, typename Storage>
+ElementBase<Derived, Storage>::ElementBase() : owns_storage_{true} {
   size_t random_int{default_randomness_.rand()};
   default_randomness_ = default_randomness_.next();  // race if run concurrently
   height_ = _internal::GenerateHeight(random_int);
@@ -142,8 +215,9 @@ ElementBase<Derived>::ElementBase() {
   }
 }
 
-template <typename Derived>
-ElementBase<Derived>::ElementBase(size_t random_int) {
+template <typename Derived, typename Storage>
+ElementBase<Derived, Storage>::ElementBase(size_t random_int)
+  : owns_storage_{true} {
   height_ = _internal::GenerateHeight(random_int);
   neighbors_ = neighbor_allocator_->Allocate(height_);
   for (int i = 0; i < height_; i++) {
@@ -151,35 +225,47 @@ ElementBase<Derived>::ElementBase(size_t random_int) {
   }
 }
 
-template <typename Derived>
-ElementBase<Derived>::~ElementBase() {
-  neighbor_allocator_->Free(neighbors_, height_);
+template <typename Derived, typename Storage>
+ElementBase<Derived, Storage>::ElementBase(
+    size_t random_int, Neighbors* neighbors)
+  : neighbors_{neighbors}, owns_storage_{false} {
+  height_ = _internal::GenerateHeight(random_int);
+  for (int i = 0; i < height_; i++) {
+    neighbors_[i].prev = neighbors_[i].next = nullptr;
+  }
+}
+
+template <typename Derived, typename Storage>
+ElementBase<Derived, Storage>::~ElementBase() {
+  if (owns_storage_) {
+    neighbor_allocator_->Free(neighbors_, height_);
+  }
 }
 
-template <typename Derived>
-bool ElementBase<Derived>::CASNext(
+template <typename Derived, typename Storage>
+bool ElementBase<Derived, Storage>::CASNext(
     int level, Derived* old_next, Derived* new_next) {
-  return CAS(&neighbors_[level].next, old_next, new_next);
+  return Storage::CompareAndSwap(&neighbors_[level].next, old_next, new_next);
 }
 
-template <typename Derived>
-bool ElementBase<Derived>::CASPrev(
+template <typename Derived, typename Storage>
+bool ElementBase<Derived, Storage>::CASPrev(
     int level, Derived* old_prev, Derived* new_prev) {
-  return CAS(&neighbors_[level].prev, old_prev, new_prev);
+  return Storage::CompareAndSwap(&neighbors_[level].prev, old_prev, new_prev);
 }
 
-template <typename Derived>
-Derived* ElementBase<Derived>::GetPreviousElement() const {
+template <typename Derived, typename Storage>
+Derived* ElementBase<Derived, Storage>::GetPreviousElement() const {
   return neighbors_[0].prev;
 }
 
-template <typename Derived>
-Derived* ElementBase<Derived>::GetNextElement() const {
+template <typename Derived, typename Storage>
+Derived* ElementBase<Derived, Storage>::GetNextElement() const {
   return neighbors_[0].next;
 }
 
-template <typename Derived>
-Derived* ElementBase<Derived>::FindLeftParent(int level) const {
+template <typename Derived, typename Storage>
+Derived* ElementBase<Derived, Storage>::FindLeftParent(int level) const {
   const Derived* current_element{static_cast<const Derived*>(this)};
   const Derived* start_element{current_element};
   do {
@@ -191,8 +277,8 @@ Derived* ElementBase<Derived>::FindLeftParent(int level) const {
   return nullptr;
 }
 
-template <typename Derived>
-Derived* ElementBase<Derived>::FindRightParent(int level) const {
+template <typename Derived, typename Storage>
+Derived* ElementBase<Derived, Storage>::FindRightParent(int level) const {
   const Derived* current_element{static_cast<const Derived*>(this)};
   const Derived* start_element{current_element};
   do {
@@ -204,45 +290,54 @@ Derived* ElementBase<Derived>::FindRightParent(int level) const {
   return nullptr;
 }
 
-template <typename Derived>
-Derived* ElementBase<Derived>::FindRepresentative() const {
+// Walk forward, moving up to the top level of each element passed. The walk
+// at a level ends either by finding an element that reaches higher or, on a
+// cyclic list, by coming back around to the element it started the level at.
+// In the latter case, no element reaches higher, so the level is the top level,
+// and the lap has passed every element on it exactly once. Each level below
+// the top takes O(1) expected steps, and the top level holds O(1) expected
+// elements, so the walk takes O(log n) expected steps on a list of n elements.
+template <typename Derived, typename Storage>
+Derived* ElementBase<Derived, Storage>::FindRepresentative() const {
   // If the list is cyclic, return element on highest level, breaking ties in
   // favor of the lowest address.
   // If the list is not cyclic, then return the head element on the highest
   // level.
 
   const Derived* current_element{static_cast<const Derived*>(this)};
-  const Derived* seen_element{nullptr};
   int current_level{current_element->height_ - 1};
+  const Derived* level_start{current_element};
+  const Derived* min_element{current_element};
 
   // walk up while moving forward
-  while (current_element->neighbors_[current_level].next != nullptr &&
-         seen_element != current_element) {
-    if (seen_element == nullptr || current_element < seen_element) {
-      seen_element = current_element;
+  while (true) {
+    const Derived* next{current_element->neighbors_[current_level].next};
+    if (next == nullptr) {
+      break;
     }
-    current_element = current_element->neighbors_[current_level].next;
+    if (next == level_start) {  // list is a cycle
+      return const_cast<Derived*>(min_element);
+    }
+    current_element = next;
     const int top_level{current_element->height_ - 1};
     if (current_level < top_level) {
       current_level = top_level;
-      seen_element = nullptr;
+      level_start = min_element = current_element;
+    } else if (current_element < min_element) {
+      min_element = current_element;
     }
   }
 
-  if (seen_element == current_element) {  // list is a cycle
-    return const_cast<Derived*>(seen_element);
-  } else {
-    // walk up while moving backward
-    while (current_element->neighbors_[current_level].prev != nullptr) {
-      current_element = current_element->neighbors_[current_level].prev;
-      current_level = current_element->height_ - 1;
-    }
-    return const_cast<Derived*>(current_element);
+  // walk up while moving backward
+  while (current_element->neighbors_[current_level].prev != nullptr) {
+    current_element = current_element->neighbors_[current_level].prev;
+    current_level = current_element->height_ - 1;
   }
+  return const_cast<Derived*>(current_element);
 }
 
-template <typename Derived>
-void ElementBase<Derived>::Join(Derived* left, Derived* right) {
+template <typename Derived, typename Storage>
+void ElementBase<Derived, Storage>::Join(Derived* left, Derived* right) {
   int level{0};
   while (left != nullptr && right != nullptr) {
     if (left->neighbors_[level].next == nullptr &&
@@ -260,8 +355,8 @@ void ElementBase<Derived>::Join(Derived* left, Derived* right) {
   }
 }
 
-template <typename Derived>
-Derived* ElementBase<Derived>::Split() {
+template <typename Derived, typename Storage>
+Derived* ElementBase<Derived, Storage>::Split() {
   // It's tempting to set `successor = GetNextElement()` here, but we need to
   // wait for the CAS in case multiple `Split` calls are made on the same
   // element.
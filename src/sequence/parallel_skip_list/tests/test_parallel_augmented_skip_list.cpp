@@ -1,5 +1,6 @@
 #include <sequence/parallel_skip_list/include/augmented_skip_list.hpp>
 
+#include <algorithm>
 #include <cassert>
 
 #include <utilities/include/debug.hpp>
@@ -10,6 +11,44 @@ using std::pair;
 using Element = parallel_skip_list::AugmentedElement;
 typedef pair<Element*, Element*> ElementPPair;
 
+// Non-commutative augmentation over runs of consecutive indices. The sum over a
+// subsequence is valid if and only if the subsequence consists of consecutive
+// indices in increasing order, in which case `first` and `last` give the
+// endpoints of the run.
+struct Run {
+  int first;
+  int last;
+  bool valid;
+  bool empty;
+};
+struct RunAugmentation {
+  using ValueType = Run;
+  static Run Identity() { return Run{0, 0, true, true}; }
+  static Run Combine(const Run& a, const Run& b) {
+    if (a.empty) return b;
+    if (b.empty) return a;
+    return Run{a.first, b.last, a.valid && b.valid && a.last + 1 == b.first,
+        false};
+  }
+};
+class RunElement
+  : public parallel_skip_list::AugmentedElementBase<
+      RunElement, RunAugmentation> {
+ public:
+  RunElement(size_t random_int, int index)
+    : parallel_skip_list::AugmentedElementBase<RunElement, RunAugmentation>{
+        random_int, Run{index, index, true, false}} {}
+};
+class MinElement
+  : public parallel_skip_list::AugmentedElementBase<
+      MinElement, parallel_skip_list::MinAugmentation<int>> {
+ public:
+  MinElement(size_t random_int, int value)
+    : parallel_skip_list::AugmentedElementBase<
+        MinElement, parallel_skip_list::MinAugmentation<int>>{
+          random_int, value} {}
+};
+
 constexpr int NumElements{1000};
 // initialized in main(), because otherwise calling the constructor for
 // `Element` will fail due to its internal allocators not being initialized yet
@@ -56,6 +95,188 @@ void CheckListSize(int idx) {
   assert(true_size == get_size);
 }
 
+void CheckRun(const Run& run, int first, int last, bool valid) {
+  assert(!run.empty);
+  assert(run.first == first);
+  assert(run.last == last);
+  assert(run.valid == valid);
+}
+
+// Checks that a non-commutative augmentation is applied in list order, starting
+// from the queried element on cyclic lists.
+void TestNonCommutativeAugmentation() {
+  constexpr int kRunLength{10};
+  static_assert(NumElements % kRunLength == 0, "");
+  RunElement::Initialize();
+  pbbs::random r;
+  RunElement* runs{pbbs::new_array_no_init<RunElement>(NumElements)};
+  parallel_for (int i = 0; i < NumElements; i++) {
+    new (&runs[i]) RunElement(r.ith_rand(i), i);
+  }
+  pair<RunElement*, RunElement*>* joins{
+    pbbs::new_array_no_init<pair<RunElement*, RunElement*>>(NumElements)};
+  RunElement** splits{pbbs::new_array_no_init<RunElement*>(NumElements)};
+
+  // Join all elements together
+  parallel_for (int i = 0; i < NumElements - 1; i++) {
+    joins[i] = make_pair(&runs[i], &runs[i + 1]);
+  }
+  RunElement::BatchJoin(joins, NumElements - 1);
+  parallel_for (int i = 0; i < NumElements; i++) {
+    CheckRun(runs[i].GetSum(), 0, NumElements - 1, true);
+    const int j{(i + 37) % NumElements};
+    if (i <= j) {
+      CheckRun(RunElement::GetSubsequenceSum(&runs[i], &runs[j]), i, j, true);
+    }
+  }
+
+  // Split into runs of length `kRunLength`
+  int len{0};
+  for (int i = kRunLength - 1; i < NumElements - 1; i += kRunLength) {
+    splits[len++] = &runs[i];
+  }
+  RunElement::BatchSplit(splits, len);
+  parallel_for (int i = 0; i < NumElements; i++) {
+    const int first{i - i % kRunLength};
+    CheckRun(runs[i].GetSum(), first, first + kRunLength - 1, true);
+  }
+
+  // Join everything back together into one big cycle
+  len = 0;
+  for (int i = kRunLength - 1; i < NumElements; i += kRunLength) {
+    joins[len++] = make_pair(&runs[i], &runs[(i + 1) % NumElements]);
+  }
+  RunElement::BatchJoin(joins, len);
+  parallel_for (int i = 0; i < NumElements; i++) {
+    CheckRun(runs[i].GetSum(), i, (i + NumElements - 1) % NumElements, i == 0);
+    const int j{(i + 37) % NumElements};
+    CheckRun(RunElement::GetSubsequenceSum(&runs[i], &runs[j]), i, j, i <= j);
+  }
+
+  pbbs::delete_array(joins, NumElements);
+  pbbs::delete_array(splits, NumElements);
+  pbbs::delete_array(runs, NumElements);
+  RunElement::Finish();
+}
+
+// Checks that `BatchBuild` lays out cyclic and acyclic lists in order, and that
+// the lists can be split and joined afterwards.
+void TestBatchBuild() {
+  constexpr int kRunLength{10};
+  static_assert(NumElements % (2 * kRunLength) == 0, "");
+  RunElement::Initialize();
+  pbbs::random r;
+  RunElement* runs{pbbs::new_array_no_init<RunElement>(NumElements)};
+  parallel_for (int i = 0; i < NumElements; i++) {
+    new (&runs[i]) RunElement(r.ith_rand(i), i);
+  }
+
+  // Even-numbered runs of `kRunLength` elements become cyclic lists and
+  // odd-numbered runs become acyclic lists. Pass the elements out of order.
+  RunElement** elements{pbbs::new_array_no_init<RunElement*>(NumElements)};
+  RunElement** successors{pbbs::new_array_no_init<RunElement*>(NumElements)};
+  parallel_for (int k = 0; k < NumElements; k++) {
+    const int i{static_cast<int>(7L * k % NumElements)};
+    const int first{i - i % kRunLength};
+    const bool is_cyclic{first / kRunLength % 2 == 0};
+    elements[k] = &runs[i];
+    if (i + 1 < first + kRunLength) {
+      successors[k] = &runs[i + 1];
+    } else {
+      successors[k] = is_cyclic ? &runs[first] : nullptr;
+    }
+  }
+  RunElement::BatchBuild(elements, successors, NumElements);
+  parallel_for (int i = 0; i < NumElements; i++) {
+    const int first{i - i % kRunLength};
+    const int last{first + kRunLength - 1};
+    if (first / kRunLength % 2 == 0) {
+      CheckRun(runs[i].GetSum(), i, i == first ? last : i - 1, i == first);
+      CheckRun(RunElement::GetSubsequenceSum(&runs[last], &runs[i]),
+          last, i, i == last);
+    } else {
+      CheckRun(runs[i].GetSum(), first, last, true);
+      CheckRun(RunElement::GetSubsequenceSum(&runs[i], &runs[last]),
+          i, last, true);
+    }
+    assert(runs[i].FindRepresentative() == runs[first].FindRepresentative());
+    if (first > 0) {
+      assert(runs[i].FindRepresentative() !=
+          runs[first - 1].FindRepresentative());
+    }
+  }
+
+  // Open each cycle after its last element and append the following acyclic
+  // list to it.
+  constexpr int kNumPairs{NumElements / (2 * kRunLength)};
+  RunElement** splits{pbbs::new_array_no_init<RunElement*>(kNumPairs)};
+  pair<RunElement*, RunElement*>* joins{
+    pbbs::new_array_no_init<pair<RunElement*, RunElement*>>(kNumPairs)};
+  parallel_for (int p = 0; p < kNumPairs; p++) {
+    const int last{2 * kRunLength * p + kRunLength - 1};
+    splits[p] = &runs[last];
+    joins[p] = make_pair(&runs[last], &runs[last + 1]);
+  }
+  RunElement::BatchSplit(splits, kNumPairs);
+  RunElement::BatchJoin(joins, kNumPairs);
+  parallel_for (int i = 0; i < NumElements; i++) {
+    const int first{i - i % (2 * kRunLength)};
+    CheckRun(runs[i].GetSum(), first, first + 2 * kRunLength - 1, true);
+  }
+
+  pbbs::delete_array(joins, kNumPairs);
+  pbbs::delete_array(splits, kNumPairs);
+  pbbs::delete_array(successors, NumElements);
+  pbbs::delete_array(elements, NumElements);
+  pbbs::delete_array(runs, NumElements);
+  RunElement::Finish();
+}
+
+// Checks `BatchUpdate` and `GetSubsequenceSum` on a min augmentation.
+void TestMinAugmentation() {
+  MinElement::Initialize();
+  pbbs::random r;
+  int* values{pbbs::new_array_no_init<int>(NumElements)};
+  MinElement* mins{pbbs::new_array_no_init<MinElement>(NumElements)};
+  parallel_for (int i = 0; i < NumElements; i++) {
+    values[i] = r.ith_rand(i) % (2 * NumElements);
+    new (&mins[i]) MinElement(r.ith_rand(NumElements + i), values[i]);
+  }
+  pair<MinElement*, MinElement*>* joins{
+    pbbs::new_array_no_init<pair<MinElement*, MinElement*>>(NumElements)};
+  parallel_for (int i = 0; i < NumElements - 1; i++) {
+    joins[i] = make_pair(&mins[i], &mins[i + 1]);
+  }
+  MinElement::BatchJoin(joins, NumElements - 1);
+
+  // Reassign values at every third element
+  const int num_updates{NumElements / 3};
+  MinElement** updated{pbbs::new_array_no_init<MinElement*>(num_updates)};
+  int* new_values{pbbs::new_array_no_init<int>(num_updates)};
+  parallel_for (int i = 0; i < num_updates; i++) {
+    updated[i] = &mins[3 * i];
+    new_values[i] = values[3 * i] =
+      r.ith_rand(2 * NumElements + i) % (2 * NumElements) - NumElements;
+  }
+  MinElement::BatchUpdate(updated, new_values, num_updates);
+
+  const int true_min{*std::min_element(values, values + NumElements)};
+  parallel_for (int i = 0; i < NumElements; i++) {
+    assert(mins[i].GetSum() == true_min);
+    const int j{std::min(NumElements - 1, i + static_cast<int>(r.ith_rand(
+        3 * NumElements + i) % 100))};
+    assert(MinElement::GetSubsequenceSum(&mins[i], &mins[j]) ==
+        *std::min_element(values + i, values + j + 1));
+  }
+
+  pbbs::delete_array(updated, num_updates);
+  pbbs::delete_array(new_values, num_updates);
+  pbbs::delete_array(joins, NumElements);
+  pbbs::delete_array(mins, NumElements);
+  pbbs::delete_array(values, NumElements);
+  MinElement::Finish();
+}
+
 int main() {
   Element::Initialize();
   pbbs::random r;
@@ -172,6 +393,10 @@ int main() {
   pbbs::delete_array(elements, NumElements);
   Element::Finish();
 
+  TestNonCommutativeAugmentation();
+  TestBatchBuild();
+  TestMinAugmentation();
+
   cout << "Test complete." << endl;
 
   return 0;
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <utility>
 
 #include <utilities/include/utils.h>
@@ -10,11 +11,21 @@ inline unsigned hashIntPair(const std::pair<unsigned, unsigned>& p) {
   return h;
 }
 
-// For use in hash containers. For instance:
+inline uint64_t hashLongPair(const std::pair<uint64_t, uint64_t>& p) {
+  uint64_t h{pbbs::hash64(p.first)};
+  h ^= pbbs::hash64(p.second) + 0x9e3779b97f4a7c15 + (h << 6) + (h >> 2);
+  return h;
+}
+
+// For use in hash containers keyed by pairs of `int`s or pairs of `int64_t`s.
+// For instance:
 //   std::unordered_map<std::pair<int, int>, std::string, HashIntPairStruct>
 //     int_to_string_map;
 struct HashIntPairStruct {
   size_t operator () (const std::pair<int, int> &p) const {
     return hashIntPair(p);
   }
+  size_t operator () (const std::pair<int64_t, int64_t> &p) const {
+    return hashLongPair(p);
+  }
 };